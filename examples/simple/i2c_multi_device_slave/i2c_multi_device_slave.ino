@@ -0,0 +1,64 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Demonstrates use of I2CMultiDeviceSlave to make one Teensy look
+// like several different I2C devices.
+//
+// To use it, connect a master to the Teensy on pins 16 and 17.
+// The Teensy pretends to be 3 sensors at addresses 0x40, 0x41 and 0x48.
+// Read 2 bytes from any of them to get that sensor's latest value.
+// Write 1 byte to a sensor to change its gain.
+//
+// This is an advanced example.
+
+#include <Arduino.h>
+#include <i2c_multi_device_slave.h>
+
+struct Sensor {
+    uint8_t gain;       // Written by the master
+    uint16_t value;     // Read by the master
+};
+
+Sensor sensors[3] = {{1, 0}, {1, 0}, {1, 0}};
+volatile bool gain_changed = false;
+
+// Called by the I2C interrupt service routine.
+// This method must be as fast as possible.
+// Do not perform IO in it.
+void after_receive(const I2CEmulatedDevice& device, size_t length) {
+    gain_changed = true;
+}
+
+// The table of devices. Each device has its own buffers.
+const I2CEmulatedDevice devices[] = {
+    {0x40, &sensors[0].gain, 1, (uint8_t*)&sensors[0].value, 2, after_receive, nullptr, nullptr, &sensors[0]},
+    {0x41, &sensors[1].gain, 1, (uint8_t*)&sensors[1].value, 2, after_receive, nullptr, nullptr, &sensors[1]},
+    {0x48, &sensors[2].gain, 1, (uint8_t*)&sensors[2].value, 2, after_receive, nullptr, nullptr, &sensors[2]},
+};
+
+I2CMultiDeviceSlave multi_slave(Slave1, devices, sizeof(devices) / sizeof(devices[0]));
+
+void setup() {
+    pinMode(LED_BUILTIN, OUTPUT);
+
+    // Start listening to all the devices
+    multi_slave.listen();
+
+    // Enable the serial port for debugging
+    Serial.begin(9600);
+    Serial.println("Started");
+}
+
+void loop() {
+    // Update the values that the master will read.
+    // See the README for ways to avoid partial reads.
+    for (Sensor& sensor : sensors) {
+        sensor.value = analogRead(A0) * sensor.gain;
+    }
+
+    if (gain_changed) {
+        gain_changed = false;
+        Serial.println("Master changed a gain setting.");
+    }
+    delay(10);
+}
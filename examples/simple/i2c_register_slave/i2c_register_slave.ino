@@ -44,7 +44,7 @@ int32_t get_current();
 int32_t get_voltage();
 
 // Callbacks.
-void on_read_isr(uint8_t reg_num);
+void on_read_isr(uint16_t reg_num);
 
 void setup() {
     pinMode(LED_BUILTIN, OUTPUT);
@@ -78,7 +78,7 @@ void loop() {
     delay(200); // Update at 5 Hz
 }
 
-void on_read_isr(uint8_t reg_num) {
+void on_read_isr(uint16_t reg_num) {
     // Clear the "new data" bit so the master knows it's
     // already read this set of values.
     registers.flags = 0;
@@ -0,0 +1,404 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Measures the throughput, ISR load and latency of each layer of the
+// library by running it against the LPI2C simulator.
+//
+// Every run gives the same results because the simulator keeps its own
+// clock. The numbers are only as good as the simulator's timing model.
+// Use the end-to-end tests on real hardware to check them.
+//
+// Usage: i2c_benchmark [--json] [--profile] [--transactions N]
+// Prints CSV to stdout by default. Failed transactions are counted in
+// the "errors" column rather than stopping the run.
+//
+// --profile replaces the summary with the number of times each register
+// was read and written for each ISR cause. See RegisterAccessProfile.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "lpi2c_simulator.h"
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_device.h"
+#include "i2c_driver_wire.h"
+#include "i2c_register_slave.h"
+
+#define BENCHMARK_SLAVE_ADDRESS 0x2D
+#define BENCHMARK_MAX_MESSAGE_LENGTH 4096
+#define BENCHMARK_MAX_READ_LENGTH 256         // Master can't read more than this in one go
+// I2CDevice gives up after 200 ms but leaves the transfer running with
+// a buffer on its stack. Keep well inside the limit at 100 kHz.
+#define BENCHMARK_MAX_DEVICE_LENGTH 1024
+#define BENCHMARK_BYTES_PER_POINT 16384       // Sets the default number of transactions
+#define BENCHMARK_TIMEOUT_NS 1'000'000'000ULL
+
+static const uint32_t frequencies[] = {100'000, 400'000, 1'000'000};
+static const size_t message_lengths[] = {0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+enum class Direction {write, read};
+
+struct Result {
+    const char* layer;
+    Direction direction;
+    uint32_t frequency;
+    size_t message_length;
+    uint32_t transactions = 0;
+    uint32_t errors = 0;
+    uint64_t elapsed_ns = 0;
+    uint64_t total_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+    uint32_t master_isrs = 0;
+    uint32_t slave_isrs = 0;
+    RegisterAccessProfile master_profile;
+    RegisterAccessProfile slave_profile;
+
+    double seconds() const { return elapsed_ns / 1e9; }
+    double bytes_per_second() const { return elapsed_ns ? transactions * message_length / seconds() : 0; }
+    double transactions_per_second() const { return elapsed_ns ? transactions / seconds() : 0; }
+    double isrs_per_byte() const {
+        size_t bytes = transactions * message_length;
+        return bytes ? (double)(master_isrs + slave_isrs) / bytes : 0;
+    }
+    double isrs_per_transaction() const {
+        return transactions ? (double)(master_isrs + slave_isrs) / transactions : 0;
+    }
+    double register_accesses_per_byte() const {
+        size_t bytes = transactions * message_length;
+        return bytes ? (double)(master_profile.accesses() + slave_profile.accesses()) / bytes : 0;
+    }
+    double mean_latency_ns() const { return transactions ? (double)total_latency_ns / transactions : 0; }
+};
+
+// A layer of the library under test. Each layer is driven by Master
+// on LPI2C1 and talks to a slave on LPI2C3.
+struct Layer {
+    const char* name;
+    size_t max_write_length;
+    size_t max_read_length;
+    // Configures the slave and starts the master
+    std::function<void(uint32_t frequency)> set_up;
+    // Performs one complete transaction. Returns false if it failed.
+    std::function<bool(Direction, uint8_t*, size_t)> transfer;
+};
+
+static uint8_t master_buffer[BENCHMARK_MAX_MESSAGE_LENGTH + 2];
+static uint8_t slave_rx_buffer[BENCHMARK_MAX_MESSAGE_LENGTH + 2];
+static uint8_t slave_tx_buffer[BENCHMARK_MAX_MESSAGE_LENGTH];
+static uint8_t registers[BENCHMARK_MAX_MESSAGE_LENGTH];
+static uint8_t read_only_registers[BENCHMARK_MAX_MESSAGE_LENGTH];
+
+static uint8_t wire_rx_buffer[BENCHMARK_MAX_READ_LENGTH];
+static uint8_t wire_tx_buffer[BENCHMARK_MAX_READ_LENGTH];
+
+static I2CDevice device(Master, BENCHMARK_SLAVE_ADDRESS);
+// Wire with the buffer sizes a display or EEPROM library needs
+static I2CDriverWire large_wire(Master, Slave, wire_rx_buffer, sizeof(wire_rx_buffer),
+                                wire_tx_buffer, sizeof(wire_tx_buffer));
+static I2CRegisterSlave register_slave(Slave1, registers, sizeof(registers),
+                                       read_only_registers, sizeof(read_only_registers),
+                                       RegisterNumberSize::two_bytes);
+
+static bool wait_for_master() {
+    return lpi2c_simulator.run_until([]() { return Master.finished(); }, BENCHMARK_TIMEOUT_NS)
+        && Master.error() == I2CError::ok;
+}
+
+static void set_up_raw_slave() {
+    Slave1.after_receive(nullptr);
+    Slave1.before_transmit(nullptr);
+    Slave1.after_transmit(nullptr);
+    Slave1.set_receive_buffer(slave_rx_buffer, sizeof(slave_rx_buffer));
+    Slave1.set_transmit_buffer(slave_tx_buffer, sizeof(slave_tx_buffer));
+    Slave1.listen(BENCHMARK_SLAVE_ADDRESS);
+}
+
+static void set_up_master(uint32_t frequency) {
+    set_up_raw_slave();
+    Master.begin(frequency);
+}
+
+static void set_up_wire(I2CDriverWire& wire, uint32_t frequency) {
+    set_up_raw_slave();
+    wire.setClock(frequency);
+    wire.begin();
+}
+
+static void set_up_register_slave(uint32_t frequency) {
+    register_slave.listen(BENCHMARK_SLAVE_ADDRESS);
+    Master.begin(frequency);
+}
+
+static bool master_transfer(Direction direction, uint8_t* buffer, size_t length) {
+    if (direction == Direction::write) {
+        Master.write_async(BENCHMARK_SLAVE_ADDRESS, buffer, length, true);
+    } else {
+        Master.read_async(BENCHMARK_SLAVE_ADDRESS, buffer, length, true);
+    }
+    return wait_for_master();
+}
+
+static bool device_transfer(Direction direction, uint8_t* buffer, size_t length) {
+    if (direction == Direction::write) {
+        return device.write(0, buffer, length, true);
+    }
+    return device.read(0, buffer, length, true);
+}
+
+static bool wire_transfer(I2CDriverWire& wire, Direction direction, uint8_t* buffer, size_t length) {
+    if (direction == Direction::write) {
+        wire.beginTransmission(BENCHMARK_SLAVE_ADDRESS);
+        wire.write(buffer, length);
+        return wire.endTransmission() == 0;
+    }
+    // requestFrom() returns a uint8_t so 256 bytes looks like 0
+    wire.requestFrom(BENCHMARK_SLAVE_ADDRESS, (int)length);
+    return (size_t)wire.available() == length;
+}
+
+// The master sends a 2 byte register number before the data.
+static bool register_slave_transfer(Direction direction, uint8_t* buffer, size_t length) {
+    buffer[0] = 0;
+    buffer[1] = 0;
+    if (direction == Direction::write) {
+        Master.write_async(BENCHMARK_SLAVE_ADDRESS, buffer, length + 2, true);
+        return wait_for_master();
+    }
+    Master.write_async(BENCHMARK_SLAVE_ADDRESS, buffer, 2, false);
+    if (!wait_for_master()) {
+        return false;
+    }
+    Master.read_async(BENCHMARK_SLAVE_ADDRESS, buffer, length, true);
+    return wait_for_master();
+}
+
+static std::vector<Layer> layers() {
+    return {
+        {"master", BENCHMARK_MAX_MESSAGE_LENGTH, BENCHMARK_MAX_READ_LENGTH,
+         set_up_master, master_transfer},
+        {"device", BENCHMARK_MAX_DEVICE_LENGTH, BENCHMARK_MAX_READ_LENGTH,
+         set_up_master, device_transfer},
+        {"wire", Wire.txBufferLength(), Wire.rxBufferLength(),
+         [](uint32_t frequency) { set_up_wire(Wire, frequency); },
+         [](Direction direction, uint8_t* buffer, size_t length) {
+             return wire_transfer(Wire, direction, buffer, length);
+         }},
+        {"wire_256", large_wire.txBufferLength(), large_wire.rxBufferLength(),
+         [](uint32_t frequency) { set_up_wire(large_wire, frequency); },
+         [](Direction direction, uint8_t* buffer, size_t length) {
+             return wire_transfer(large_wire, direction, buffer, length);
+         }},
+        {"register_slave", BENCHMARK_MAX_MESSAGE_LENGTH, BENCHMARK_MAX_READ_LENGTH,
+         set_up_register_slave, register_slave_transfer},
+    };
+}
+
+static uint32_t default_transactions(size_t message_length) {
+    size_t transactions = BENCHMARK_BYTES_PER_POINT / (message_length ? message_length : 1);
+    if (transactions < 4) {
+        return 4;
+    }
+    return transactions > 256 ? 256 : (uint32_t)transactions;
+}
+
+static Result run(const Layer& layer, Direction direction, uint32_t frequency,
+                  size_t message_length, uint32_t transactions) {
+    Result result{layer.name, direction, frequency, message_length};
+    lpi2c_simulator.reset();
+    lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+    layer.set_up(frequency);
+    simulated_lpi2c1.profile.reset();
+    simulated_lpi2c3.profile.reset();
+
+    uint64_t start_ns = lpi2c_simulator.now_ns();
+    uint32_t master_isrs = simulated_lpi2c1.stats.isr_entries;
+    uint32_t slave_isrs = simulated_lpi2c3.stats.isr_entries;
+    for (uint32_t i = 0; i < transactions; i++) {
+        uint64_t call_ns = lpi2c_simulator.now_ns();
+        // The register slave layer needs room for the register number
+        uint8_t* buffer = strcmp(layer.name, "register_slave") == 0 ? master_buffer : master_buffer + 2;
+        // Layers with a timeout may give up before the transfer is complete
+        if (!layer.transfer(direction, buffer, message_length) || !Master.finished()) {
+            result.errors++;
+            wait_for_master();
+        }
+        uint64_t latency_ns = lpi2c_simulator.now_ns() - call_ns;
+        result.total_latency_ns += latency_ns;
+        if (latency_ns > result.max_latency_ns) {
+            result.max_latency_ns = latency_ns;
+        }
+        result.transactions++;
+    }
+    result.elapsed_ns = lpi2c_simulator.now_ns() - start_ns;
+    result.master_isrs = simulated_lpi2c1.stats.isr_entries - master_isrs;
+    result.slave_isrs = simulated_lpi2c3.stats.isr_entries - slave_isrs;
+    result.master_profile = simulated_lpi2c1.profile;
+    result.slave_profile = simulated_lpi2c3.profile;
+
+    Master.end();
+    Slave1.stop_listening();
+    return result;
+}
+
+static const char* to_string(Direction direction) {
+    return direction == Direction::write ? "write" : "read";
+}
+
+// Writes rows of named fields as CSV or as a JSON array of objects.
+// Every row must have the same fields.
+class Output {
+public:
+    explicit Output(bool json) : json(json) {}
+
+    void field(const char* name, const char* value) {
+        add(name, json ? "\"" + std::string(value) + "\"" : std::string(value));
+    }
+
+    void field(const char* name, uint64_t value) {
+        add(name, std::to_string(value));
+    }
+
+    void field(const char* name, double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.3f", value);
+        add(name, text);
+    }
+
+    void end_row() {
+        if (json) {
+            printf("%s\n  {%s}", rows ? "," : "[", row.c_str());
+        } else {
+            if (rows == 0) {
+                printf("%s\n", header.c_str());
+            }
+            printf("%s\n", row.c_str());
+        }
+        rows++;
+        header.clear();
+        row.clear();
+    }
+
+    void finish() {
+        if (json) {
+            printf("%s\n", rows ? "\n]" : "[]");
+        }
+    }
+
+private:
+    const bool json;
+    uint32_t rows = 0;
+    std::string header;
+    std::string row;
+
+    void add(const char* name, const std::string& value) {
+        const char* separator = row.empty() ? "" : (json ? ", " : ",");
+        if (json) {
+            row += separator + ("\"" + std::string(name) + "\": ") + value;
+        } else {
+            header += separator + std::string(name);
+            row += separator + value;
+        }
+    }
+};
+
+static void write_point(Output& out, const Result& r) {
+    out.field("layer", r.layer);
+    out.field("direction", to_string(r.direction));
+    out.field("frequency_hz", (uint64_t)r.frequency);
+    out.field("message_bytes", (uint64_t)r.message_length);
+    out.field("transactions", (uint64_t)r.transactions);
+}
+
+static void write_result(Output& out, const Result& r) {
+    write_point(out, r);
+    out.field("errors", (uint64_t)r.errors);
+    out.field("elapsed_ns", r.elapsed_ns);
+    out.field("bytes_per_second", r.bytes_per_second());
+    out.field("transactions_per_second", r.transactions_per_second());
+    out.field("master_isrs", (uint64_t)r.master_isrs);
+    out.field("slave_isrs", (uint64_t)r.slave_isrs);
+    out.field("isrs_per_byte", r.isrs_per_byte());
+    out.field("isrs_per_transaction", r.isrs_per_transaction());
+    out.field("master_register_accesses", (uint64_t)r.master_profile.accesses());
+    out.field("slave_register_accesses", (uint64_t)r.slave_profile.accesses());
+    out.field("register_accesses_per_byte", r.register_accesses_per_byte());
+    out.field("mean_latency_ns", r.mean_latency_ns());
+    out.field("max_latency_ns", r.max_latency_ns);
+    out.end_row();
+}
+
+// One row for each register touched by each ISR cause
+static void write_profile(Output& out, const Result& r) {
+    size_t bytes = r.transactions * r.message_length;
+    const RegisterAccessProfile* profiles[] = {&r.master_profile, &r.slave_profile};
+    const char* port_names[] = {"master", "slave"};
+    for (size_t p = 0; p < 2; p++) {
+        for (size_t c = 0; c < RegisterAccessProfile::num_causes; c++) {
+            auto cause = static_cast<IsrCause>(c);
+            for (size_t i = 0; i < RegisterAccessProfile::num_registers; i++) {
+                auto id = static_cast<LPI2CRegisterId>(i);
+                uint32_t reads = profiles[p]->reads(cause, id);
+                uint32_t writes = profiles[p]->writes(cause, id);
+                if (reads + writes == 0) {
+                    continue;
+                }
+                write_point(out, r);
+                out.field("port", port_names[p]);
+                out.field("cause", to_string(cause));
+                out.field("register", to_string(id));
+                out.field("isr_entries", (uint64_t)profiles[p]->isr_entries(cause));
+                out.field("reads", (uint64_t)reads);
+                out.field("writes", (uint64_t)writes);
+                out.field("reads_per_byte", bytes ? (double)reads / bytes : 0.0);
+                out.field("writes_per_byte", bytes ? (double)writes / bytes : 0.0);
+                out.field("accesses_per_transaction", (double)(reads + writes) / r.transactions);
+                out.end_row();
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    bool profile = false;
+    uint32_t transactions = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--transactions") == 0 && i + 1 < argc) {
+            transactions = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [--json] [--profile] [--transactions N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Output out(json);
+    for (const Layer& layer : layers()) {
+        for (Direction direction : {Direction::write, Direction::read}) {
+            size_t max_length = direction == Direction::write ? layer.max_write_length : layer.max_read_length;
+            for (uint32_t frequency : frequencies) {
+                for (size_t length : message_lengths) {
+                    // A zero length read is just an address probe
+                    if (length > max_length || (length == 0 && direction == Direction::read)) {
+                        continue;
+                    }
+                    uint32_t count = transactions ? transactions : default_transactions(length);
+                    Result result = run(layer, direction, frequency, length, count);
+                    if (profile) {
+                        write_profile(out, result);
+                    } else {
+                        write_result(out, result);
+                    }
+                }
+            }
+        }
+    }
+    out.finish();
+    return 0;
+}
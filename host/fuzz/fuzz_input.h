@@ -0,0 +1,64 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef FUZZ_INPUT_H
+#define FUZZ_INPUT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+// Stops the fuzzer with a message if an invariant doesn't hold.
+// libFuzzer reports abort() as a crash and saves the input.
+#define FUZZ_ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: Invariant failed: %s (%s)\n", __FILE__, __LINE__, message, #condition); \
+            abort(); \
+        } \
+    } while (false)
+
+// Splits the fuzzer's input into values.
+// Returns zeros once the input has been used up.
+class FuzzInput {
+public:
+    FuzzInput(const uint8_t* data, size_t size)
+        : data(data), size(size) {
+    }
+
+    inline bool empty() const { return position >= size; }
+
+    inline uint8_t u8() {
+        return empty() ? 0 : data[position++];
+    }
+
+    inline uint16_t u16() {
+        return (uint16_t)(u8() | (u8() << 8));
+    }
+
+    inline uint32_t u32() {
+        return (uint32_t)u16() | ((uint32_t)u16() << 16);
+    }
+
+    inline bool boolean() {
+        return u8() & 0x01;
+    }
+
+    // A number from 0 to 'max' inclusive
+    inline uint32_t up_to(uint32_t max) {
+        return max == 0 ? 0 : u32() % (max + 1);
+    }
+
+    template<class T, size_t N>
+    inline T choose(const T (&options)[N]) {
+        return options[u8() % N];
+    }
+
+private:
+    const uint8_t* data;
+    const size_t size;
+    size_t position = 0;
+};
+
+#endif //FUZZ_INPUT_H
@@ -0,0 +1,266 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Fuzzes I2CRegisterSlave.
+//
+// I2CRegisterSlave only talks to the bus through its I2CSlave so it runs
+// on FuzzI2CSlave which behaves like IMX_RT1060_I2CSlave without the
+// hardware. The input chooses the register file's layout and options
+// then sends frames with random register numbers and lengths, reads
+// random amounts, updates the read only registers and collects changes.
+//
+// Invariants:
+// * the slave never touches memory outside the buffers it was given
+//   (checked by AddressSanitizer)
+// * it only ever gives the driver buffers that lie inside the register
+//   file or inside itself
+// * the master can't change the read only buffer, read only registers
+//   or bits outside a register's write mask
+// * write 1 to clear registers only ever lose bits
+// * collect_changes() never reports a register that doesn't exist
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "i2c_register_slave.h"
+#include "fuzz_input.h"
+
+#define FUZZ_MAX_REGISTERS 300      // More than a 1 byte register number can reach
+#define FUZZ_MAX_FRAME_LENGTH 64
+
+// Behaves like IMX_RT1060_I2CSlave. It stores each byte in the receive
+// buffer until it's full, then asks for another one and drops the byte
+// if it doesn't get one. Reads past the end of the transmit buffer
+// return 0x00.
+class FuzzI2CSlave : public I2CSlave {
+public:
+    void listen(uint8_t slave_address) override { address = slave_address; }
+    void listen(uint8_t first_address, uint8_t second_address) override {}
+    void listen_range(uint8_t first_address, uint8_t last_address) override {}
+    void stop_listening() override {}
+
+    void after_receive(std::function<void(size_t length, uint16_t address)> callback) override {
+        after_receive_callback = callback;
+    }
+    void before_receive(std::function<void(uint16_t address)> callback) override {}
+    void after_receive_buffer_full(std::function<void(uint16_t address)> callback) override {
+        after_receive_buffer_full_callback = callback;
+    }
+    void before_transmit(std::function<void(uint16_t address)> callback) override {}
+    void after_transmit(std::function<void(uint16_t address)> callback) override {
+        after_transmit_callback = callback;
+    }
+
+    void set_transmit_buffer(const uint8_t* buffer, size_t size) override {
+        FUZZ_ASSERT(size == 0 || allowed(buffer, size), "Transmit buffer is outside the register file");
+        tx_buffer = buffer;
+        tx_size = size;
+    }
+
+    void set_receive_buffer(uint8_t* buffer, size_t size) override {
+        FUZZ_ASSERT(size == 0 || allowed(buffer, size), "Receive buffer is outside the register file");
+        rx_buffer = buffer;
+        rx_size = size;
+        rx_index = 0;
+        rx_rules = nullptr;
+    }
+
+    void set_masked_receive_buffer(uint8_t* buffer, size_t size, const I2CRegisterAccess* rules) override {
+        set_receive_buffer(buffer, size);
+        rx_rules = rules;
+    }
+
+    // The master writes 'frame' then sends a repeated START or STOP.
+    void receive(const uint8_t* frame, size_t length) {
+        bool receiving = false;
+        for (size_t i = 0; i < length; i++) {
+            if (i == 0 && rx_size > 0) {
+                rx_index = 0;
+                receiving = true;
+            }
+            if (rx_size == 0) {
+                receiving = false;
+                continue;
+            }
+            if (rx_index == rx_size && after_receive_buffer_full_callback) {
+                after_receive_buffer_full_callback(address);
+            }
+            if (rx_index < rx_size) {
+                uint8_t value = rx_rules ? rx_rules[rx_index].apply(rx_buffer[rx_index], frame[i]) : frame[i];
+                rx_buffer[rx_index++] = value;
+            }
+        }
+        if (receiving && after_receive_callback) {
+            after_receive_callback(rx_index, address);
+        }
+    }
+
+    // The master reads 'length' bytes then sends a repeated START or STOP.
+    void transmit(size_t length) {
+        volatile uint8_t sink = 0;
+        for (size_t i = 0; i < length; i++) {
+            sink = (i < tx_size) ? tx_buffer[i] : 0x00;
+        }
+        (void)sink;
+        if (after_transmit_callback) {
+            after_transmit_callback(address);
+        }
+    }
+
+    // Memory that the register slave may hand to the driver
+    struct Region {
+        const uint8_t* start;
+        size_t size;
+    };
+    std::vector<Region> regions;
+
+    uint16_t address = 0;
+
+private:
+    uint8_t* rx_buffer = nullptr;
+    size_t rx_size = 0;
+    size_t rx_index = 0;
+    const I2CRegisterAccess* rx_rules = nullptr;
+    const uint8_t* tx_buffer = nullptr;
+    size_t tx_size = 0;
+    std::function<void(size_t length, uint16_t address)> after_receive_callback;
+    std::function<void(uint16_t address)> after_receive_buffer_full_callback;
+    std::function<void(uint16_t address)> after_transmit_callback;
+
+    bool allowed(const uint8_t* buffer, size_t size) const {
+        for (const Region& region : regions) {
+            if (buffer >= region.start && buffer + size <= region.start + region.size) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+static const RegisterAccess access_types[] = {
+    RegisterAccess::read_write, RegisterAccess::read_only,
+    RegisterAccess::write_only, RegisterAccess::write_1_to_clear
+};
+
+enum class Action : uint8_t {
+    write, read, update_read_only, commit, collect_changes,
+    count
+};
+
+// Heap allocations of exactly the requested size so that
+// AddressSanitizer catches any access outside them.
+template<typename T>
+static std::unique_ptr<T[]> allocate(size_t count) {
+    return std::unique_ptr<T[]>(new T[count ? count : 1]());
+}
+
+// Checks that the master didn't break any access rules.
+static void check_registers(const uint8_t* before, const uint8_t* after, size_t size,
+                            const I2CRegisterAccess* access_map) {
+    if (!access_map) {
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        const I2CRegisterAccess& rule = access_map[i];
+        FUZZ_ASSERT((before[i] & ~rule.write_mask) == (after[i] & ~rule.write_mask),
+                    "Master changed a bit outside the write mask");
+        if (rule.access == RegisterAccess::read_only) {
+            FUZZ_ASSERT(before[i] == after[i], "Master changed a read only register");
+        } else if (rule.access == RegisterAccess::write_1_to_clear) {
+            FUZZ_ASSERT((after[i] & ~before[i]) == 0, "Master set a bit in a write 1 to clear register");
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    FuzzInput input(data, size);
+
+    RegisterNumberSize number_size = input.boolean() ? RegisterNumberSize::two_bytes : RegisterNumberSize::one_byte;
+    size_t num_mutable = input.up_to(FUZZ_MAX_REGISTERS);
+    size_t num_read_only = input.up_to(FUZZ_MAX_REGISTERS);
+    auto mutable_buffer = allocate<uint8_t>(num_mutable);
+    auto read_only_buffer = allocate<uint8_t>(num_read_only);
+    auto snapshot_buffer = allocate<uint8_t>(REG_SLAVE_SNAPSHOT_COUNT * num_read_only);
+    auto access_map = allocate<I2CRegisterAccess>(num_mutable);
+    auto dirty = allocate<uint32_t>(REG_SLAVE_DIRTY_WORDS(num_mutable));
+    auto changed = allocate<uint32_t>(REG_SLAVE_DIRTY_WORDS(num_mutable));
+    for (size_t i = 0; i < num_mutable; i++) {
+        mutable_buffer[i] = input.u8();
+        access_map[i] = {input.choose(access_types), input.u8()};
+    }
+    for (size_t i = 0; i < num_read_only; i++) {
+        read_only_buffer[i] = input.u8();
+    }
+    auto shadow_read_only = allocate<uint8_t>(num_read_only);
+    memcpy(shadow_read_only.get(), read_only_buffer.get(), num_read_only);
+
+    FuzzI2CSlave slave;
+    I2CRegisterSlave registers(slave, mutable_buffer.get(), num_mutable,
+                               read_only_buffer.get(), num_read_only, number_size);
+    const I2CRegisterAccess* rules = input.boolean() ? access_map.get() : nullptr;
+    if (rules) {
+        registers.set_access_map(rules);
+    }
+    bool snapshots = input.boolean();
+    if (snapshots) {
+        registers.enable_snapshots(snapshot_buffer.get());
+    }
+    bool tracking = input.boolean();
+    if (tracking) {
+        registers.track_changes(dirty.get());
+    }
+    // The register slave's own buffers are inside the object
+    slave.regions = {
+        {mutable_buffer.get(), num_mutable},
+        {read_only_buffer.get(), num_read_only},
+        {snapshot_buffer.get(), REG_SLAVE_SNAPSHOT_COUNT * num_read_only},
+        {reinterpret_cast<const uint8_t*>(&registers), sizeof(registers)}
+    };
+    registers.listen(0x40);
+
+    auto before = allocate<uint8_t>(num_mutable);
+    while (!input.empty()) {
+        auto action = static_cast<Action>(input.u8() % static_cast<uint8_t>(Action::count));
+        switch (action) {
+            case Action::write: {
+                uint8_t frame[FUZZ_MAX_FRAME_LENGTH];
+                size_t length = input.up_to(sizeof(frame));
+                for (size_t i = 0; i < length; i++) {
+                    frame[i] = input.u8();
+                }
+                memcpy(before.get(), mutable_buffer.get(), num_mutable);
+                slave.receive(frame, length);
+                check_registers(before.get(), mutable_buffer.get(), num_mutable, rules);
+                break;
+            }
+            case Action::read:
+                slave.transmit(input.up_to(FUZZ_MAX_FRAME_LENGTH));
+                break;
+            case Action::update_read_only:
+                if (num_read_only > 0) {
+                    size_t i = input.up_to(num_read_only - 1);
+                    read_only_buffer[i] = shadow_read_only[i] = input.u8();
+                }
+                break;
+            case Action::commit:
+                registers.commit();
+                break;
+            case Action::collect_changes: {
+                bool any = registers.collect_changes(changed.get());
+                FUZZ_ASSERT(tracking || !any, "collect_changes() reported changes without tracking");
+                if (tracking && num_mutable % 32 != 0) {
+                    uint32_t unused = ~((1UL << (num_mutable % 32)) - 1);
+                    FUZZ_ASSERT((changed[num_mutable / 32] & unused) == 0,
+                                "collect_changes() reported a register that doesn't exist");
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        FUZZ_ASSERT(memcmp(read_only_buffer.get(), shadow_read_only.get(), num_read_only) == 0,
+                    "Master changed the read only buffer");
+    }
+    return 0;
+}
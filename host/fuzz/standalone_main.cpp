@@ -0,0 +1,91 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Runs a fuzz target without libFuzzer. e.g. When building with GCC.
+// It understands a few of libFuzzer's options so the same command
+// line works with both.
+//
+//   fuzz_target FILE...                     Runs each file once.
+//   fuzz_target -runs=N -seed=S -max_len=L  Runs N random inputs.
+//
+// It doesn't learn from coverage so it's much less effective than
+// libFuzzer. Use it for smoke tests and to replay crashes. If a random
+// input crashes the target, it's saved to 'crash-standalone'.
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static std::vector<uint8_t> input;
+
+static void save_input(int signal) {
+    FILE* out = fopen("crash-standalone", "wb");
+    if (out) {
+        fwrite(input.data(), 1, input.size(), out);
+        fclose(out);
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+static bool option(const char* arg, const char* name, unsigned long& value) {
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0) {
+        return false;
+    }
+    value = strtoul(arg + length, nullptr, 10);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long runs = 1000;
+    unsigned long seed = 1;
+    unsigned long max_len = 512;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (!option(argv[i], "-runs=", runs) &&
+            !option(argv[i], "-seed=", seed) &&
+            !option(argv[i], "-max_len=", max_len)) {
+            if (argv[i][0] == '-') {
+                fprintf(stderr, "Ignoring unsupported option %s\n", argv[i]);
+            } else {
+                files.push_back(argv[i]);
+            }
+        }
+    }
+
+    if (!files.empty()) {
+        for (const char* file : files) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) {
+                fprintf(stderr, "Can't read %s\n", file);
+                return 1;
+            }
+            std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            fprintf(stderr, "Running %s (%zu bytes)\n", file, data.size());
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+        }
+        return 0;
+    }
+
+    std::signal(SIGABRT, save_input);
+    std::signal(SIGSEGV, save_input);
+    std::mt19937 random(seed);
+    for (unsigned long run = 0; run < runs; run++) {
+        input.resize(random() % (max_len + 1));
+        for (auto& b : input) {
+            b = (uint8_t)random();
+        }
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    fprintf(stderr, "Done %lu runs\n", runs);
+    return 0;
+}
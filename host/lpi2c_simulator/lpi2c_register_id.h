@@ -0,0 +1,17 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef LPI2C_REGISTER_ID_H
+#define LPI2C_REGISTER_ID_H
+
+#include <cstdint>
+
+// Identifies a register in an LPI2C register block.
+enum class LPI2CRegisterId : uint8_t {
+    VERID, PARAM,
+    MCR, MSR, MIER, MDER, MCFGR0, MCFGR1, MCFGR2, MCFGR3, MDMR, MCCR0, MCCR1, MFCR, MFSR, MTDR, MRDR,
+    SCR, SSR, SIER, SDER, SCFGR1, SCFGR2, SAMR, SASR, STAR, STDR, SRDR,
+    count   // The number of registers. Not a register.
+};
+
+#endif //LPI2C_REGISTER_ID_H
@@ -0,0 +1,209 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <algorithm>
+#include <imxrt.h>
+#include "lpi2c_simulator.h"
+
+// The ports must be constructed before the simulator.
+SimulatedLPI2C simulated_lpi2c1(0, IRQ_LPI2C1);
+SimulatedLPI2C simulated_lpi2c2(1, IRQ_LPI2C2);
+SimulatedLPI2C simulated_lpi2c3(2, IRQ_LPI2C3);
+SimulatedLPI2C simulated_lpi2c4(3, IRQ_LPI2C4);
+
+LPI2CSimulator lpi2c_simulator;
+
+LPI2CSimulator::LPI2CSimulator()
+    : ports{&simulated_lpi2c1, &simulated_lpi2c2, &simulated_lpi2c3, &simulated_lpi2c4} {
+    for (size_t i = 0; i < LPI2C_SIMULATOR_NUM_PORTS; i++) {
+        buses[i].add(ports[i]);
+    }
+}
+
+SimulatedLPI2C& LPI2CSimulator::port(uint8_t index) {
+    return *ports[index];
+}
+
+void LPI2CSimulator::reset() {
+    isr_running = false;
+    running_isr_cause = IsrCause::main;
+    for (auto port : ports) {
+        port->reset();
+    }
+    for (size_t i = 0; i < LPI2C_SIMULATOR_NUM_PORTS; i++) {
+        buses[i].reset();
+        buses[i].add(ports[i]);
+        vectors[i] = nullptr;
+        irq_enabled[i] = false;
+    }
+    now = 0;
+    storm_count = 0;
+    quiet_until = 0;
+}
+
+void LPI2CSimulator::connect(SimulatedLPI2C& a, SimulatedLPI2C& b) {
+    SimulatedI2CBus& from = b.bus();
+    SimulatedI2CBus& to = a.bus();
+    if (&from == &to) {
+        return;
+    }
+    while (from.num_ports() > 0) {
+        SimulatedLPI2C* port = from.port(0);
+        from.remove(port);
+        to.add(port);
+    }
+    quiet_until = 0;
+}
+
+void LPI2CSimulator::advance(uint64_t duration_ns) {
+    uint64_t target = now + duration_ns;
+    if (target < quiet_until) {
+        now = target;
+        return;
+    }
+    while (true) {
+        uint64_t next = next_event_ns();
+        if (next > target) {
+            break;
+        }
+        now = std::max(now + 1, next);
+        sync();
+    }
+    // ISRs take time so we may already be past the target
+    now = std::max(now, target);
+    sync();
+}
+
+bool LPI2CSimulator::run_until(const std::function<bool()>& done, uint64_t timeout_ns) {
+    uint64_t deadline = now + timeout_ns;
+    while (!done()) {
+        if (now >= deadline) {
+            return false;
+        }
+        uint64_t next = std::min(next_event_ns(), deadline);
+        advance(next > now ? next - now : 1);
+    }
+    return true;
+}
+
+void LPI2CSimulator::attach_interrupt_vector(int irq, void (* isr)()) {
+    int index = port_for_irq(irq);
+    if (index >= 0) {
+        vectors[index] = isr;
+        quiet_until = 0;
+    }
+}
+
+void LPI2CSimulator::enable_irq(int irq, bool enable) {
+    int index = port_for_irq(irq);
+    if (index >= 0) {
+        irq_enabled[index] = enable;
+        sync();
+    }
+}
+
+// Skips sync() when nothing can have happened since the last one.
+// Polling loops like "while (!master.finished()) {}" spend most of
+// their time here.
+void LPI2CSimulator::before_register_access() {
+    now += timing.register_access_ns;
+    if (now < quiet_until) {
+        return;
+    }
+    sync();
+}
+
+void LPI2CSimulator::after_register_access(bool changed_state) {
+    if (!changed_state && now < quiet_until) {
+        return;
+    }
+    sync();
+}
+
+int LPI2CSimulator::port_for_irq(int irq) const {
+    for (int i = 0; i < LPI2C_SIMULATOR_NUM_PORTS; i++) {
+        if (ports[i]->irq() == irq) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Moves every master on to the current time. One master may be waiting
+// for another to release the bus so keep going until nothing changes.
+void LPI2CSimulator::process() {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto port : ports) {
+            progress |= port->step_master(now);
+        }
+    }
+    for (auto port : ports) {
+        port->check_pin_low_timeout(now);
+    }
+}
+
+// Calls the ISR of any port with a pending interrupt. ISRs don't nest.
+// Returns false if an interrupt may still be pending.
+bool LPI2CSimulator::service_interrupts() {
+    if (isr_running) {
+        return false;
+    }
+    uint32_t consecutive_isrs = 0;
+    while (true) {
+        int index = -1;
+        for (int i = 0; i < LPI2C_SIMULATOR_NUM_PORTS; i++) {
+            if (irq_enabled[i] && vectors[i] && ports[i]->interrupt_pending()) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) {
+            return true;
+        }
+        if (++consecutive_isrs > LPI2C_SIMULATOR_MAX_CONSECUTIVE_ISRS) {
+            storm_count++;
+            return false;
+        }
+        run_isr(index, ports[index]->pending_isr_cause());
+    }
+}
+
+void LPI2CSimulator::run_isr(int index, IsrCause cause) {
+    isr_running = true;
+    running_isr_cause = cause;
+    ports[index]->stats.isr_entries++;
+    ports[index]->profile.record_isr(cause);
+    now += timing.isr_entry_ns;
+    process();
+    vectors[index]();
+    isr_running = false;
+    running_isr_cause = IsrCause::main;
+    process();
+}
+
+void LPI2CSimulator::call_isr(SimulatedLPI2C& port) {
+    int index = port_for_irq(port.irq());
+    if (isr_running || index < 0 || !vectors[index]) {
+        return;
+    }
+    run_isr(index, port.pending_isr_cause());
+    sync();
+}
+
+void LPI2CSimulator::sync() {
+    quiet_until = 0;
+    process();
+    if (service_interrupts()) {
+        quiet_until = next_event_ns();
+    }
+}
+
+uint64_t LPI2CSimulator::next_event_ns() const {
+    uint64_t next = UINT64_MAX;
+    for (auto port : ports) {
+        next = std::min(next, port->next_event_ns());
+    }
+    return next;
+}
@@ -0,0 +1,112 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef LPI2C_SIMULATOR_H
+#define LPI2C_SIMULATOR_H
+
+#include <cstdint>
+#include <functional>
+#include "simulated_lpi2c.h"
+#include "simulated_i2c_bus.h"
+
+#define LPI2C_SIMULATOR_NUM_PORTS 4
+
+// The number of ISR calls in a row before the simulator decides
+// that an interrupt flag is stuck and lets the main code run.
+#define LPI2C_SIMULATOR_MAX_CONSECUTIVE_ISRS 1000
+
+// Runs the driver against simulated LPI2C peripherals on the host.
+//
+// The simulator keeps its own clock. Time only moves forward when the
+// code under test touches a register, when an ISR is entered or when
+// advance() is called. This makes runs repeatable and lets benchmarks
+// measure bytes per second, ISR counts and latency without hardware.
+//
+// Interrupts are dispatched whenever the main code touches a register
+// so loops like "while (!master.finished()) {}" behave as they do on
+// the Teensy. ISRs don't nest.
+class LPI2CSimulator {
+public:
+    // Knobs for the timing model
+    struct Timing {
+        uint32_t lpi2c_clock_hz = 60'000'000;   // The driver's default clock
+        uint32_t rise_time_ns = 0;              // Stretches the SCL high time. See TeensyConfig.
+        uint32_t register_access_ns = 20;       // The cost of each register read or write
+        uint32_t isr_entry_ns = 100;            // The cost of entering and leaving an ISR
+    };
+
+    LPI2CSimulator();
+
+    // The timing model. Change it before starting a transfer.
+    Timing timing;
+
+    // Port 0 is LPI2C1, port 1 is LPI2C2 etc.
+    SimulatedLPI2C& port(uint8_t index);
+
+    // Puts every port in its power on state, disconnects them
+    // from each other and resets the clock. Keeps the timing model.
+    void reset();
+
+    // Joins the pins of two ports so they're on the same bus.
+    // e.g. connect(simulated_lpi2c1, simulated_lpi2c3) lets Master talk to Slave1
+    void connect(SimulatedLPI2C& a, SimulatedLPI2C& b);
+
+    // The simulated time in nanoseconds since the last reset.
+    inline uint64_t now_ns() const { return now; }
+
+    // Lets time pass without touching a register. e.g. To simulate the
+    // main loop doing something else. Interrupts fire as they fall due.
+    void advance(uint64_t duration_ns);
+
+    // Runs until 'done' returns true or 'timeout_ns' has passed.
+    // Returns false if it timed out.
+    bool run_until(const std::function<bool()>& done, uint64_t timeout_ns);
+
+    // Calls the ISR attached to 'port' even if none of its flags are set.
+    // Lets the fuzz tests check that the driver copes with spurious
+    // interrupts. Does nothing if an ISR is already running.
+    void call_isr(SimulatedLPI2C& port);
+
+    // True while an ISR is running
+    inline bool in_isr() const { return isr_running; }
+
+    // Why the running ISR was called. IsrCause::main if there isn't one.
+    // Used to break down SimulatedLPI2C::profile.
+    inline IsrCause isr_cause() const { return running_isr_cause; }
+
+    // The number of times the simulator gave up on an ISR that kept
+    // firing without making progress.
+    inline uint32_t interrupt_storms() const { return storm_count; }
+
+    // Called by the imxrt.h shim
+    void attach_interrupt_vector(int irq, void (*isr)());
+    void enable_irq(int irq, bool enable);
+
+    // Called by the simulated ports
+    void before_register_access();
+    void after_register_access(bool changed_state = true);
+
+private:
+    SimulatedLPI2C* ports[LPI2C_SIMULATOR_NUM_PORTS];
+    SimulatedI2CBus buses[LPI2C_SIMULATOR_NUM_PORTS];
+    void (*vectors[LPI2C_SIMULATOR_NUM_PORTS])() = {};
+    bool irq_enabled[LPI2C_SIMULATOR_NUM_PORTS] = {};
+    uint64_t now = 0;
+    bool isr_running = false;
+    IsrCause running_isr_cause = IsrCause::main;
+    uint32_t storm_count = 0;
+    // Until this time, sync() has nothing to do unless software changes
+    // the state of a port. Zero if sync() must run.
+    uint64_t quiet_until = 0;
+
+    int port_for_irq(int irq) const;
+    void process();
+    bool service_interrupts();
+    void run_isr(int index, IsrCause cause);
+    void sync();
+    uint64_t next_event_ns() const;
+};
+
+extern LPI2CSimulator lpi2c_simulator;
+
+#endif //LPI2C_SIMULATOR_H
@@ -0,0 +1,82 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <imxrt.h>
+#include "register_access_profile.h"
+
+static const char* const cause_names[] = {
+    "main",
+    "master_error", "master_end", "master_receive", "master_transmit",
+    "slave_error", "slave_end", "slave_address", "slave_receive", "slave_transmit",
+    "other"
+};
+static_assert(sizeof(cause_names) / sizeof(cause_names[0]) == RegisterAccessProfile::num_causes,
+              "Every IsrCause needs a name");
+
+static const char* const register_names[] = {
+    "VERID", "PARAM",
+    "MCR", "MSR", "MIER", "MDER", "MCFGR0", "MCFGR1", "MCFGR2", "MCFGR3", "MDMR", "MCCR0", "MCCR1", "MFCR", "MFSR", "MTDR", "MRDR",
+    "SCR", "SSR", "SIER", "SDER", "SCFGR1", "SCFGR2", "SAMR", "SASR", "STAR", "STDR", "SRDR"
+};
+static_assert(sizeof(register_names) / sizeof(register_names[0]) == RegisterAccessProfile::num_registers,
+              "Every LPI2CRegisterId needs a name");
+
+const char* to_string(IsrCause cause) {
+    return cause < IsrCause::count ? cause_names[static_cast<size_t>(cause)] : "?";
+}
+
+const char* to_string(LPI2CRegisterId id) {
+    return id < LPI2CRegisterId::count ? register_names[static_cast<size_t>(id)] : "?";
+}
+
+IsrCause isr_cause(uint32_t master_flags, uint32_t slave_flags) {
+    if (master_flags & (LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF | LPI2C_MSR_PLTF)) {
+        return IsrCause::master_error;
+    }
+    if (master_flags & (LPI2C_MSR_SDF | LPI2C_MSR_EPF)) {
+        return IsrCause::master_end;
+    }
+    if (master_flags & LPI2C_MSR_RDF) {
+        return IsrCause::master_receive;
+    }
+    if (master_flags & LPI2C_MSR_TDF) {
+        return IsrCause::master_transmit;
+    }
+    if (slave_flags & (LPI2C_SSR_BEF | LPI2C_SSR_FEF)) {
+        return IsrCause::slave_error;
+    }
+    if (slave_flags & (LPI2C_SSR_SDF | LPI2C_SSR_RSF)) {
+        return IsrCause::slave_end;
+    }
+    if (slave_flags & (LPI2C_SSR_AVF | LPI2C_SSR_TAF | LPI2C_SSR_AM0F | LPI2C_SSR_AM1F | LPI2C_SSR_GCF | LPI2C_SSR_SARF)) {
+        return IsrCause::slave_address;
+    }
+    if (slave_flags & LPI2C_SSR_RDF) {
+        return IsrCause::slave_receive;
+    }
+    if (slave_flags & LPI2C_SSR_TDF) {
+        return IsrCause::slave_transmit;
+    }
+    return IsrCause::other;
+}
+
+uint32_t RegisterAccessProfile::accesses(IsrCause cause) const {
+    uint32_t total = 0;
+    size_t c = static_cast<size_t>(cause);
+    for (size_t r = 0; r < num_registers; r++) {
+        total += read_counts[c][r] + write_counts[c][r];
+    }
+    return total;
+}
+
+uint32_t RegisterAccessProfile::accesses() const {
+    uint32_t total = 0;
+    for (size_t c = 0; c < num_causes; c++) {
+        total += accesses(static_cast<IsrCause>(c));
+    }
+    return total;
+}
+
+void RegisterAccessProfile::reset() {
+    *this = RegisterAccessProfile();
+}
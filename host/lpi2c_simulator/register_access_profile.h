@@ -0,0 +1,83 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef REGISTER_ACCESS_PROFILE_H
+#define REGISTER_ACCESS_PROFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "lpi2c_register_id.h"
+
+// Why the code that touched a register was running. The simulator
+// picks the cause from the enabled flags that were set when it entered
+// the ISR. If several were set, the first in this list wins.
+enum class IsrCause : uint8_t {
+    main = 0,           // Not in an ISR
+    master_error,       // NDF, ALF, FEF or PLTF
+    master_end,         // SDF or EPF
+    master_receive,     // RDF
+    master_transmit,    // TDF
+    slave_error,        // BEF or FEF
+    slave_end,          // SDF or RSF
+    slave_address,      // AVF, TAF, AM0F, AM1F, GCF or SARF
+    slave_receive,      // RDF
+    slave_transmit,     // TDF
+    other,              // Something that the profile doesn't know about
+    count   // The number of causes. Not a cause.
+};
+
+const char* to_string(IsrCause cause);
+const char* to_string(LPI2CRegisterId id);
+
+// Chooses the cause of an ISR call from the flags that are set and enabled.
+IsrCause isr_cause(uint32_t master_flags, uint32_t slave_flags);
+
+// Counts the register reads and writes made by the driver broken down by
+// register and by ISR cause. Reads of the peripheral are slow on the
+// i.MX RT so accesses per byte transferred is a hardware independent
+// measure of how expensive the driver's ISRs are.
+class RegisterAccessProfile {
+public:
+    static const size_t num_registers = static_cast<size_t>(LPI2CRegisterId::count);
+    static const size_t num_causes = static_cast<size_t>(IsrCause::count);
+
+    inline void record_read(IsrCause cause, LPI2CRegisterId id) {
+        read_counts[static_cast<size_t>(cause)][static_cast<size_t>(id)]++;
+    }
+
+    inline void record_write(IsrCause cause, LPI2CRegisterId id) {
+        write_counts[static_cast<size_t>(cause)][static_cast<size_t>(id)]++;
+    }
+
+    inline void record_isr(IsrCause cause) {
+        isr_counts[static_cast<size_t>(cause)]++;
+    }
+
+    inline uint32_t reads(IsrCause cause, LPI2CRegisterId id) const {
+        return read_counts[static_cast<size_t>(cause)][static_cast<size_t>(id)];
+    }
+
+    inline uint32_t writes(IsrCause cause, LPI2CRegisterId id) const {
+        return write_counts[static_cast<size_t>(cause)][static_cast<size_t>(id)];
+    }
+
+    // ISR calls for 'cause'. Always 0 for IsrCause::main.
+    inline uint32_t isr_entries(IsrCause cause) const {
+        return isr_counts[static_cast<size_t>(cause)];
+    }
+
+    // Reads plus writes made for 'cause'
+    uint32_t accesses(IsrCause cause) const;
+
+    // Reads plus writes of every register for every cause
+    uint32_t accesses() const;
+
+    void reset();
+
+private:
+    uint32_t read_counts[num_causes][num_registers] = {};
+    uint32_t write_counts[num_causes][num_registers] = {};
+    uint32_t isr_counts[num_causes] = {};
+};
+
+#endif //REGISTER_ACCESS_PROFILE_H
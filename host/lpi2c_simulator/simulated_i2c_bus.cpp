@@ -0,0 +1,80 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <imxrt.h>
+#include "simulated_i2c_bus.h"
+#include "simulated_lpi2c.h"
+
+void SimulatedI2CBus::add(SimulatedLPI2C* port) {
+    if (port_count < SIMULATED_I2C_BUS_MAX_PORTS) {
+        ports[port_count++] = port;
+        port->connected_bus = this;
+    }
+}
+
+void SimulatedI2CBus::remove(SimulatedLPI2C* port) {
+    for (size_t i = 0; i < port_count; i++) {
+        if (ports[i] == port) {
+            ports[i] = ports[--port_count];
+            break;
+        }
+    }
+    if (owner == port) {
+        owner = nullptr;
+    }
+}
+
+bool SimulatedI2CBus::busy(uint64_t now_ns) const {
+    return owner != nullptr || now_ns < free_at_ns;
+}
+
+// Returns false if another master owns the bus.
+bool SimulatedI2CBus::acquire(SimulatedLPI2C* master) {
+    if (owner != nullptr && owner != master) {
+        return false;
+    }
+    owner = master;
+    return true;
+}
+
+// Returns the slave that ACKs the address or nullptr if nobody does.
+SimulatedLPI2C* SimulatedI2CBus::address(SimulatedLPI2C* master, uint8_t address_byte) {
+    uint8_t address = address_byte >> 1;
+    for (size_t i = 0; i < port_count; i++) {
+        SimulatedLPI2C* port = ports[i];
+        if (port == master || !port->slave_enabled() || !port->slave_matches(address)) {
+            continue;
+        }
+        uint32_t addr0 = (port->samr >> 1) & 0x7F;
+        bool second_address = ((port->scfgr1 >> 16) & 0x07) == 2 && address != addr0;
+        port->slave_address_matched(address_byte, second_address);
+        return port;
+    }
+    return nullptr;
+}
+
+void SimulatedI2CBus::repeated_start(SimulatedLPI2C* master) {
+    for (size_t i = 0; i < port_count; i++) {
+        if (ports[i] != master) {
+            ports[i]->slave_end_of_frame(LPI2C_SSR_RSF);
+        }
+    }
+}
+
+void SimulatedI2CBus::release(SimulatedLPI2C* master, uint64_t stop_ns, uint64_t bus_free_ns) {
+    for (size_t i = 0; i < port_count; i++) {
+        if (ports[i] != master) {
+            ports[i]->slave_end_of_frame(LPI2C_SSR_SDF);
+        }
+    }
+    if (owner == master) {
+        owner = nullptr;
+    }
+    free_at_ns = stop_ns + bus_free_ns;
+}
+
+void SimulatedI2CBus::reset() {
+    port_count = 0;
+    owner = nullptr;
+    free_at_ns = 0;
+}
@@ -0,0 +1,47 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef SIMULATED_I2C_BUS_H
+#define SIMULATED_I2C_BUS_H
+
+#include <cstdint>
+#include <cstddef>
+
+class SimulatedLPI2C;
+
+#define SIMULATED_I2C_BUS_MAX_PORTS 4
+
+// A virtual I2C bus that joins the pins of several simulated ports.
+// Masters take turns. A master that wants to send START waits until
+// the bus has been free for the bus free time.
+class SimulatedI2CBus {
+public:
+    void add(SimulatedLPI2C* port);
+    void remove(SimulatedLPI2C* port);
+
+    inline size_t num_ports() const { return port_count; }
+    inline SimulatedLPI2C* port(size_t index) const { return ports[index]; }
+
+    // True if a master owns the bus or the bus free time hasn't elapsed.
+    bool busy(uint64_t now_ns) const;
+
+    // Called by masters
+    bool acquire(SimulatedLPI2C* master);
+    SimulatedLPI2C* address(SimulatedLPI2C* master, uint8_t address_byte);
+    void repeated_start(SimulatedLPI2C* master);
+    void release(SimulatedLPI2C* master, uint64_t stop_ns, uint64_t bus_free_ns);
+
+    // Disconnects every port. Used when the simulator is reset.
+    void reset();
+
+    // The earliest time the bus becomes free. For the simulator's event queue.
+    inline uint64_t free_at() const { return free_at_ns; }
+
+private:
+    SimulatedLPI2C* ports[SIMULATED_I2C_BUS_MAX_PORTS] = {};
+    size_t port_count = 0;
+    SimulatedLPI2C* owner = nullptr;
+    uint64_t free_at_ns = 0;
+};
+
+#endif //SIMULATED_I2C_BUS_H
@@ -0,0 +1,645 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <algorithm>
+#include <cmath>
+#include <imxrt.h>
+#include "simulated_lpi2c.h"
+#include "simulated_i2c_bus.h"
+#include "lpi2c_simulator.h"
+
+// Flags in MSR and SSR that software clears by writing a 1 to them
+#define MSR_W1C_FLAGS (LPI2C_MSR_DMF | LPI2C_MSR_PLTF | LPI2C_MSR_FEF | LPI2C_MSR_ALF | \
+                       LPI2C_MSR_NDF | LPI2C_MSR_SDF | LPI2C_MSR_EPF)
+#define SSR_W1C_FLAGS (LPI2C_SSR_FEF | LPI2C_SSR_BEF | LPI2C_SSR_SDF | LPI2C_SSR_RSF)
+
+// The master stops processing commands until software clears these
+#define MSR_HALT_FLAGS (LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF)
+
+#define MFSR_TXCOUNT(n) ((uint32_t)(((n) & 0x07) << 0))
+#define MFSR_RXCOUNT(n) ((uint32_t)(((n) & 0x07) << 16))
+
+// Same as the values on a real i.MX RT1062
+#define SIMULATED_VERID 0x01000003
+#define SIMULATED_PARAM 0x00000202  // 4 word transmit and receive FIFOs
+
+// Fraction of the rise time before the Teensy sees a high signal. See teensy_config.py.
+#define TIME_TO_RISE_TO_TEENSY_TRIGGER_VOLTAGE 0.911
+
+IMXRT_LPI2C_Registers::IMXRT_LPI2C_Registers(SimulatedLPI2C& port)
+    : VERID(port, LPI2CRegisterId::VERID), PARAM(port, LPI2CRegisterId::PARAM),
+      MCR(port, LPI2CRegisterId::MCR), MSR(port, LPI2CRegisterId::MSR),
+      MIER(port, LPI2CRegisterId::MIER), MDER(port, LPI2CRegisterId::MDER),
+      MCFGR0(port, LPI2CRegisterId::MCFGR0), MCFGR1(port, LPI2CRegisterId::MCFGR1),
+      MCFGR2(port, LPI2CRegisterId::MCFGR2), MCFGR3(port, LPI2CRegisterId::MCFGR3),
+      MDMR(port, LPI2CRegisterId::MDMR), MCCR0(port, LPI2CRegisterId::MCCR0),
+      MCCR1(port, LPI2CRegisterId::MCCR1), MFCR(port, LPI2CRegisterId::MFCR),
+      MFSR(port, LPI2CRegisterId::MFSR), MTDR(port, LPI2CRegisterId::MTDR),
+      MRDR(port, LPI2CRegisterId::MRDR),
+      SCR(port, LPI2CRegisterId::SCR), SSR(port, LPI2CRegisterId::SSR),
+      SIER(port, LPI2CRegisterId::SIER), SDER(port, LPI2CRegisterId::SDER),
+      SCFGR1(port, LPI2CRegisterId::SCFGR1), SCFGR2(port, LPI2CRegisterId::SCFGR2),
+      SAMR(port, LPI2CRegisterId::SAMR), SASR(port, LPI2CRegisterId::SASR),
+      STAR(port, LPI2CRegisterId::STAR), STDR(port, LPI2CRegisterId::STDR),
+      SRDR(port, LPI2CRegisterId::SRDR) {
+}
+
+SimulatedLPI2C::SimulatedLPI2C(uint8_t index, int irq)
+    : registers(*this), port_index(index), irq_number(irq) {
+}
+
+uint32_t SimulatedLPI2C::read(LPI2CRegisterId id) {
+    lpi2c_simulator.before_register_access();
+    stats.register_reads++;
+    profile.record_read(lpi2c_simulator.isr_cause(), id);
+    uint32_t value = peek(id);
+    bool changed_state = true;
+    switch (id) {
+        case LPI2CRegisterId::MRDR:
+            if (!rx_fifo.empty()) {
+                rx_fifo.pop();
+            }
+            break;
+        case LPI2CRegisterId::SASR:
+            slave_flags &= ~LPI2C_SSR_AVF;
+            break;
+        case LPI2CRegisterId::SRDR:
+            srdr_full = false;
+            break;
+        default:
+            changed_state = false;
+            break;
+    }
+    lpi2c_simulator.after_register_access(changed_state);
+    return value;
+}
+
+void SimulatedLPI2C::write(LPI2CRegisterId id, uint32_t value) {
+    lpi2c_simulator.before_register_access();
+    stats.register_writes++;
+    profile.record_write(lpi2c_simulator.isr_cause(), id);
+    switch (id) {
+        case LPI2CRegisterId::MCR: write_mcr(value); break;
+        case LPI2CRegisterId::MSR: master_flags &= ~(value & MSR_W1C_FLAGS); break;
+        case LPI2CRegisterId::MIER: mier = value; break;
+        case LPI2CRegisterId::MDER: mder = value; break;
+        case LPI2CRegisterId::MCFGR0: mcfgr0 = value; break;
+        case LPI2CRegisterId::MCFGR1: mcfgr1 = value; break;
+        case LPI2CRegisterId::MCFGR2: mcfgr2 = value; break;
+        case LPI2CRegisterId::MCFGR3: mcfgr3 = value; break;
+        case LPI2CRegisterId::MDMR: mdmr = value; break;
+        case LPI2CRegisterId::MCCR0: mccr0 = value; break;
+        case LPI2CRegisterId::MCCR1: mccr1 = value; break;
+        case LPI2CRegisterId::MFCR: mfcr = value; break;
+        case LPI2CRegisterId::MTDR:
+            // The hardware ignores writes to a full FIFO.
+            tx_fifo.push(Command{static_cast<uint16_t>(value & 0x7FF), lpi2c_simulator.now_ns()});
+            break;
+        case LPI2CRegisterId::SCR: write_scr(value); break;
+        case LPI2CRegisterId::SSR: slave_flags &= ~(value & SSR_W1C_FLAGS); break;
+        case LPI2CRegisterId::SIER: sier = value; break;
+        case LPI2CRegisterId::SDER: sder = value; break;
+        case LPI2CRegisterId::SCFGR1: scfgr1 = value; break;
+        case LPI2CRegisterId::SCFGR2: scfgr2 = value; break;
+        case LPI2CRegisterId::SAMR: samr = value; break;
+        case LPI2CRegisterId::STAR: star = value; break;
+        case LPI2CRegisterId::STDR:
+            stdr = value & 0xFF;
+            stdr_full = true;
+            break;
+        default:
+            // Read only
+            break;
+    }
+    lpi2c_simulator.after_register_access();
+}
+
+uint32_t SimulatedLPI2C::peek(LPI2CRegisterId id) const {
+    switch (id) {
+        case LPI2CRegisterId::VERID: return SIMULATED_VERID;
+        case LPI2CRegisterId::PARAM: return SIMULATED_PARAM;
+        case LPI2CRegisterId::MCR: return mcr;
+        case LPI2CRegisterId::MSR: return master_status();
+        case LPI2CRegisterId::MIER: return mier;
+        case LPI2CRegisterId::MDER: return mder;
+        case LPI2CRegisterId::MCFGR0: return mcfgr0;
+        case LPI2CRegisterId::MCFGR1: return mcfgr1;
+        case LPI2CRegisterId::MCFGR2: return mcfgr2;
+        case LPI2CRegisterId::MCFGR3: return mcfgr3;
+        case LPI2CRegisterId::MDMR: return mdmr;
+        case LPI2CRegisterId::MCCR0: return mccr0;
+        case LPI2CRegisterId::MCCR1: return mccr1;
+        case LPI2CRegisterId::MFCR: return mfcr;
+        case LPI2CRegisterId::MFSR: return MFSR_TXCOUNT(tx_fifo.count()) | MFSR_RXCOUNT(rx_fifo.count());
+        case LPI2CRegisterId::MRDR: return rx_fifo.empty() ? LPI2C_MRDR_RXEMPTY : rx_fifo.front();
+        case LPI2CRegisterId::SCR: return scr;
+        case LPI2CRegisterId::SSR: return slave_status();
+        case LPI2CRegisterId::SIER: return sier;
+        case LPI2CRegisterId::SDER: return sder;
+        case LPI2CRegisterId::SCFGR1: return scfgr1;
+        case LPI2CRegisterId::SCFGR2: return scfgr2;
+        case LPI2CRegisterId::SAMR: return samr;
+        case LPI2CRegisterId::SASR: return (slave_flags & LPI2C_SSR_AVF) ? sasr : (sasr | LPI2C_SASR_ANV);
+        case LPI2CRegisterId::STAR: return star;
+        case LPI2CRegisterId::SRDR: return srdr_full ? srdr : LPI2C_SRDR_RXEMPTY;
+        default:
+            // Write only
+            return 0;
+    }
+}
+
+bool SimulatedLPI2C::interrupt_pending() const {
+    return (master_status() & mier) || (slave_status() & sier);
+}
+
+void SimulatedLPI2C::inject_master_flags(uint32_t flags) {
+    const uint32_t errors = LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF | LPI2C_MSR_PLTF;
+    master_flags |= flags & (LPI2C_MSR_EPF | LPI2C_MSR_DMF);
+    if (flags & errors) {
+        halt_with_error(flags & errors, lpi2c_simulator.now_ns());
+    }
+    lpi2c_simulator.after_register_access();
+}
+
+void SimulatedLPI2C::inject_slave_flags(uint32_t flags) {
+    slave_flags |= flags & (LPI2C_SSR_RSF | LPI2C_SSR_SDF | LPI2C_SSR_BEF | LPI2C_SSR_FEF
+                            | LPI2C_SSR_AVF | LPI2C_SSR_AM0F | LPI2C_SSR_AM1F | LPI2C_SSR_TAF);
+    lpi2c_simulator.after_register_access();
+}
+
+IsrCause SimulatedLPI2C::pending_isr_cause() const {
+    return ::isr_cause(master_status() & mier, slave_status() & sier);
+}
+
+void SimulatedLPI2C::reset() {
+    reset_master();
+    reset_slave();
+    mcr = 0;
+    scr = 0;
+    stats = Stats();
+    profile.reset();
+}
+
+uint32_t SimulatedLPI2C::master_status() const {
+    uint32_t msr = master_flags;
+    uint32_t tx_water = mfcr & 0x03;
+    uint32_t rx_water = (mfcr >> 16) & 0x03;
+    if (tx_fifo.count() <= tx_water) {
+        msr |= LPI2C_MSR_TDF;
+    }
+    if (rx_fifo.count() > rx_water) {
+        msr |= LPI2C_MSR_RDF;
+    }
+    if (owns_bus) {
+        msr |= LPI2C_MSR_MBF;
+    }
+    if (connected_bus && connected_bus->busy(lpi2c_simulator.now_ns())) {
+        msr |= LPI2C_MSR_BBF;
+    }
+    return msr;
+}
+
+uint32_t SimulatedLPI2C::slave_status() const {
+    uint32_t ssr = slave_flags;
+    if (slave_transmitting && !stdr_full) {
+        ssr |= LPI2C_SSR_TDF;
+    }
+    if (srdr_full) {
+        ssr |= LPI2C_SSR_RDF;
+    }
+    if (slave_addressed) {
+        ssr |= LPI2C_SSR_SBF;
+    }
+    if (connected_bus && connected_bus->busy(lpi2c_simulator.now_ns())) {
+        ssr |= LPI2C_SSR_BBF;
+    }
+    return ssr;
+}
+
+void SimulatedLPI2C::write_mcr(uint32_t value) {
+    if (value & LPI2C_MCR_RST) {
+        reset_master();
+    }
+    if (value & LPI2C_MCR_RTF) {
+        tx_fifo.clear();
+    }
+    if (value & LPI2C_MCR_RRF) {
+        rx_fifo.clear();
+    }
+    // RTF and RRF always read as 0
+    mcr = value & ~(LPI2C_MCR_RTF | LPI2C_MCR_RRF);
+}
+
+void SimulatedLPI2C::write_scr(uint32_t value) {
+    if (value & LPI2C_SCR_RST) {
+        reset_slave();
+    }
+    if (value & LPI2C_SCR_RTF) {
+        stdr_full = false;
+    }
+    if (value & LPI2C_SCR_RRF) {
+        srdr_full = false;
+    }
+    scr = value & ~(LPI2C_SCR_RTF | LPI2C_SCR_RRF);
+}
+
+void SimulatedLPI2C::reset_master() {
+    if (owns_bus) {
+        // Let go of the bus without sending a STOP
+        connected_bus->release(this, lpi2c_simulator.now_ns(), 0);
+    }
+    master_flags = 0;
+    mier = mder = mcfgr0 = mcfgr1 = mcfgr2 = mcfgr3 = mdmr = mccr0 = mccr1 = mfcr = 0;
+    tx_fifo.clear();
+    rx_fifo.clear();
+    op = MasterOp::none;
+    op_end_ns = 0;
+    idle_since_ns = lpi2c_simulator.now_ns();
+    stalled = false;
+    owns_bus = false;
+    reading = false;
+    expect_nack = false;
+    discard = false;
+    bytes_to_receive = 0;
+    target = nullptr;
+}
+
+void SimulatedLPI2C::reset_slave() {
+    slave_flags = 0;
+    sier = sder = scfgr1 = scfgr2 = samr = sasr = star = 0;
+    stdr_full = false;
+    srdr_full = false;
+    slave_addressed = false;
+    slave_transmitting = false;
+    first_byte = false;
+}
+
+// Moves the master on to 'now_ns'. Returns true if anything changed.
+bool SimulatedLPI2C::step_master(uint64_t now_ns) {
+    if (op == MasterOp::none) {
+        return start_next_command(now_ns);
+    }
+    if (op_end_ns > now_ns) {
+        return false;
+    }
+    return finish_op(now_ns);
+}
+
+bool SimulatedLPI2C::start_next_command(uint64_t now_ns) {
+    if (tx_fifo.empty() || (master_flags & MSR_HALT_FLAGS)) {
+        return false;
+    }
+    if (!(mcr & LPI2C_MCR_MEN) && !owns_bus) {
+        // The master finishes the current transaction even if it's disabled.
+        return false;
+    }
+    const Command& command = tx_fifo.front();
+    uint64_t start_ns = std::max(idle_since_ns, command.time_ns);
+    if (start_ns > now_ns) {
+        // Still finishing the last bit of the previous operation
+        return false;
+    }
+    uint8_t data = command.mtdr & 0xFF;
+    uint8_t type = (command.mtdr >> 8) & 0x07;
+    switch (type) {
+        case 0: // Transmit
+            tx_fifo.pop();
+            if (!owns_bus || reading) {
+                halt_with_error(LPI2C_MSR_FEF, start_ns);
+                return true;
+            }
+            data_byte = data;
+            begin_op(MasterOp::transmit, start_ns, 9 * bit_ns());
+            return true;
+        case 1: // Receive
+        case 3: // Receive and discard
+            tx_fifo.pop();
+            if (!owns_bus || !reading) {
+                halt_with_error(LPI2C_MSR_FEF, start_ns);
+                return true;
+            }
+            bytes_to_receive = data + 1;
+            discard = (type == 3);
+            begin_receive(start_ns);
+            return true;
+        case 2: // Stop
+            tx_fifo.pop();
+            if (owns_bus) {
+                begin_stop(start_ns);
+            }
+            return true;
+        default: // Start. High speed mode is treated like the others.
+            if (owns_bus && target && !reading && !target->slave_can_receive()) {
+                // A slave with RXSTALL holds SCL low until it has read the
+                // last byte so the repeated START has to wait.
+                idle_since_ns = now_ns;
+                return false;
+            }
+            tx_fifo.pop();
+            if (owns_bus) {
+                connected_bus->repeated_start(this);
+                master_flags |= LPI2C_MSR_EPF;
+                begin_op(MasterOp::start, start_ns, repeated_start_ns());
+            } else {
+                if (!connected_bus->acquire(this)) {
+                    // Another master is using the bus.
+                    return false;
+                }
+                owns_bus = true;
+                start_ns = std::max(start_ns, connected_bus->free_at());
+                begin_op(MasterOp::start, start_ns, start_hold_ns());
+            }
+            address_byte = data;
+            expect_nack = (type == 5 || type == 7);
+            target = nullptr;
+            return true;
+    }
+}
+
+// Finishes the current operation if it's not stalled.
+bool SimulatedLPI2C::finish_op(uint64_t now_ns) {
+    uint64_t end_ns = op_end_ns;
+    switch (op) {
+        case MasterOp::start:
+            begin_op(MasterOp::address, end_ns, 9 * bit_ns());
+            return true;
+        case MasterOp::address:
+            reading = address_byte & 0x01;
+            target = connected_bus->address(this, address_byte);
+            op = MasterOp::none;
+            idle_since_ns = end_ns;
+            if ((target != nullptr) == expect_nack) {
+                halt_with_error(LPI2C_MSR_NDF, end_ns);
+            }
+            return true;
+        case MasterOp::transmit:
+            if (target == nullptr || !target->slave_addressed) {
+                // Nobody to ACK the byte
+                op = MasterOp::none;
+                halt_with_error(LPI2C_MSR_NDF, end_ns);
+                return true;
+            }
+            if (!target->slave_can_receive()) {
+                break;  // Slave is stretching the clock
+            }
+            end_ns = end_stall(now_ns);
+            target->slave_receive(data_byte);
+            stats.master_bytes_sent++;
+            op = MasterOp::none;
+            idle_since_ns = end_ns;
+            return true;
+        case MasterOp::receive_wait:
+            if (target && !target->slave_has_data()) {
+                break;  // Slave is stretching the clock
+            }
+            end_ns = end_stall(now_ns);
+            // SDA floats high if the slave has gone away.
+            data_byte = target ? target->slave_transmit() : 0xFF;
+            begin_op(MasterOp::receive, end_ns, 8 * bit_ns());
+            return true;
+        case MasterOp::receive:
+            if (!discard && rx_fifo.full()) {
+                break;  // Wait for software to read MRDR
+            }
+            end_ns = end_stall(now_ns);
+            if (!discard) {
+                rx_fifo.push(data_byte);
+                stats.master_bytes_received++;
+            }
+            if (--bytes_to_receive > 0) {
+                // ACK then get the next byte
+                begin_op(MasterOp::receive_wait, end_ns, bit_ns());
+            } else {
+                begin_op(MasterOp::receive_ack, end_ns, 0);
+            }
+            return true;
+        case MasterOp::receive_ack: {
+            // The master holds SCL low until it knows whether to ACK.
+            if (tx_fifo.empty() || (!(mcr & LPI2C_MCR_MEN) && !owns_bus)) {
+                break;
+            }
+            end_ns = end_stall(now_ns);
+            uint8_t next_type = (tx_fifo.front().mtdr >> 8) & 0x07;
+            if (next_type == 2 || next_type >= 4) {
+                // NACK the last byte before STOP or START
+                if (target) {
+                    target->slave_nacked();
+                }
+            }
+            op = MasterOp::none;
+            idle_since_ns = end_ns + bit_ns();
+            return true;
+        }
+        case MasterOp::stop:
+            owns_bus = false;
+            master_flags |= (LPI2C_MSR_SDF | LPI2C_MSR_EPF);
+            connected_bus->release(this, end_ns, bus_free_ns());
+            target = nullptr;
+            op = MasterOp::none;
+            idle_since_ns = end_ns;
+            return true;
+        case MasterOp::none:
+            return false;
+    }
+    // The operation can't finish yet.
+    if (!stalled) {
+        stalled = true;
+        stalled_since_ns = end_ns;
+    }
+    return false;
+}
+
+// Ends a stall and returns the time the current operation actually finished.
+uint64_t SimulatedLPI2C::end_stall(uint64_t now_ns) {
+    if (!stalled) {
+        return op_end_ns;
+    }
+    stalled = false;
+    stats.clock_stretch_ns += now_ns - stalled_since_ns;
+    return now_ns;
+}
+
+void SimulatedLPI2C::begin_op(MasterOp next_op, uint64_t start_ns, uint64_t duration_ns) {
+    op = next_op;
+    op_end_ns = start_ns + duration_ns;
+    stalled = false;
+}
+
+void SimulatedLPI2C::begin_stop(uint64_t start_ns) {
+    begin_op(MasterOp::stop, start_ns, stop_setup_ns());
+}
+
+void SimulatedLPI2C::begin_receive(uint64_t start_ns) {
+    begin_op(MasterOp::receive_wait, start_ns, 0);
+}
+
+void SimulatedLPI2C::halt_with_error(uint32_t flag, uint64_t now_ns) {
+    master_flags |= flag;
+    if (owns_bus && op == MasterOp::none) {
+        // The hardware sends STOP automatically
+        begin_stop(now_ns);
+    }
+}
+
+// Checks for a pin low timeout. Must be called after step_master().
+void SimulatedLPI2C::check_pin_low_timeout(uint64_t now_ns) {
+    uint64_t timeout = pin_low_timeout_ns();
+    if (!(mcr & LPI2C_MCR_MEN) || timeout == 0 || !owns_bus) {
+        return;
+    }
+    uint64_t low_since;
+    if (op == MasterOp::none) {
+        low_since = idle_since_ns;
+    } else if (stalled) {
+        low_since = stalled_since_ns;
+    } else {
+        return;
+    }
+    if (now_ns >= low_since + timeout && !(master_flags & LPI2C_MSR_PLTF)) {
+        master_flags |= LPI2C_MSR_PLTF;
+    }
+}
+
+// The next time something happens without help from software.
+uint64_t SimulatedLPI2C::next_event_ns() const {
+    uint64_t next = UINT64_MAX;
+    if (op != MasterOp::none && !stalled) {
+        next = op_end_ns;
+    } else if (op == MasterOp::none && !tx_fifo.empty() && idle_since_ns > lpi2c_simulator.now_ns()) {
+        next = idle_since_ns;
+    } else if (op == MasterOp::none && !tx_fifo.empty() && !owns_bus && connected_bus->busy(lpi2c_simulator.now_ns())) {
+        // Waiting to send START
+        next = connected_bus->free_at();
+    }
+    uint64_t timeout = pin_low_timeout_ns();
+    if ((mcr & LPI2C_MCR_MEN) && timeout && owns_bus && !(master_flags & LPI2C_MSR_PLTF)) {
+        if (op == MasterOp::none) {
+            next = std::min(next, idle_since_ns + timeout);
+        } else if (stalled) {
+            next = std::min(next, stalled_since_ns + timeout);
+        }
+    }
+    return next;
+}
+
+// The length of one prescaled LPI2C clock cycle
+double SimulatedLPI2C::scale_ns() const {
+    double period_ns = 1e9 / lpi2c_simulator.timing.lpi2c_clock_hz;
+    return period_ns * (1U << (mcfgr1 & 0x07));
+}
+
+uint32_t SimulatedLPI2C::scl_latency() const {
+    double period_ns = 1e9 / lpi2c_simulator.timing.lpi2c_clock_hz;
+    uint32_t filtscl = (mcfgr2 >> 16) & 0x0F;
+    double rise_cycles = (lpi2c_simulator.timing.rise_time_ns * TIME_TO_RISE_TO_TEENSY_TRIGGER_VOLTAGE) / period_ns;
+    return static_cast<uint32_t>(std::floor((2.0 + filtscl + rise_cycles) / (1U << (mcfgr1 & 0x07))));
+}
+
+// One SCL period
+uint64_t SimulatedLPI2C::bit_ns() const {
+    uint32_t clklo = mccr0 & 0x3F;
+    uint32_t clkhi = (mccr0 >> 8) & 0x3F;
+    return std::llround(scale_ns() * (clkhi + clklo + 2 + scl_latency()));
+}
+
+uint64_t SimulatedLPI2C::start_hold_ns() const {
+    uint32_t sethold = (mccr0 >> 16) & 0x3F;
+    return std::llround(scale_ns() * (sethold + 1));
+}
+
+uint64_t SimulatedLPI2C::repeated_start_ns() const {
+    return stop_setup_ns() + start_hold_ns();
+}
+
+uint64_t SimulatedLPI2C::stop_setup_ns() const {
+    uint32_t sethold = (mccr0 >> 16) & 0x3F;
+    return std::llround(scale_ns() * (sethold + 1 + scl_latency()));
+}
+
+uint64_t SimulatedLPI2C::bus_free_ns() const {
+    uint32_t clklo = mccr0 & 0x3F;
+    uint32_t busidle = mcfgr2 & 0xFFF;
+    uint32_t offset = busidle > 1 ? busidle + 1 : 2;
+    return std::llround(1000 + scale_ns() * (clklo + 1 + offset));
+}
+
+uint64_t SimulatedLPI2C::pin_low_timeout_ns() const {
+    uint32_t pinlow = (mcfgr3 >> 8) & 0xFFF;
+    return std::llround(scale_ns() * pinlow * 256);
+}
+
+bool SimulatedLPI2C::slave_enabled() const {
+    return scr & LPI2C_SCR_SEN;
+}
+
+bool SimulatedLPI2C::slave_matches(uint8_t address) const {
+    uint32_t addr0 = (samr >> 1) & 0x7F;
+    uint32_t addr1 = (samr >> 17) & 0x7F;
+    switch ((scfgr1 >> 16) & 0x07) {
+        case 0: return address == addr0;
+        case 2: return address == addr0 || address == addr1;
+        case 6: return address >= addr0 && address <= addr1;
+        default: return false;  // 10 bit addresses aren't supported
+    }
+}
+
+void SimulatedLPI2C::slave_address_matched(uint8_t matched_address_byte, bool second_address) {
+    slave_addressed = true;
+    slave_transmitting = matched_address_byte & 0x01;
+    first_byte = true;
+    stdr_full = false;
+    sasr = matched_address_byte;
+    slave_flags |= LPI2C_SSR_AVF | (second_address ? LPI2C_SSR_AM1F : LPI2C_SSR_AM0F);
+}
+
+bool SimulatedLPI2C::slave_can_receive() const {
+    return !srdr_full || !(scfgr1 & LPI2C_SCFGR1_RXSTALL);
+}
+
+void SimulatedLPI2C::slave_receive(uint8_t data) {
+    if (srdr_full) {
+        // Overrun. Only possible if RXSTALL is disabled.
+        slave_flags |= LPI2C_SSR_FEF;
+    }
+    srdr = data | (first_byte ? LPI2C_SRDR_SOF : 0);
+    srdr_full = true;
+    first_byte = false;
+    stats.slave_bytes_received++;
+}
+
+bool SimulatedLPI2C::slave_has_data() const {
+    return !slave_addressed || stdr_full || !(scfgr1 & LPI2C_SCFGR1_TXDSTALL);
+}
+
+// Moves STDR into the shift register. The slave asks for the next
+// byte as soon as this happens.
+uint8_t SimulatedLPI2C::slave_transmit() {
+    if (!slave_addressed) {
+        return 0xFF;
+    }
+    if (!stdr_full) {
+        // Underrun. Only possible if TXDSTALL is disabled.
+        slave_flags |= LPI2C_SSR_FEF;
+        return 0xFF;
+    }
+    stdr_full = false;
+    stats.slave_bytes_sent++;
+    return stdr;
+}
+
+// The master NACKed the last byte so the slave stops transmitting.
+void SimulatedLPI2C::slave_nacked() {
+    slave_transmitting = false;
+    stdr_full = false;
+}
+
+// Repeated START or STOP
+void SimulatedLPI2C::slave_end_of_frame(uint32_t flag) {
+    if (!slave_addressed) {
+        return;
+    }
+    slave_flags |= flag;
+    slave_addressed = false;
+    slave_transmitting = false;
+    stdr_full = false;
+}
@@ -0,0 +1,317 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef SIMULATED_LPI2C_H
+#define SIMULATED_LPI2C_H
+
+#include <cstdint>
+#include <cstddef>
+#include "lpi2c_register_id.h"
+#include "register_access_profile.h"
+
+class SimulatedLPI2C;
+class SimulatedI2CBus;
+
+// Stands in for one of the volatile uint32_t registers in
+// IMXRT_LPI2C_Registers. Every read and write is passed to the simulated
+// peripheral so it can react the way the hardware does. e.g. Writing
+// to MTDR queues a command and reading SRDR clears RDF.
+class LPI2CRegister {
+public:
+    LPI2CRegister(SimulatedLPI2C& port, LPI2CRegisterId id)
+        : port(port), id(id) {
+    }
+
+    LPI2CRegister(const LPI2CRegister&) = delete;
+
+    inline operator uint32_t() const;
+
+    inline LPI2CRegister& operator=(uint32_t value);
+
+    // Copies the value of another register. e.g. port->MCCR1 = port->MCCR0
+    inline LPI2CRegister& operator=(const LPI2CRegister& other);
+
+    inline LPI2CRegister& operator|=(uint32_t value);
+
+    inline LPI2CRegister& operator&=(uint32_t value);
+
+private:
+    SimulatedLPI2C& port;
+    const LPI2CRegisterId id;
+};
+
+// Host replacement for the register block in imx_rt1060.h.
+// The members have the same names as the real ones so the
+// driver compiles without changes.
+struct IMXRT_LPI2C_Registers {
+    explicit IMXRT_LPI2C_Registers(SimulatedLPI2C& port);
+
+    LPI2CRegister VERID;
+    LPI2CRegister PARAM;
+    LPI2CRegister MCR;
+    LPI2CRegister MSR;
+    LPI2CRegister MIER;
+    LPI2CRegister MDER;
+    LPI2CRegister MCFGR0;
+    LPI2CRegister MCFGR1;
+    LPI2CRegister MCFGR2;
+    LPI2CRegister MCFGR3;
+    LPI2CRegister MDMR;
+    LPI2CRegister MCCR0;
+    LPI2CRegister MCCR1;
+    LPI2CRegister MFCR;
+    LPI2CRegister MFSR;
+    LPI2CRegister MTDR;
+    LPI2CRegister MRDR;
+    LPI2CRegister SCR;
+    LPI2CRegister SSR;
+    LPI2CRegister SIER;
+    LPI2CRegister SDER;
+    LPI2CRegister SCFGR1;
+    LPI2CRegister SCFGR2;
+    LPI2CRegister SAMR;
+    LPI2CRegister SASR;
+    LPI2CRegister STAR;
+    LPI2CRegister STDR;
+    LPI2CRegister SRDR;
+};
+
+// A FIFO with a fixed capacity like the ones in the LPI2C peripheral.
+template<typename T, size_t N>
+class SimulatedFifo {
+public:
+    inline size_t count() const { return num_items; }
+    inline bool empty() const { return num_items == 0; }
+    inline bool full() const { return num_items == N; }
+    inline void clear() { num_items = 0; }
+    inline const T& front() const { return items[first]; }
+
+    inline bool push(const T& item) {
+        if (full()) {
+            return false;
+        }
+        items[(first + num_items++) % N] = item;
+        return true;
+    }
+
+    inline T pop() {
+        T item = items[first];
+        first = (first + 1) % N;
+        num_items--;
+        return item;
+    }
+
+private:
+    T items[N] = {};
+    size_t first = 0;
+    size_t num_items = 0;
+};
+
+// Simulates one LPI2C peripheral. i.e. A master and a slave that share
+// the same pins. The master is simulated a byte at a time using the
+// timings in MCCR0, MCFGR1 and MCFGR2.
+//
+// Register accesses and the passage of time are managed by LPI2CSimulator.
+// Ports only talk to each other if they're connected to the same bus.
+// See LPI2CSimulator::connect().
+class SimulatedLPI2C {
+public:
+    SimulatedLPI2C(uint8_t index, int irq);
+
+    SimulatedLPI2C(const SimulatedLPI2C&) = delete;
+
+    // The registers used by the driver. e.g. LPI2C1
+    IMXRT_LPI2C_Registers registers;
+
+    // Called by the registers. These advance the simulated time.
+    uint32_t read(LPI2CRegisterId id);
+    void write(LPI2CRegisterId id, uint32_t value);
+
+    // Returns the value the register would have without side effects.
+    uint32_t peek(LPI2CRegisterId id) const;
+
+    inline uint8_t index() const { return port_index; }
+    inline int irq() const { return irq_number; }
+    inline SimulatedI2CBus& bus() { return *connected_bus; }
+
+    // True if an enabled interrupt flag is set.
+    bool interrupt_pending() const;
+
+    // The reason the ISR would be called now
+    IsrCause pending_isr_cause() const;
+
+    // Puts both the master and the slave back in their power on state.
+    void reset();
+
+    // Raise status flags as if the hardware had set them. For fuzz tests
+    // that need to reach error paths which are hard to hit on a real bus.
+    // Error flags (NDF, ALF, FEF and PLTF) stop the master the way the
+    // hardware does. Flags that software can't clear are ignored. So is
+    // the master's SDF because only a STOP can set it.
+    void inject_master_flags(uint32_t flags);
+    void inject_slave_flags(uint32_t flags);
+
+    // Statistics for benchmarks
+    struct Stats {
+        uint32_t isr_entries = 0;           // Calls to the interrupt service routine
+        uint32_t register_reads = 0;
+        uint32_t register_writes = 0;
+        uint32_t master_bytes_sent = 0;     // Data bytes. Excludes the address.
+        uint32_t master_bytes_received = 0;
+        uint32_t slave_bytes_received = 0;
+        uint32_t slave_bytes_sent = 0;
+        uint64_t clock_stretch_ns = 0;      // Time the master spent waiting for a slave
+    };
+    Stats stats;
+
+    // Register accesses made by the driver. Reset with the port.
+    RegisterAccessProfile profile;
+
+private:
+    friend class SimulatedI2CBus;
+    friend class LPI2CSimulator;
+
+    // What the master is doing on the bus
+    enum class MasterOp : uint8_t {
+        none = 0,       // Waiting for a command
+        start,          // Sending (repeated) START
+        address,        // Sending the address and getting ACK or NACK
+        transmit,       // Sending a data byte and getting ACK or NACK
+        receive_wait,   // Waiting for the slave to provide data
+        receive,        // Receiving a data byte
+        receive_ack,    // Waiting to find out whether to ACK or NACK the last byte
+        stop            // Sending STOP
+    };
+
+    struct Command {
+        uint16_t mtdr;      // The value written to MTDR
+        uint64_t time_ns;   // When it was written
+    };
+
+    const uint8_t port_index;
+    const int irq_number;
+    SimulatedI2CBus* connected_bus = nullptr;
+
+    // Master
+    uint32_t mcr = 0;
+    uint32_t master_flags = 0;  // MSR flags that are cleared by software
+    uint32_t mier = 0;
+    uint32_t mder = 0;
+    uint32_t mcfgr0 = 0;
+    uint32_t mcfgr1 = 0;
+    uint32_t mcfgr2 = 0;
+    uint32_t mcfgr3 = 0;
+    uint32_t mdmr = 0;
+    uint32_t mccr0 = 0;
+    uint32_t mccr1 = 0;
+    uint32_t mfcr = 0;
+    SimulatedFifo<Command, 4> tx_fifo;
+    SimulatedFifo<uint8_t, 4> rx_fifo;
+    MasterOp op = MasterOp::none;
+    uint64_t op_end_ns = 0;         // When the current operation finishes
+    uint64_t idle_since_ns = 0;     // When the master last finished an operation
+    bool stalled = false;           // True if the current operation is waiting for the slave or the FIFO
+    uint64_t stalled_since_ns = 0;
+    bool owns_bus = false;          // Between START and STOP
+    bool reading = false;           // Direction of the current transfer
+    bool expect_nack = false;       // START command 5
+    bool discard = false;           // RECEIVE_DISCARD command
+    uint8_t address_byte = 0;
+    uint8_t data_byte = 0;
+    uint32_t bytes_to_receive = 0;
+    SimulatedLPI2C* target = nullptr;   // The slave that ACKed our address
+
+    // Slave
+    uint32_t scr = 0;
+    uint32_t slave_flags = 0;   // SSR flags that are cleared by software or by reading SASR
+    uint32_t sier = 0;
+    uint32_t sder = 0;
+    uint32_t scfgr1 = 0;
+    uint32_t scfgr2 = 0;
+    uint32_t samr = 0;
+    uint32_t sasr = 0;
+    uint32_t star = 0;
+    uint32_t stdr = 0;
+    bool stdr_full = false;
+    uint32_t srdr = 0;
+    bool srdr_full = false;
+    bool slave_addressed = false;
+    bool slave_transmitting = false;
+    bool first_byte = false;    // Next byte received gets SOF
+
+    uint32_t master_status() const;
+    uint32_t slave_status() const;
+    void write_mcr(uint32_t value);
+    void write_scr(uint32_t value);
+    void reset_master();
+    void reset_slave();
+
+    // Master engine. Called by LPI2CSimulator.
+    bool step_master(uint64_t now_ns);
+    bool start_next_command(uint64_t now_ns);
+    bool finish_op(uint64_t now_ns);
+    void begin_op(MasterOp next_op, uint64_t start_ns, uint64_t duration_ns);
+    void begin_stop(uint64_t start_ns);
+    void begin_receive(uint64_t start_ns);
+    uint64_t end_stall(uint64_t now_ns);
+    void halt_with_error(uint32_t flag, uint64_t now_ns);
+    void check_pin_low_timeout(uint64_t now_ns);
+    uint64_t next_event_ns() const;
+
+    // Bus timings derived from the master's configuration registers
+    double scale_ns() const;
+    uint32_t scl_latency() const;
+    uint64_t bit_ns() const;
+    uint64_t start_hold_ns() const;
+    uint64_t repeated_start_ns() const;
+    uint64_t stop_setup_ns() const;
+    uint64_t bus_free_ns() const;
+    uint64_t pin_low_timeout_ns() const;
+
+    // Slave side. Called by the master on the other end of the bus.
+    bool slave_enabled() const;
+    bool slave_matches(uint8_t address) const;
+    void slave_address_matched(uint8_t matched_address_byte, bool second_address);
+    bool slave_can_receive() const;
+    void slave_receive(uint8_t data);
+    bool slave_has_data() const;
+    uint8_t slave_transmit();
+    void slave_nacked();
+    void slave_end_of_frame(uint32_t flag);
+};
+
+inline LPI2CRegister::operator uint32_t() const {
+    return port.read(id);
+}
+
+inline LPI2CRegister& LPI2CRegister::operator=(uint32_t value) {
+    port.write(id, value);
+    return *this;
+}
+
+inline LPI2CRegister& LPI2CRegister::operator=(const LPI2CRegister& other) {
+    port.write(id, static_cast<uint32_t>(other));
+    return *this;
+}
+
+inline LPI2CRegister& LPI2CRegister::operator|=(uint32_t value) {
+    port.write(id, port.read(id) | value);
+    return *this;
+}
+
+inline LPI2CRegister& LPI2CRegister::operator&=(uint32_t value) {
+    port.write(id, port.read(id) & value);
+    return *this;
+}
+
+extern SimulatedLPI2C simulated_lpi2c1;
+extern SimulatedLPI2C simulated_lpi2c2;
+extern SimulatedLPI2C simulated_lpi2c3;
+extern SimulatedLPI2C simulated_lpi2c4;
+
+#define LPI2C1		(simulated_lpi2c1.registers)
+#define LPI2C2		(simulated_lpi2c2.registers)  // Not connected to any pins on the Teensy 4.0
+#define LPI2C3		(simulated_lpi2c3.registers)
+#define LPI2C4		(simulated_lpi2c4.registers)
+
+#endif //SIMULATED_LPI2C_H
@@ -0,0 +1,91 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Host replacement for the Teensy core's Arduino.h. It only defines
+// the parts used by the I2C library. Time comes from the LPI2C simulator's
+// clock so timeouts behave the same way on every run.
+
+#ifndef HOST_SHIMS_ARDUINO_H
+#define HOST_SHIMS_ARDUINO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <imxrt.h>
+#include <pins_arduino.h>
+
+// The Teensy's byte order macros come from newlib
+#ifndef _LITTLE_ENDIAN
+#define _LITTLE_ENDIAN 1234
+#define _BIG_ENDIAN 4321
+#define _BYTE_ORDER _LITTLE_ENDIAN
+#endif
+
+#define DEC 10
+#define HEX 16
+
+// Teensy defines these in wiring.h. They take their arguments by value
+// so that static const class members don't need a definition.
+template<class A, class B>
+constexpr typename std::common_type<A, B>::type min(A a, B b) { return (a < b) ? a : b; }
+template<class A, class B>
+constexpr typename std::common_type<A, B>::type max(A a, B b) { return (a > b) ? a : b; }
+
+// Each call costs one simulated register access. This makes sure that
+// polling loops which only check the time still move the clock on.
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t msec);
+void delayMicroseconds(uint32_t usec);
+void yield();
+
+class Print {
+public:
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+    virtual void flush() {}
+
+    size_t print(const char* str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+
+    size_t println() { return write("\n"); }
+    template<class T>
+    size_t println(T value) { return print(value) + println(); }
+    template<class T>
+    size_t println(T value, int base) { return print(value, base) + println(); }
+
+    virtual ~Print() = default;
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// Writes to stderr so that it doesn't get mixed up with tool output.
+class HostSerial : public Stream {
+public:
+    void begin(uint32_t baud) {}
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    operator bool() { return true; }
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+// The Teensy core includes this from Arduino.h too
+#include "elapsedMillis.h"
+
+#endif //HOST_SHIMS_ARDUINO_H
@@ -0,0 +1,61 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <cstdio>
+#include "Arduino.h"
+#include "lpi2c_simulator.h"
+
+HostSerial Serial;
+
+static uint64_t tick_ns() {
+    lpi2c_simulator.advance(lpi2c_simulator.timing.register_access_ns);
+    return lpi2c_simulator.now_ns();
+}
+
+uint32_t millis() {
+    return (uint32_t)(tick_ns() / 1'000'000);
+}
+
+uint32_t micros() {
+    return (uint32_t)(tick_ns() / 1'000);
+}
+
+void delay(uint32_t msec) {
+    lpi2c_simulator.advance((uint64_t)msec * 1'000'000);
+}
+
+void delayMicroseconds(uint32_t usec) {
+    lpi2c_simulator.advance((uint64_t)usec * 1'000);
+}
+
+void yield() {
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    while (size--) {
+        count += write(*buffer++);
+    }
+    return count;
+}
+
+size_t Print::print(long n, int base) {
+    if (n < 0 && base == DEC) {
+        return print('-') + print((unsigned long)-n, base);
+    }
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+    char text[8 * sizeof(n) + 1];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", n);
+    return write(text);
+}
+
+size_t HostSerial::write(uint8_t b) {
+    return fputc(b, stderr) == EOF ? 0 : 1;
+}
+
+size_t HostSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stderr);
+}
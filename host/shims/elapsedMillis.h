@@ -0,0 +1,33 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Host replacement for the Teensy core's elapsedMillis.h
+
+#ifndef HOST_SHIMS_ELAPSED_MILLIS_H
+#define HOST_SHIMS_ELAPSED_MILLIS_H
+
+#include "Arduino.h"
+
+class elapsedMillis {
+public:
+    elapsedMillis() : start(millis()) {}
+    elapsedMillis(unsigned long val) : start(millis() - val) {}
+    operator unsigned long() const { return millis() - start; }
+    elapsedMillis& operator=(unsigned long val) { start = millis() - val; return *this; }
+
+private:
+    unsigned long start;
+};
+
+class elapsedMicros {
+public:
+    elapsedMicros() : start(micros()) {}
+    elapsedMicros(unsigned long val) : start(micros() - val) {}
+    operator unsigned long() const { return micros() - start; }
+    elapsedMicros& operator=(unsigned long val) { start = micros() - val; return *this; }
+
+private:
+    unsigned long start;
+};
+
+#endif //HOST_SHIMS_ELAPSED_MILLIS_H
@@ -0,0 +1,30 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <imxrt.h>
+#include <pins_arduino.h>
+#include "lpi2c_simulator.h"
+
+volatile uint32_t simulated_ccm_cscdr2 = 0;
+volatile uint32_t simulated_ccm_ccgr2 = 0;
+volatile uint32_t simulated_ccm_ccgr6 = 0;
+volatile uint32_t simulated_iomuxc_select_input[6] = {};
+volatile uint32_t simulated_pad_control[CORE_NUM_DIGITAL] = {};
+volatile uint32_t simulated_pin_mux[CORE_NUM_DIGITAL] = {};
+
+void attachInterruptVector(IRQ_NUMBER_t irq, void (*function)(void)) {
+    lpi2c_simulator.attach_interrupt_vector(irq, function);
+}
+
+void simulated_nvic_enable_irq(IRQ_NUMBER_t irq) {
+    lpi2c_simulator.enable_irq(irq, true);
+}
+
+void simulated_nvic_disable_irq(IRQ_NUMBER_t irq) {
+    lpi2c_simulator.enable_irq(irq, false);
+}
+
+// Reading the cycle counter doesn't move the clock on
+uint32_t simulated_cycle_count() {
+    return (uint32_t)(lpi2c_simulator.now_ns() * 600 / 1000);
+}
@@ -0,0 +1,146 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Host replacement for the Teensy core's imxrt.h. It only defines
+// the parts used by the I2C driver. Interrupts are handled by
+// the LPI2C simulator.
+
+#ifndef HOST_SHIMS_IMXRT_H
+#define HOST_SHIMS_IMXRT_H
+
+#include <cstdint>
+
+typedef int IRQ_NUMBER_t;
+#define IRQ_LPI2C1		28
+#define IRQ_LPI2C2		29
+#define IRQ_LPI2C3		30
+#define IRQ_LPI2C4		31
+
+void attachInterruptVector(IRQ_NUMBER_t irq, void (*function)(void));
+void simulated_nvic_enable_irq(IRQ_NUMBER_t irq);
+void simulated_nvic_disable_irq(IRQ_NUMBER_t irq);
+#define NVIC_ENABLE_IRQ(n)	simulated_nvic_enable_irq(n)
+#define NVIC_DISABLE_IRQ(n)	simulated_nvic_disable_irq(n)
+#define NVIC_SET_PRIORITY(n, p)	((void)(n), (void)(p))
+
+// The cycle counter. Runs at 600 MHz on the simulator's clock.
+uint32_t simulated_cycle_count();
+#define ARM_DWT_CYCCNT		simulated_cycle_count()
+
+// Clock control and pin mux registers. They're just memory on the host.
+extern volatile uint32_t simulated_ccm_cscdr2;
+extern volatile uint32_t simulated_ccm_ccgr2;
+extern volatile uint32_t simulated_ccm_ccgr6;
+extern volatile uint32_t simulated_iomuxc_select_input[6];
+#define CCM_CSCDR2				simulated_ccm_cscdr2
+#define CCM_CSCDR2_LPI2C_CLK_PODF(n)		((uint32_t)(((n) & 0x3F) << 19))
+#define CCM_CSCDR2_LPI2C_CLK_SEL		((uint32_t)(1<<18))
+#define CCM_CCGR2				simulated_ccm_ccgr2
+#define CCM_CCGR6				simulated_ccm_ccgr6
+#define CCM_CCGR_ON				3
+#define CCM_CCGR2_LPI2C1(n)			((uint32_t)(((n) & 0x03) << 6))
+#define CCM_CCGR2_LPI2C3(n)			((uint32_t)(((n) & 0x03) << 10))
+#define CCM_CCGR6_LPI2C4_SERIAL(n)		((uint32_t)(((n) & 0x03) << 24))
+#define IOMUXC_LPI2C1_SDA_SELECT_INPUT		simulated_iomuxc_select_input[0]
+#define IOMUXC_LPI2C1_SCL_SELECT_INPUT		simulated_iomuxc_select_input[1]
+#define IOMUXC_LPI2C3_SDA_SELECT_INPUT		simulated_iomuxc_select_input[2]
+#define IOMUXC_LPI2C3_SCL_SELECT_INPUT		simulated_iomuxc_select_input[3]
+#define IOMUXC_LPI2C4_SDA_SELECT_INPUT		simulated_iomuxc_select_input[4]
+#define IOMUXC_LPI2C4_SCL_SELECT_INPUT		simulated_iomuxc_select_input[5]
+#define IOMUXC_PAD_HYS				((uint32_t)(1<<16))
+#define IOMUXC_PAD_PUS(n)			((uint32_t)(((n) & 0x03) << 14))
+#define IOMUXC_PAD_PUE				((uint32_t)(1<<13))
+#define IOMUXC_PAD_PKE				((uint32_t)(1<<12))
+#define IOMUXC_PAD_ODE				((uint32_t)(1<<11))
+#define IOMUXC_PAD_SPEED(n)			((uint32_t)(((n) & 0x03) << 6))
+#define IOMUXC_PAD_DSE(n)			((uint32_t)(((n) & 0x07) << 3))
+
+// LPI2C register bits. Same as the Teensy core.
+#define LPI2C_MCR_RRF			((uint32_t)(1<<9))
+#define LPI2C_MCR_RTF			((uint32_t)(1<<8))
+#define LPI2C_MCR_RST			((uint32_t)(1<<1))
+#define LPI2C_MCR_MEN			((uint32_t)(1<<0))
+#define LPI2C_MSR_BBF			((uint32_t)(1<<25))
+#define LPI2C_MSR_MBF			((uint32_t)(1<<24))
+#define LPI2C_MSR_DMF			((uint32_t)(1<<14))
+#define LPI2C_MSR_PLTF			((uint32_t)(1<<13))
+#define LPI2C_MSR_FEF			((uint32_t)(1<<12))
+#define LPI2C_MSR_ALF			((uint32_t)(1<<11))
+#define LPI2C_MSR_NDF			((uint32_t)(1<<10))
+#define LPI2C_MSR_SDF			((uint32_t)(1<<9))
+#define LPI2C_MSR_EPF			((uint32_t)(1<<8))
+#define LPI2C_MSR_RDF			((uint32_t)(1<<1))
+#define LPI2C_MSR_TDF			((uint32_t)(1<<0))
+#define LPI2C_MIER_DMIE			((uint32_t)(1<<14))
+#define LPI2C_MIER_PLTIE		((uint32_t)(1<<13))
+#define LPI2C_MIER_FEIE			((uint32_t)(1<<12))
+#define LPI2C_MIER_ALIE			((uint32_t)(1<<11))
+#define LPI2C_MIER_NDIE			((uint32_t)(1<<10))
+#define LPI2C_MIER_SDIE			((uint32_t)(1<<9))
+#define LPI2C_MIER_EPIE			((uint32_t)(1<<8))
+#define LPI2C_MIER_RDIE			((uint32_t)(1<<1))
+#define LPI2C_MIER_TDIE			((uint32_t)(1<<0))
+#define LPI2C_MCFGR0_HRSEL		((uint32_t)(1<<2))
+#define LPI2C_MCFGR0_HRPOL		((uint32_t)(1<<1))
+#define LPI2C_MCFGR0_HREN		((uint32_t)(1<<0))
+#define LPI2C_MCFGR1_PRESCALE(n)	((uint32_t)(((n) & 0x07) << 0))
+#define LPI2C_MCFGR2_FILTSDA(n)		((uint32_t)(((n) & 0x0F) << 24))
+#define LPI2C_MCFGR2_FILTSCL(n)		((uint32_t)(((n) & 0x0F) << 16))
+#define LPI2C_MCFGR2_BUSIDLE(n)		((uint32_t)(((n) & 0xFFF) << 0))
+#define LPI2C_MCFGR3_PINLOW(n)		((uint32_t)(((n) & 0xFFF) << 8))
+#define LPI2C_MCCR0_DATAVD(n)		((uint32_t)(((n) & 0x3F) << 24))
+#define LPI2C_MCCR0_SETHOLD(n)		((uint32_t)(((n) & 0x3F) << 16))
+#define LPI2C_MCCR0_CLKHI(n)		((uint32_t)(((n) & 0x3F) << 8))
+#define LPI2C_MCCR0_CLKLO(n)		((uint32_t)(((n) & 0x3F) << 0))
+#define LPI2C_MFCR_RXWATER(n)		((uint32_t)(((n) & 0x03) << 16))
+#define LPI2C_MFCR_TXWATER(n)		((uint32_t)(((n) & 0x03) << 0))
+#define LPI2C_MTDR_CMD_TRANSMIT		((uint32_t)(0 << 8))
+#define LPI2C_MTDR_CMD_RECEIVE		((uint32_t)(1 << 8))
+#define LPI2C_MTDR_CMD_STOP		((uint32_t)(2 << 8))
+#define LPI2C_MTDR_CMD_RECEIVE_DISCARD	((uint32_t)(3 << 8))
+#define LPI2C_MTDR_CMD_START		((uint32_t)(4 << 8))
+#define LPI2C_MRDR_RXEMPTY		((uint32_t)(1<<14))
+#define LPI2C_SCR_RRF			((uint32_t)(1<<9))
+#define LPI2C_SCR_RTF			((uint32_t)(1<<8))
+#define LPI2C_SCR_FILTEN		((uint32_t)(1<<4))
+#define LPI2C_SCR_RST			((uint32_t)(1<<1))
+#define LPI2C_SCR_SEN			((uint32_t)(1<<0))
+#define LPI2C_SSR_BBF			((uint32_t)(1<<25))
+#define LPI2C_SSR_SBF			((uint32_t)(1<<24))
+#define LPI2C_SSR_SARF			((uint32_t)(1<<15))
+#define LPI2C_SSR_GCF			((uint32_t)(1<<14))
+#define LPI2C_SSR_AM1F			((uint32_t)(1<<13))
+#define LPI2C_SSR_AM0F			((uint32_t)(1<<12))
+#define LPI2C_SSR_FEF			((uint32_t)(1<<11))
+#define LPI2C_SSR_BEF			((uint32_t)(1<<10))
+#define LPI2C_SSR_SDF			((uint32_t)(1<<9))
+#define LPI2C_SSR_RSF			((uint32_t)(1<<8))
+#define LPI2C_SSR_TAF			((uint32_t)(1<<3))
+#define LPI2C_SSR_AVF			((uint32_t)(1<<2))
+#define LPI2C_SSR_RDF			((uint32_t)(1<<1))
+#define LPI2C_SSR_TDF			((uint32_t)(1<<0))
+#define LPI2C_SIER_FEIE			((uint32_t)(1<<11))
+#define LPI2C_SIER_BEIE			((uint32_t)(1<<10))
+#define LPI2C_SIER_SDIE			((uint32_t)(1<<9))
+#define LPI2C_SIER_RSIE			((uint32_t)(1<<8))
+#define LPI2C_SIER_TAIE			((uint32_t)(1<<3))
+#define LPI2C_SIER_AVIE			((uint32_t)(1<<2))
+#define LPI2C_SIER_RDIE			((uint32_t)(1<<1))
+#define LPI2C_SIER_TDIE			((uint32_t)(1<<0))
+#define LPI2C_SCFGR1_ADDRCFG(n)		((uint32_t)(((n) & 0x07) << 16))
+#define LPI2C_SCFGR1_TXDSTALL		((uint32_t)(1<<2))
+#define LPI2C_SCFGR1_RXSTALL		((uint32_t)(1<<1))
+#define LPI2C_SCFGR1_ADRSTALL		((uint32_t)(1<<0))
+#define LPI2C_SCFGR2_FILTSDA(n)		((uint32_t)(((n) & 0x0F) << 24))
+#define LPI2C_SCFGR2_FILTSCL(n)		((uint32_t)(((n) & 0x0F) << 16))
+#define LPI2C_SCFGR2_DATAVD(n)		((uint32_t)(((n) & 0x3F) << 8))
+#define LPI2C_SCFGR2_CLKHOLD(n)		((uint32_t)(((n) & 0x0F) << 0))
+#define LPI2C_SAMR_ADDR1(n)		((uint32_t)(((n) & 0x3FF) << 17))
+#define LPI2C_SAMR_ADDR0(n)		((uint32_t)(((n) & 0x3FF) << 1))
+#define LPI2C_SASR_ANV			((uint32_t)(1<<14))
+#define LPI2C_SASR_RADDR(n)		((uint32_t)(((n) & 0x7FF) << 0))
+#define LPI2C_SRDR_SOF			((uint32_t)(1<<15))
+#define LPI2C_SRDR_RXEMPTY		((uint32_t)(1<<14))
+#define LPI2C_SRDR_DATA(n)		((uint32_t)(((n) & 0xFF) << 0))
+
+#endif //HOST_SHIMS_IMXRT_H
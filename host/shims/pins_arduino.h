@@ -0,0 +1,20 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Host replacement for the Teensy core's pins_arduino.h.
+// The pad and mux registers are just memory on the host.
+
+#ifndef HOST_SHIMS_PINS_ARDUINO_H
+#define HOST_SHIMS_PINS_ARDUINO_H
+
+#include <cstdint>
+
+#define CORE_NUM_DIGITAL 64
+
+extern volatile uint32_t simulated_pad_control[CORE_NUM_DIGITAL];
+extern volatile uint32_t simulated_pin_mux[CORE_NUM_DIGITAL];
+
+#define portControlRegister(pin)	(&simulated_pad_control[(pin)])
+#define portConfigRegister(pin)		(&simulated_pin_mux[(pin)])
+
+#endif //HOST_SHIMS_PINS_ARDUINO_H
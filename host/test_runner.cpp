@@ -0,0 +1,62 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+// Runs the tests that don't need a Teensy on the host.
+
+#include <unity.h>
+#include "utils/test_suite.h"
+
+// Unit Tests
+#include "unit/test_i2c_device.h"
+#include "unit/test_i2c_register_slave.h"
+#include "unit/test_i2c_multi_device_slave.h"
+#include "unit/test_i2c_transaction_log.h"
+
+// Simulator Tests
+#include "host/test_lpi2c_simulator.h"
+#include "host/test_i2c_bus_arbiter.h"
+#include "host/test_i2c_scheduler.h"
+#include "host/test_i2c_multi_bus.h"
+#include "host/test_i2c_triggered_read.h"
+#include "host/test_i2c_fifo_drain.h"
+
+void test(TestSuite* suite);
+
+void run_all_tests() {
+    test(new I2CDeviceTest());
+    test(new I2CRegisterSlaveTest());
+    test(new I2CMultiDeviceSlaveTest());
+    test(new I2CTransactionLogTest());
+
+    test(new LPI2CSimulatorTest());
+    test(new I2CBusArbiterTest());
+    test(new I2CSchedulerTest());
+    test(new I2CMultiBusTest());
+    test(new I2CTriggeredReadTest());
+    test(new I2CFifoDrainTest());
+}
+
+TestSuite* test_suite;
+
+void test(TestSuite* suite) {
+    test_suite = suite;
+    UnitySetTestFile(test_suite->get_file_name());
+    test_suite->test();
+    delete(test_suite);
+}
+
+// Called before each test.
+void setUp(void) {
+    test_suite->setUp();
+}
+
+// Called after each test.
+void tearDown(void) {
+    test_suite->tearDown();
+}
+
+int main() {
+    UNITY_BEGIN();
+    run_all_tests();
+    return UNITY_END();
+}
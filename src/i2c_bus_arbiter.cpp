@@ -0,0 +1,145 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <Arduino.h>
+#include "i2c_bus_arbiter.h"
+
+I2CBusClient::I2CBusClient(I2CBusArbiter& arbiter, I2CRequest** queue, size_t queue_size, uint8_t priority)
+        : arbiter(arbiter), queue(queue), queue_size(queue_size), _priority(priority) {
+    arbiter.add_client(this);
+}
+
+bool I2CBusClient::submit(I2CRequest& request) {
+    if (!request.finished()) {
+        return false;
+    }
+    size_t position = head.load(std::memory_order_relaxed);
+    size_t next = (position + 1) % queue_size;
+    if (next == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    request.error = I2CError::ok;
+    request.bytes_read = 0;
+    request.reading = false;
+    request.done.store(false, std::memory_order_relaxed);
+    queue[position] = &request;
+    head.store(next, std::memory_order_release);
+    arbiter.dispatch();
+    return true;
+}
+
+size_t I2CBusClient::pending() const {
+    return (head.load(std::memory_order_acquire) + queue_size - tail.load(std::memory_order_acquire)) % queue_size;
+}
+
+// Only called by the arbiter while it owns the bus
+I2CRequest* I2CBusClient::take() {
+    size_t position = tail.load(std::memory_order_relaxed);
+    if (position == head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    I2CRequest* request = queue[position];
+    tail.store((position + 1) % queue_size, std::memory_order_release);
+    return request;
+}
+
+I2CBusArbiter::I2CBusArbiter(I2CMaster& master) : master(master) {
+    master.after_transfer([this]() { after_transfer(); });
+}
+
+I2CBusArbiter::~I2CBusArbiter() {
+    master.after_transfer(nullptr);
+}
+
+bool I2CBusArbiter::idle() const {
+    if (busy.load(std::memory_order_acquire)) {
+        return false;
+    }
+    for (size_t i = 0; i < num_clients; i++) {
+        if (clients[i]->pending() > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keeps the clients sorted by priority
+void I2CBusArbiter::add_client(I2CBusClient* client) {
+    if (num_clients == I2C_ARBITER_MAX_CLIENTS) {
+        return;
+    }
+    size_t i = num_clients++;
+    while (i > 0 && clients[i - 1]->priority() > client->priority()) {
+        clients[i] = clients[i - 1];
+        i--;
+    }
+    clients[i] = client;
+}
+
+// Starts the next request unless one is already running. Called by
+// submit() and by the ISR when a request finishes. Whoever sets 'busy'
+// owns the bus until the request finishes.
+void I2CBusArbiter::dispatch() {
+    while (true) {
+        bool expected = false;
+        if (!busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return;
+        }
+        for (size_t i = 0; i < num_clients; i++) {
+            I2CRequest* request = clients[i]->take();
+            if (request) {
+                // Don't touch anything after this. The ISR may already
+                // have finished the request and started the next one.
+                start(request);
+                return;
+            }
+        }
+        busy.store(false, std::memory_order_release);
+
+        // A client may have queued a request after we looked at it
+        bool pending = false;
+        for (size_t i = 0; i < num_clients; i++) {
+            pending |= clients[i]->pending() > 0;
+        }
+        if (!pending) {
+            return;
+        }
+    }
+}
+
+void I2CBusArbiter::start(I2CRequest* request) {
+    current = request;
+    started_us = micros();
+    request->started_us = started_us;
+    if (request->write_length > 0 || request->read_length == 0) {
+        master.write_async(request->address, request->write_buffer, request->write_length,
+                           request->read_length == 0);
+    } else {
+        request->reading = true;
+        master.read_async(request->address, request->read_buffer, request->read_length, true);
+    }
+}
+
+// Called by the master's ISR when a transfer finishes
+void I2CBusArbiter::after_transfer() {
+    I2CRequest* request = current;
+    if (!request) {
+        return;
+    }
+    if (!request->reading && request->read_length > 0 && !master.has_error()) {
+        // Read after a repeated START
+        request->reading = true;
+        master.read_async(request->address, request->read_buffer, request->read_length, true);
+        return;
+    }
+    request->error = master.error();
+    request->bytes_read = request->reading ? master.get_bytes_transferred() : 0;
+    current = nullptr;
+    busy_us = busy_us + (micros() - started_us);
+    request->done.store(true, std::memory_order_release);
+    if (request->on_complete) {
+        request->on_complete(*request);
+    }
+    busy.store(false, std::memory_order_release);
+    dispatch();
+}
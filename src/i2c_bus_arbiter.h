@@ -0,0 +1,131 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_BUS_ARBITER_H
+#define I2C_BUS_ARBITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "i2c_driver.h"
+
+#ifdef __IMXRT1062__
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#endif
+
+// The maximum number of clients that can share one I2CBusArbiter
+#define I2C_ARBITER_MAX_CLIENTS 8
+
+class I2CBusArbiter;
+
+// A transaction queued by an I2CBusClient.
+// If 'write_length' and 'read_length' are both non-zero the arbiter
+// writes then reads with a repeated START in between. e.g. to read
+// a register. Set both to 0 to probe the address.
+// The caller must not change the request or its buffers until
+// finished() returns true.
+struct I2CRequest {
+    uint8_t address = 0;
+    const uint8_t* write_buffer = nullptr;
+    size_t write_length = 0;
+    uint8_t* read_buffer = nullptr;
+    size_t read_length = 0;
+
+    // Called by the ISR when the request has finished. Optional.
+    std::function<void(I2CRequest& request)> on_complete;
+
+    // Set by the arbiter
+    volatile I2CError error = I2CError::ok;
+    volatile size_t bytes_read = 0;
+    volatile uint32_t started_us = 0;   // micros() when the request started on the bus
+
+    inline bool finished() const { return done.load(std::memory_order_acquire); }
+
+private:
+    friend class I2CBusClient;
+    friend class I2CBusArbiter;
+    std::atomic<bool> done{true};
+    bool reading = false;       // The arbiter has finished the write part
+};
+
+// One of several independent users of a master. e.g. the driver for one
+// device. Each client has its own queue so it never waits for a slot
+// behind another client's requests.
+class I2CBusClient {
+public:
+    // 'queue' holds pointers to the client's pending requests.
+    // The client can queue 'queue_size' - 1 requests at once.
+    // Clients with lower 'priority' values are served first.
+    I2CBusClient(I2CBusArbiter& arbiter, I2CRequest** queue, size_t queue_size, uint8_t priority);
+
+    // Queues 'request' and starts it if the bus is free.
+    // Returns false if the queue is full or 'request' is still queued.
+    // Only call this from one thread. i.e. either from loop() or
+    // from one ISR.
+    bool submit(I2CRequest& request);
+
+    // The number of requests that haven't started yet
+    size_t pending() const;
+
+    // The maximum number of requests that can be queued at once
+    inline size_t capacity() const { return queue_size - 1; }
+
+    inline uint8_t priority() const { return _priority; }
+
+private:
+    friend class I2CBusArbiter;
+    I2CBusArbiter& arbiter;
+    I2CRequest** const queue;
+    const size_t queue_size;
+    const uint8_t _priority;
+    std::atomic<size_t> head{0};    // Written by submit(). Where the next request goes.
+    std::atomic<size_t> tail{0};    // Written by the arbiter. The next request to start.
+
+    I2CRequest* take();
+};
+
+// Lets several clients share a master without interfering with each other.
+// Each client queues requests which the arbiter starts one after another.
+// When one request finishes the master's ISR starts the next one straight
+// away so the bus doesn't sit idle waiting for loop().
+//
+// The arbiter starts the oldest request from the highest priority client
+// with something queued. A busy high priority client can starve the
+// others.
+//
+// The arbiter owns the master. Don't call the master directly once
+// the arbiter has been created.
+class I2CBusArbiter {
+public:
+    // Call master.begin() before queuing any requests.
+    explicit I2CBusArbiter(I2CMaster& master);
+
+    // Detaches from the master. Only destroy an idle arbiter.
+    ~I2CBusArbiter();
+
+    // True if no requests are queued or running
+    bool idle() const;
+
+    // The total time that requests have kept the bus busy in microseconds.
+    // It wraps after about 71 minutes so only use the difference
+    // between two calls.
+    inline uint32_t busy_time_us() const { return busy_us; }
+
+private:
+    friend class I2CBusClient;
+    I2CMaster& master;
+    I2CBusClient* clients[I2C_ARBITER_MAX_CLIENTS] = {};
+    size_t num_clients = 0;
+    std::atomic<bool> busy{false};      // True from the moment a request is chosen until it finishes
+    I2CRequest* volatile current = nullptr;
+    uint32_t started_us = 0;            // When 'current' started
+    volatile uint32_t busy_us = 0;
+
+    void add_client(I2CBusClient* client);
+    void dispatch();
+    void start(I2CRequest* request);
+    void after_transfer();
+};
+
+#endif //I2C_BUS_ARBITER_H
@@ -43,6 +43,59 @@ enum class InternalPullup : uint32_t {
     enabled_100k_ohm =  2,
 };
 
+// How the master may access a register.
+enum class RegisterAccess : uint8_t {
+    read_write = 0,         // Master can read and write the register.
+    read_only = 1,          // Master can read the register. Writes are ignored.
+    write_only = 2,         // Master can write the register. Reads return 0x00.
+    write_1_to_clear = 3    // Master clears bits by writing 1s to them. Writing 0 has no effect.
+};
+
+// Describes the access rules for a single register.
+// Only the bits in 'write_mask' can be changed by the master. The
+// others keep their current values.
+struct I2CRegisterAccess {
+    RegisterAccess access;
+    uint8_t write_mask;
+
+    // Returns the register's new value when the master writes 'data'
+    // to a register that holds 'current'.
+    inline uint8_t apply(uint8_t current, uint8_t data) const {
+        switch (access) {
+            case RegisterAccess::read_write:
+            case RegisterAccess::write_only:
+                return (current & ~write_mask) | (data & write_mask);
+            case RegisterAccess::write_1_to_clear:
+                return current & ~(data & write_mask);
+            default:
+                return current;
+        }
+    }
+};
+
+// Cycle counter (ARM_DWT_CYCCNT) values recorded by the ISR during the
+// last transaction. Divide the difference between 2 of them by
+// F_CPU_ACTUAL / 1'000'000 to get microseconds. The counter wraps
+// every few seconds at 600 MHz.
+struct I2CTimestamps {
+    // When the master sent the START. A slave can't see the START so
+    // it uses the same time as 'address' instead.
+    uint32_t start;
+
+    // When the address was sent or matched. The master uses its first
+    // interrupt of the transfer. For a write that's when the address
+    // starts to go out. For a read it's when the first byte arrives.
+    // A slave uses its first interrupt too. That's when the address is
+    // matched if the master reads. If the master writes it's when the
+    // first byte arrives unless the slave is told to timestamp the
+    // address. See IMX_RT1060_I2CSlave::set_timestamp_address().
+    uint32_t address;
+
+    // When the STOP or repeated START was sent or seen. If the master
+    // doesn't send a STOP this is when the transfer finished.
+    uint32_t stop;
+};
+
 // Contains behaviour that's common to both masters and slaves.
 class I2CDriver {
 public:
@@ -59,6 +112,12 @@ public:
         return _error > I2CError::ok;
     }
 
+    // When the last transaction happened. Only valid once it's finished.
+    // A slave should call this from its after_receive() or after_transmit() callback.
+    inline I2CTimestamps get_timestamps() {
+        return I2CTimestamps{timestamp_start, timestamp_address, timestamp_stop};
+    }
+
     // Sets the pad control configuration that will be used for the I2C pins.
     // This sets the drive strength, hysteresis etc.
     // This change takes effect the next time you call begin() or listen().
@@ -80,12 +139,19 @@ public:
 
 protected:
     volatile I2CError _error = I2CError::ok;
+    volatile uint32_t timestamp_start = 0;
+    volatile uint32_t timestamp_address = 0;
+    volatile uint32_t timestamp_stop = 0;
     uint32_t pad_control_config;
     InternalPullup pullup_config;
 };
 
 class I2CMaster : public I2CDriver {
 public:
+    // The most bytes that read_async() can read in one transfer.
+    // Longer reads fail with I2CError::invalid_request.
+    static const size_t max_read_length = 256;
+
     // Configures the master and enables it. You should call this before
     // attempting to communicate with any slaves.
     // 'frequency' determines the bus frequency in Hz. You must not set
@@ -122,6 +188,21 @@ public:
     // Set 'send_stop' to false if are going to make another transfer.
     // Call finished() to see if the call has finished.
     virtual void read_async(uint8_t address, uint8_t* buffer, size_t num_bytes, bool send_stop) = 0;
+
+    // Sets a callback to be called once for each call to write_async()
+    // or read_async() when it has finished. i.e. when finished() becomes
+    // true. It's normally called by the ISR. It's called before
+    // write_async() or read_async() returns if they fail straight away.
+    // e.g. with invalid_request. The callback may start the next transfer.
+    //
+    // If you start a transfer before the previous one has finished, the
+    // previous one is abandoned without calling the callback. The new one
+    // fails with master_not_ready and the callback is called for it.
+    //
+    // Set 'callback' to 'nullptr' to remove the previous callback.
+    // The default implementation ignores the callback. I2CBusArbiter
+    // doesn't work with a master that does this.
+    virtual void after_transfer(std::function<void()> callback) {}
 };
 
 class I2CSlave : public I2CDriver {
@@ -135,6 +216,7 @@ public:
 
     // Like listen(uint8_t) except that the slave will listen on every address
     // in the range from 'first_address' to 'last_address' inclusive.
+    // The slave ACKs all of them so the callbacks must handle every address.
     virtual void listen_range(uint8_t first_address, uint8_t last_address) = 0;
 
     // Detach from the bus. The slave will no longer be visible to the master.
@@ -150,6 +232,34 @@ public:
     // Set 'callback' to 'nullptr' to remove the previous callback.
     virtual void after_receive(std::function<void(size_t length, uint16_t address)> callback) = 0;
 
+    // Sets a callback to be called by the ISR when the master starts
+    // writing to the slave. It's called before the first byte is stored
+    // so the callback may call set_receive_buffer() to choose where the
+    // data goes.
+    // 'address' is the address that the master called. This is only
+    // useful when the slave is listening on multiple addresses.
+    //
+    // Set 'callback' to 'nullptr' to remove the previous callback.
+    // The default implementation ignores the callback.
+    virtual void before_receive(std::function<void(uint16_t address)> callback) {}
+
+    // Sets a callback to be called by the ISR when the master sends a byte
+    // that doesn't fit in the receive buffer. The callback may call
+    // set_receive_buffer() to supply another buffer. If it does, the byte
+    // is stored at the start of the new buffer and the transfer carries on.
+    // Otherwise, the byte is dropped as usual.
+    // This lets a slave receive a header into one buffer and the rest of
+    // the message into another without copying it.
+    // 'address' is the address that the master called.
+    //
+    // Note that after_receive() only counts the bytes stored in the
+    // latest receive buffer.
+    //
+    // Set 'callback' to 'nullptr' to remove the previous callback.
+    // The default implementation ignores the callback so the extra
+    // bytes are always dropped.
+    virtual void after_receive_buffer_full(std::function<void(uint16_t address)> callback) {}
+
     // Sets a callback to be called by the ISR just before
     // the slave transmits a block of data to the master.
     // 'address' is the address that the master called. This is only
@@ -179,8 +289,20 @@ public:
     // of bytes received in the 'length' argument.
     //
     // Note that the slave does not send NACK when the buffer is full.
-    // It just ignores the extra data.
+    // It just ignores the extra data. If 'size' is 0 then the slave drops
+    // every byte and calls 'after_receive' with a length of 0.
     virtual void set_receive_buffer(uint8_t* buffer, size_t size) = 0;
+
+    // Like set_receive_buffer() except that each byte from the master is
+    // merged into the buffer according to the matching entry in 'rules'.
+    // The rule is applied as the byte is stored so the buffer never holds
+    // a value that breaks it. 'rules' must have 'size' entries.
+    //
+    // The default implementation can't apply the rules so it ignores
+    // the data.
+    virtual void set_masked_receive_buffer(uint8_t* buffer, size_t size, const I2CRegisterAccess* rules) {
+        set_receive_buffer(buffer, 0);
+    }
 };
 
 #endif //I2C_DRIVER_H
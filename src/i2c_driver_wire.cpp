@@ -12,7 +12,35 @@ static int toWireResult(I2CError error) {
 }
 
 I2CDriverWire::I2CDriverWire(I2CMaster& master, I2CSlave& slave)
-        : Stream(), master(master), slave(slave) {
+        : I2CDriverWire(master, slave, new uint8_t[rx_buffer_length + tx_buffer_length]()) {
+}
+
+// 'buffers' holds the RX buffer followed by the TX buffer
+I2CDriverWire::I2CDriverWire(I2CMaster& master, I2CSlave& slave, uint8_t* buffers)
+        : I2CDriverWire(master, slave,
+                        buffers, rx_buffer_length,
+                        buffers + rx_buffer_length, tx_buffer_length) {
+    owned_buffers = buffers;
+}
+
+I2CDriverWire::I2CDriverWire(I2CMaster& master, I2CSlave& slave,
+                             uint8_t* rx_buffer, size_t rx_length,
+                             uint8_t* tx_buffer, size_t tx_length)
+        : Stream(), master(master), slave(slave),
+          rxBuffer(rx_buffer), rx_capacity(rx_length),
+          tx_buffer(tx_buffer), tx_capacity(tx_length) {
+}
+
+I2CDriverWire::~I2CDriverWire() {
+    delete[] owned_buffers;
+}
+
+void I2CDriverWire::setReceiveBuffer(uint8_t* buffer, size_t length) {
+    rxBuffer = buffer;
+    rx_capacity = length;
+    rx_bytes_available = 0;
+    rx_next_byte_to_read = 0;
+    slave.set_receive_buffer(buffer, length);
 }
 
 void I2CDriverWire::setClock(uint32_t frequency) {
@@ -41,31 +69,41 @@ void I2CDriverWire::beginRange(uint8_t first_address, uint8_t last_address) {
 
 void I2CDriverWire::prepare_slave() {
     end();
-    slave.set_receive_buffer(rxBuffer, rx_buffer_length);
+    slave.set_receive_buffer(rxBuffer, rx_capacity);
     slave.after_receive(std::bind(&I2CDriverWire::on_receive_wrapper, this, std::placeholders::_1, std::placeholders::_2));
     slave.before_transmit(std::bind(&I2CDriverWire::before_transmit, this, std::placeholders::_1));
 }
 
 void I2CDriverWire::end() {
     master.end();
+    async_pending = false;
+    read_pending = false;
     slave.stop_listening();
     slave.after_receive(nullptr);
     slave.before_transmit(nullptr);
 }
 
 void I2CDriverWire::beginTransmission(int address) {
+    // An asynchronous write may still be reading the transmit buffer
+    wait_for_async_transfer();
     write_address = (uint8_t)address;
     tx_next_byte_to_write = 0;
 }
 
 uint8_t I2CDriverWire::endTransmission(int stop) {
+    endTransmissionAsync(stop);
+    wait_for_async_transfer();
+    return getLastResult();
+}
+
+void I2CDriverWire::endTransmissionAsync(int stop) {
+    wait_for_async_transfer();
     master.write_async(write_address, tx_buffer, tx_next_byte_to_write, stop);
-    finish();
-    return toWireResult(master.error());
+    async_pending = true;
 }
 
 size_t I2CDriverWire::write(uint8_t data) {
-    if (tx_next_byte_to_write < tx_buffer_length) {
+    if (tx_next_byte_to_write < tx_capacity) {
         tx_buffer[tx_next_byte_to_write++] = data;
         return 1;
     }
@@ -73,7 +111,7 @@ size_t I2CDriverWire::write(uint8_t data) {
 }
 
 size_t I2CDriverWire::write(const uint8_t* data, size_t length) {
-    size_t avail = tx_buffer_length - tx_next_byte_to_write;
+    size_t avail = tx_capacity - tx_next_byte_to_write;
     if (avail >= length) {
         uint8_t* dest = tx_buffer + tx_next_byte_to_write;
         memcpy(dest, data, length);
@@ -84,22 +122,61 @@ size_t I2CDriverWire::write(const uint8_t* data, size_t length) {
 }
 
 uint8_t I2CDriverWire::requestFrom(int address, int quantity, int stop) {
+    requestFromAsync(address, quantity, stop);
+    wait_for_async_transfer();
+    return rx_bytes_available;
+}
+
+void I2CDriverWire::requestFromAsync(int address, int quantity, int stop) {
+    wait_for_async_transfer();
     rx_bytes_available = 0;
     rx_next_byte_to_read = 0;
-    master.read_async((uint8_t)address, rxBuffer, min((size_t)quantity, rx_buffer_length), stop);
-    finish();
-    rx_bytes_available = master.get_bytes_transferred();
-    return rx_bytes_available;
+    master.read_async((uint8_t)address, rxBuffer, min((size_t)quantity, rx_capacity), stop);
+    async_pending = true;
+    read_pending = true;
+}
+
+bool I2CDriverWire::done() {
+    // Don't touch the master unless there's a transfer. It may not be enabled.
+    if (!async_pending) {
+        return true;
+    }
+    if (!master.finished()) {
+        return false;
+    }
+    complete_async_transfer(toWireResult(master.error()));
+    return true;
+}
+
+void I2CDriverWire::complete_async_transfer(uint8_t result) {
+    async_pending = false;
+    last_result = result;
+    if (read_pending) {
+        read_pending = false;
+        rx_bytes_available = master.get_bytes_transferred();
+    }
+}
+
+int I2CDriverWire::available() {
+    done();
+    return (int)(rx_bytes_available - rx_next_byte_to_read);
 }
 
 int I2CDriverWire::read() {
+    done();
     if (rx_next_byte_to_read < rx_bytes_available) {
         return rxBuffer[rx_next_byte_to_read++];
     }
     return no_more_bytes;
 }
 
+void I2CDriverWire::skip(size_t count) {
+    size_t remaining = (size_t)available();
+    rx_next_byte_to_read += count < remaining ? count : remaining;
+}
+
 int I2CDriverWire::peek() {
+    done();
     if (rx_next_byte_to_read < rx_bytes_available) {
         return rxBuffer[rx_next_byte_to_read];
     }
@@ -117,14 +194,23 @@ void I2CDriverWire::before_transmit(uint16_t address) {
     slave.set_transmit_buffer(tx_buffer, tx_next_byte_to_write);
 }
 
-void I2CDriverWire::finish() {
+void I2CDriverWire::wait_for_async_transfer() {
+    if (async_pending && !finish()) {
+        // Give up on it. The next transfer will abort it.
+        complete_async_transfer(timeout_result);
+    }
+    done();
+}
+
+// Returns false if the master didn't finish in time
+bool I2CDriverWire::finish() {
     elapsedMillis timeout;
     while (timeout < timeout_millis) {
         if (master.finished()) {
-            return;
+            return true;
         }
     }
-    Serial.println("Timed out waiting for transfer to finish.");
+    return false;
 }
 
 void I2CDriverWire::on_receive_wrapper(size_t num_bytes, uint16_t address) {
@@ -136,6 +222,13 @@ void I2CDriverWire::on_receive_wrapper(size_t num_bytes, uint16_t address) {
     }
 }
 
-I2CDriverWire Wire(Master, Slave);
-I2CDriverWire Wire1(Master1, Slave1);
-I2CDriverWire Wire2(Master2, Slave2);
+static uint8_t wire_rx_buffer[I2CDriverWire::rx_buffer_length];
+static uint8_t wire_tx_buffer[I2CDriverWire::tx_buffer_length];
+static uint8_t wire1_rx_buffer[I2CDriverWire::rx_buffer_length];
+static uint8_t wire1_tx_buffer[I2CDriverWire::tx_buffer_length];
+static uint8_t wire2_rx_buffer[I2CDriverWire::rx_buffer_length];
+static uint8_t wire2_tx_buffer[I2CDriverWire::tx_buffer_length];
+
+I2CDriverWire Wire(Master, Slave, wire_rx_buffer, sizeof(wire_rx_buffer), wire_tx_buffer, sizeof(wire_tx_buffer));
+I2CDriverWire Wire1(Master1, Slave1, wire1_rx_buffer, sizeof(wire1_rx_buffer), wire1_tx_buffer, sizeof(wire1_tx_buffer));
+I2CDriverWire Wire2(Master2, Slave2, wire2_rx_buffer, sizeof(wire2_rx_buffer), wire2_tx_buffer, sizeof(wire2_tx_buffer));
@@ -19,18 +19,57 @@
 // Wire that were part of the Teensy 3 implementation. e.g. setSDA()
 class I2CDriverWire : public Stream {
 public:
-    // Size of RX and TX buffers. Feel free to change sizes if necessary.
-    static const size_t rx_buffer_length = 32;
-    static const size_t tx_buffer_length = 32;
+    // Size of the RX and TX buffers used by Wire, Wire1 and Wire2.
+    // This is the same as the Arduino implementation.
+    static const size_t default_buffer_length = 32;
+
+    // Size of the RX and TX buffers allocated by the 2 argument
+    // constructor. Feel free to change sizes if necessary.
+    static const size_t rx_buffer_length = default_buffer_length;
+    static const size_t tx_buffer_length = default_buffer_length;
 
     // Time to wait for a read or write to complete in millis
     static const uint32_t timeout_millis = 200;
 
+    // The result reported by endTransmission() and getLastResult() when
+    // a transfer didn't finish within timeout_millis. Same as Wire.h.
+    static const uint8_t timeout_result = 5;
+
     // Indicates that there is no more data to read.
     static const int no_more_bytes = -1;
 
+    // Allocates buffers of rx_buffer_length and tx_buffer_length bytes
+    // on the heap. Wire, Wire1 and Wire2 use static buffers instead.
     I2CDriverWire(I2CMaster& master, I2CSlave& slave);
 
+    // 'rx_buffer' limits the number of bytes that requestFrom() can read
+    // and that a slave can receive. 'tx_buffer' limits the number of bytes
+    // that can be written between beginTransmission() and endTransmission()
+    // and the number of bytes a slave can send. Use bigger buffers than the
+    // default if a library transfers more than 32 bytes at a time.
+    // e.g. a display driver. Otherwise it has to split them into several
+    // transactions which each add a START and an address.
+    I2CDriverWire(I2CMaster& master, I2CSlave& slave,
+                  uint8_t* rx_buffer, size_t rx_length,
+                  uint8_t* tx_buffer, size_t tx_length);
+
+    ~I2CDriverWire();
+
+    I2CDriverWire(const I2CDriverWire&) = delete;
+    I2CDriverWire& operator=(const I2CDriverWire&) = delete;
+
+    // The size of the receive buffer
+    inline size_t rxBufferLength() const { return rx_capacity; }
+
+    // The size of the transmit buffer
+    inline size_t txBufferLength() const { return tx_capacity; }
+
+    // Replaces the receive buffer. The slave receives straight into it
+    // and requestFrom() reads into it, so data() points into it too.
+    // Call it before begin() or from the onReceive() callback once
+    // you've finished with data().
+    void setReceiveBuffer(uint8_t* buffer, size_t length);
+
     // Sets the pad control configuration that will be used for the I2C pins.
     // This sets the drive strength, hysteresis etc.
     // This change takes effect the next time you call begin() or listen().
@@ -78,20 +117,60 @@ public:
 
     uint8_t endTransmission(int stop = true);
 
+    // Starts sending the bytes passed to write() and returns without
+    // waiting for the transfer to complete. Call done() to find out when
+    // it's finished and getLastResult() to see whether it worked.
+    // Don't call write() until done() returns true.
+    void endTransmissionAsync(int stop = true);
+
     size_t write(uint8_t data) override;
 
     size_t write(const uint8_t* data, size_t length) override;
 
+    // Returns the number of bytes read. The return type matches Wire.h
+    // so use available() if the receive buffer is bigger than 255 bytes.
     uint8_t requestFrom(int address, int quantity, int stop = true);
 
-    inline int available() override {
-        return (int)(rx_bytes_available - rx_next_byte_to_read);
+    // Starts reading from a slave and returns without waiting for the
+    // transfer to complete. available() returns 0 until it's finished.
+    // Then read() and peek() behave as they do after requestFrom().
+    void requestFromAsync(int address, int quantity, int stop = true);
+
+    // Returns true if the last transfer started by endTransmissionAsync()
+    // or requestFromAsync() has finished. Also true if there isn't one.
+    bool done();
+
+    // Returns the result of the last transfer in the same format as
+    // endTransmission(). Only valid once done() returns true.
+    // 0 = success, 1 = buffer overflow, 2 = address NAK, 3 = data NAK, 4 = other error
+    // 5 = timeout
+    inline uint8_t getLastResult() {
+        done();
+        return last_result;
     }
 
+    int available() override;
+
     int read() override;
 
     int peek() override;
 
+    // The bytes that read() would return next without copying them.
+    // There are length() of them. This is much faster than calling
+    // read() for each byte in an onReceive() callback. Call
+    // skip(length()) afterwards if you want available() to return 0.
+    inline const uint8_t* data() {
+        done();
+        return rxBuffer + rx_next_byte_to_read;
+    }
+
+    inline size_t length() {
+        return (size_t)available();
+    }
+
+    // Discards up to 'count' received bytes as if they had been read
+    void skip(size_t count);
+
     // Registers a function to be called when a slave device receives
     // a transmission from a master.
     //
@@ -136,23 +215,32 @@ private:
     I2CMaster& master;
     I2CSlave& slave;
     uint32_t master_frequency = 100 * 1000U;
+    uint8_t* owned_buffers = nullptr;   // Allocated by the 2 argument constructor
+    uint8_t* rxBuffer;
+    size_t rx_capacity;
+    uint8_t* const tx_buffer;
+    const size_t tx_capacity;
 
     void (* on_receive)(int len) = nullptr;
     void (* on_request)() = nullptr;
 
     uint8_t write_address = 0;
-    uint8_t tx_buffer[tx_buffer_length] = {};
     size_t tx_next_byte_to_write = 0;
 
-    uint8_t rxBuffer[rx_buffer_length] = {};
     size_t rx_bytes_available = 0;
     size_t rx_next_byte_to_read = 0;
+    bool async_pending = false;     // The master may still be busy with a transfer we started
+    bool read_pending = false;      // rx_bytes_available is set when the read finishes
+    uint8_t last_result = 0;        // Set when the last transfer finishes or times out
 
     uint16_t last_address_called = 0xFF;
 
+    I2CDriverWire(I2CMaster& master, I2CSlave& slave, uint8_t* buffers);
     void prepare_slave();
     void before_transmit(uint16_t address);
-    void finish();
+    void wait_for_async_transfer();
+    bool finish();
+    void complete_async_transfer(uint8_t result);
     void on_receive_wrapper(size_t num_bytes, uint16_t address);
 };
 
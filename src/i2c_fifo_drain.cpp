@@ -0,0 +1,177 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <cstring>
+#include "i2c_fifo_drain.h"
+
+I2CFifoDrain::I2CFifoDrain(I2CBusArbiter& arbiter, const I2CFifoDevice& device,
+                           uint8_t* buffer, size_t size, uint8_t priority)
+        : device(device), buffer(buffer), size(size), client(arbiter, queue, 2, priority) {
+    count_request.address = device.address;
+    count_request.write_buffer = &this->device.count_register;
+    count_request.write_length = 1;
+    count_request.read_buffer = count_buffer;
+    count_request.read_length = device.count_length;
+    count_request.on_complete = [this](I2CRequest&) { count_complete(); };
+    data_request.address = device.address;
+    data_request.write_buffer = &this->device.data_register;
+    data_request.write_length = 1;
+    data_request.on_complete = [this](I2CRequest&) { data_complete(); };
+}
+
+bool I2CFifoDrain::start() {
+    if (device.sample_size == 0 || device.sample_size > I2CMaster::max_read_length) {
+        // The ISR could never read a whole sample
+        return false;
+    }
+    running.store(true, std::memory_order_release);
+    return poll();
+}
+
+void I2CFifoDrain::stop() {
+    running.store(false, std::memory_order_release);
+}
+
+bool I2CFifoDrain::poll() {
+    if (!running.load(std::memory_order_acquire)) {
+        return false;
+    }
+    // Only one of poll() and the ISR submits requests at a time
+    bool expected = false;
+    if (draining.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        read_count();
+    }
+    return true;
+}
+
+size_t I2CFifoDrain::available() const {
+    return used(head.load(std::memory_order_acquire), tail.load(std::memory_order_relaxed));
+}
+
+const uint8_t* I2CFifoDrain::peek(size_t& length) const {
+    size_t index = tail.load(std::memory_order_relaxed) % size;
+    length = available();
+    if (length > size - index) {
+        length = size - index;
+    }
+    return buffer + index;
+}
+
+void I2CFifoDrain::consume(size_t length) {
+    if (length > available()) {
+        length = available();
+    }
+    tail.store(advance(tail.load(std::memory_order_relaxed), length), std::memory_order_release);
+}
+
+size_t I2CFifoDrain::read(uint8_t* destination, size_t length) {
+    size_t copied = 0;
+    while (copied < length) {
+        size_t block;
+        const uint8_t* data = peek(block);
+        if (block == 0) {
+            break;
+        }
+        if (block > length - copied) {
+            block = length - copied;
+        }
+        memcpy(destination + copied, data, block);
+        consume(block);
+        copied += block;
+    }
+    return copied;
+}
+
+void I2CFifoDrain::read_count() {
+    if (!client.submit(count_request)) {
+        pause();
+    }
+}
+
+// Reads as much of the FIFO as fits in one transfer and in the
+// space before the end of the ring buffer. Called by the ISR.
+void I2CFifoDrain::read_data() {
+    size_t position = head.load(std::memory_order_relaxed);
+    size_t free_space = size - used(position, tail.load(std::memory_order_acquire));
+    size_t index = position % size;
+    size_t length = remaining;
+    if (length > free_space) {
+        length = free_space;
+    }
+    if (length > size - index) {
+        length = size - index;
+    }
+    if (length > I2CMaster::max_read_length) {
+        length = I2CMaster::max_read_length;
+    }
+    length -= length % device.sample_size;
+    if (length == 0) {
+        // Leave the rest in the device's FIFO until there's room
+        _overflows = _overflows + 1;
+        pause();
+        return;
+    }
+    data_request.read_buffer = buffer + index;
+    data_request.read_length = length;
+    if (!client.submit(data_request)) {
+        pause();
+    }
+}
+
+void I2CFifoDrain::count_complete() {
+    if (count_request.error != I2CError::ok || count_request.bytes_read != device.count_length) {
+        _errors = _errors + 1;
+        pause();
+        return;
+    }
+    uint32_t count = count_buffer[0];
+    if (device.count_length == 2) {
+        count = device.count_big_endian ? (count_buffer[0] << 8) | count_buffer[1]
+                                        : (count_buffer[1] << 8) | count_buffer[0];
+    }
+    count &= device.count_mask;
+    if (device.count_in_samples) {
+        count *= device.sample_size;
+    }
+    remaining = count - count % device.sample_size;
+    if (remaining == 0 || !running.load(std::memory_order_acquire)) {
+        pause();
+        return;
+    }
+    read_data();
+}
+
+void I2CFifoDrain::data_complete() {
+    if (data_request.error != I2CError::ok || data_request.bytes_read != data_request.read_length) {
+        _errors = _errors + 1;
+        pause();
+        return;
+    }
+    head.store(advance(head.load(std::memory_order_relaxed), data_request.read_length), std::memory_order_release);
+    total_bytes = total_bytes + data_request.read_length;
+    remaining -= data_request.read_length;
+    if (!running.load(std::memory_order_acquire)) {
+        pause();
+    } else if (remaining > 0) {
+        read_data();
+    } else {
+        // More samples may have arrived while we were reading
+        read_count();
+    }
+}
+
+// 'head' and 'tail' run from 0 to 2 * size - 1. This tells a full
+// buffer apart from an empty one without wasting a byte.
+size_t I2CFifoDrain::advance(size_t position, size_t length) const {
+    position += length;
+    return position >= 2 * size ? position - 2 * size : position;
+}
+
+size_t I2CFifoDrain::used(size_t head_position, size_t tail_position) const {
+    return head_position >= tail_position ? head_position - tail_position
+                                          : head_position + 2 * size - tail_position;
+}
+
+void I2CFifoDrain::pause() {
+    draining.store(false, std::memory_order_release);
+}
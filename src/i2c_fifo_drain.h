@@ -0,0 +1,108 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_FIFO_DRAIN_H
+#define I2C_FIFO_DRAIN_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "i2c_bus_arbiter.h"
+
+// Describes a device with a FIFO. e.g. an IMU or an ADC.
+// The device reports how much data it has in the count register.
+// Reading the data register takes bytes out of the FIFO.
+struct I2CFifoDevice {
+    uint8_t address = 0;
+    uint8_t count_register = 0;
+    uint8_t count_length = 2;       // 1 or 2 bytes
+    bool count_big_endian = true;   // Most significant byte first
+    uint16_t count_mask = 0xFFFF;   // Clears any status bits in the count register
+    bool count_in_samples = false;  // True if the count is samples rather than bytes
+    uint8_t data_register = 0;
+    // Bytes per sample. Only whole samples are read so it must be
+    // between 1 and I2CMaster::max_read_length.
+    uint16_t sample_size = 1;
+};
+
+// Empties a device's FIFO into a ring buffer without any help from loop().
+//
+// The master's ISR reads the count register then reads that much data
+// straight into the ring buffer. It keeps doing this until the FIFO is
+// empty so there are no gaps between the reads. Call poll() to start
+// draining again. e.g. from an IntervalTimer or a FIFO watermark pin.
+//
+// The ISR only writes to the ring buffer and the application only reads
+// from it so neither has to wait for the other.
+class I2CFifoDrain {
+public:
+    // 'buffer' holds the ring buffer. 'size' must be a multiple of the
+    // device's sample size. The drain uses 'priority' in the arbiter.
+    I2CFifoDrain(I2CBusArbiter& arbiter, const I2CFifoDevice& device,
+                 uint8_t* buffer, size_t size, uint8_t priority = 0);
+
+    // Starts draining the FIFO. Returns false if the device's
+    // sample size is 0 or more than I2CMaster::max_read_length.
+    bool start();
+
+    // Stops after the current read
+    void stop();
+
+    // Drains the FIFO unless it's already being drained.
+    // May be called from an ISR. Returns false if the drain is stopped.
+    bool poll();
+
+    // The number of bytes waiting in the ring buffer
+    size_t available() const;
+
+    // Returns the oldest bytes in the ring buffer without copying them.
+    // Sets 'length' to the number of bytes that can be read in one block.
+    // It's less than available() when the data wraps round the end of
+    // the buffer. Call consume() when you've finished with them.
+    const uint8_t* peek(size_t& length) const;
+
+    // Frees 'length' bytes returned by peek()
+    void consume(size_t length);
+
+    // Copies up to 'length' bytes into 'destination' and frees them.
+    // Returns the number of bytes copied.
+    size_t read(uint8_t* destination, size_t length);
+
+    // The number of times the ring buffer was too full for the data in
+    // the FIFO. The data stays in the device until the next poll().
+    inline uint32_t overflows() const { return _overflows; }
+
+    // The number of reads that failed
+    inline uint32_t errors() const { return _errors; }
+
+    // The total number of bytes read from the device
+    inline uint32_t bytes_read() const { return total_bytes; }
+
+private:
+    const I2CFifoDevice device;
+    uint8_t* const buffer;
+    const size_t size;
+    I2CRequest count_request;
+    I2CRequest data_request;
+    I2CRequest* queue[2] = {};
+    I2CBusClient client;
+    uint8_t count_buffer[2] = {};
+    std::atomic<size_t> head{0};    // Written by the ISR. Where the next byte goes.
+    std::atomic<size_t> tail{0};    // Written by the application. The oldest byte.
+    std::atomic<bool> running{false};
+    std::atomic<bool> draining{false};  // True while the ISR is reading the count or the data
+    size_t remaining = 0;           // Bytes in the FIFO that haven't been read yet
+    volatile uint32_t _overflows = 0;
+    volatile uint32_t _errors = 0;
+    volatile uint32_t total_bytes = 0;
+
+    void read_count();
+    void read_data();
+    void count_complete();
+    void data_complete();
+    void pause();
+    size_t advance(size_t position, size_t length) const;
+    size_t used(size_t head_position, size_t tail_position) const;
+};
+
+#endif //I2C_FIFO_DRAIN_H
@@ -0,0 +1,154 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "i2c_multi_bus.h"
+
+int I2CMultiBusExecutor::add_bus(I2CBusClient& client, uint32_t frequency) {
+    if (num_buses == I2C_MULTI_BUS_MAX_BUSES || frequency == 0) {
+        return -1;
+    }
+    buses[num_buses] = Bus{&client, frequency, 0, 0};
+    return (int)num_buses++;
+}
+
+bool I2CMultiBusExecutor::add(uint8_t bus, I2CRequest& request) {
+    if (!finished() || bus >= num_buses || num_requests == I2C_MULTI_BUS_MAX_REQUESTS) {
+        return false;
+    }
+    Bus& target = buses[bus];
+    if (target.num_requests == target.client->capacity()) {
+        return false;
+    }
+    request.on_complete = [this](I2CRequest& finished_request) { request_complete(finished_request); };
+    requests[num_requests] = &request;
+    request_bus[num_requests] = bus;
+    num_requests++;
+    target.num_requests++;
+    target.bits += bits(request);
+    return true;
+}
+
+bool I2CMultiBusExecutor::clear() {
+    if (!finished()) {
+        return false;
+    }
+    num_requests = 0;
+    for (size_t i = 0; i < num_buses; i++) {
+        buses[i].num_requests = 0;
+        buses[i].bits = 0;
+    }
+    return true;
+}
+
+bool I2CMultiBusExecutor::run(std::function<void()> on_complete) {
+    if (!finished()) {
+        return false;
+    }
+    on_batch_complete = on_complete;
+    _failures.store(0, std::memory_order_relaxed);
+    if (num_requests == 0) {
+        if (on_batch_complete) {
+            on_batch_complete();
+        }
+        return true;
+    }
+    outstanding.store(num_requests, std::memory_order_release);
+    // Queue the requests in the order they were added. The first request
+    // on each bus starts straight away so the buses overlap.
+    for (size_t i = 0; i < num_requests; i++) {
+        if (!buses[request_bus[i]].client->submit(*requests[i])) {
+            // Someone else is using the client's queue or the request
+            batch_item_complete(true);
+        }
+    }
+    return true;
+}
+
+// Called by the master ISRs. Each bus has its own ISR so they may overlap.
+void I2CMultiBusExecutor::request_complete(I2CRequest& request) {
+    batch_item_complete(request.error != I2CError::ok);
+}
+
+void I2CMultiBusExecutor::batch_item_complete(bool failed) {
+    if (failed) {
+        _failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (on_batch_complete) {
+            on_batch_complete();
+        }
+    }
+}
+
+uint32_t I2CMultiBusExecutor::estimated_time_us(uint8_t bus) const {
+    if (bus >= num_buses) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)buses[bus].bits * 1'000'000 / buses[bus].frequency);
+}
+
+uint32_t I2CMultiBusExecutor::estimated_time_us() const {
+    uint32_t slowest = 0;
+    for (size_t i = 0; i < num_buses; i++) {
+        uint32_t time = estimated_time_us(i);
+        if (time > slowest) {
+            slowest = time;
+        }
+    }
+    return slowest;
+}
+
+// 9 bits for each byte including the address plus START and STOP.
+// The repeated START before a read takes about 1 bit.
+uint32_t I2CMultiBusExecutor::bits(const I2CRequest& request) {
+    uint32_t total = 2;
+    if (request.write_length > 0 || request.read_length == 0) {
+        total += 9 * (1 + request.write_length);
+    }
+    if (request.read_length > 0) {
+        total += 9 * (1 + request.read_length);
+        if (request.write_length > 0) {
+            total += 1;
+        }
+    }
+    return total;
+}
+
+void I2CMultiBusExecutor::plan(const uint32_t* load, size_t num_devices,
+                               const uint32_t* frequencies, size_t num_buses, uint8_t* assignment) {
+    if (num_buses == 0) {
+        return;
+    }
+    if (num_buses > I2C_MULTI_BUS_MAX_BUSES) {
+        num_buses = I2C_MULTI_BUS_MAX_BUSES;
+    }
+    uint64_t bus_bits[I2C_MULTI_BUS_MAX_BUSES] = {};
+    bool placed[I2C_MULTI_BUS_MAX_REQUESTS] = {};
+    if (num_devices > I2C_MULTI_BUS_MAX_REQUESTS) {
+        num_devices = I2C_MULTI_BUS_MAX_REQUESTS;
+    }
+    for (size_t n = 0; n < num_devices; n++) {
+        // Find the biggest device we haven't placed yet
+        size_t device = 0;
+        bool found = false;
+        for (size_t i = 0; i < num_devices; i++) {
+            if (!placed[i] && (!found || load[i] > load[device])) {
+                device = i;
+                found = true;
+            }
+        }
+        // Put it on the bus that would finish it first.
+        // Compare (bits + load) / frequency without dividing.
+        size_t best = 0;
+        for (size_t b = 1; b < num_buses; b++) {
+            uint64_t time_b = (bus_bits[b] + load[device]) * frequencies[best];
+            uint64_t time_best = (bus_bits[best] + load[device]) * frequencies[b];
+            if (time_b < time_best) {
+                best = b;
+            }
+        }
+        bus_bits[best] += load[device];
+        assignment[device] = (uint8_t)best;
+        placed[device] = true;
+    }
+}
@@ -0,0 +1,97 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_MULTI_BUS_H
+#define I2C_MULTI_BUS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "i2c_bus_arbiter.h"
+
+// The Teensy 4 has 3 I2C ports. Master, Master1 and Master2.
+#define I2C_MULTI_BUS_MAX_BUSES 3
+
+// The maximum number of requests in one batch
+#define I2C_MULTI_BUS_MAX_REQUESTS 32
+
+// Runs a batch of requests on several buses at the same time and tells
+// you when they've all finished. e.g. reads 18 sensors spread across
+// Master, Master1 and Master2 in about a third of the time it takes
+// to read them all on one bus.
+//
+// Each bus has its own I2CBusArbiter so the buses run independently.
+// The executor queues requests with an I2CBusClient on each bus. The
+// master ISRs start the next request on each bus as soon as the last
+// one finishes.
+class I2CMultiBusExecutor {
+public:
+    // Adds a bus that runs at 'frequency' Hz. Requests are queued with
+    // 'client' so its queue must be big enough for the bus's share of
+    // the batch. Returns the bus number or -1 if there are already
+    // I2C_MULTI_BUS_MAX_BUSES buses.
+    int add_bus(I2CBusClient& client, uint32_t frequency);
+
+    // Adds 'request' to the batch. 'bus' is the bus that the device is
+    // connected to. The executor uses the request's 'on_complete'
+    // callback so don't set it yourself.
+    // Returns false if the batch is running or full or if the bus's
+    // queue is too small.
+    bool add(uint8_t bus, I2CRequest& request);
+
+    // Empties the batch. Returns false if the batch is still running.
+    bool clear();
+
+    // Starts every request in the batch. 'on_complete' is optional. It's
+    // called by the ISR that finishes the last request.
+    // Returns false if the batch is already running.
+    bool run(std::function<void()> on_complete = nullptr);
+
+    // True when every request in the last batch has finished
+    inline bool finished() const { return outstanding.load(std::memory_order_acquire) == 0; }
+
+    // The number of requests in the last batch that failed
+    inline size_t failures() const { return _failures; }
+
+    // The estimated time to run this bus's share of the batch in microseconds.
+    // Ignores clock stretching and the time between transfers.
+    uint32_t estimated_time_us(uint8_t bus) const;
+
+    // The estimated time for the whole batch. i.e. the slowest bus.
+    uint32_t estimated_time_us() const;
+
+    // The number of bits that 'request' puts on the bus
+    static uint32_t bits(const I2CRequest& request);
+
+    // Suggests which bus to connect each device to. Useful when you're
+    // deciding how to wire a board. 'load' is the number of bits each
+    // device transfers per batch. See bits(). Puts the device with the
+    // biggest load on the bus that will finish first until they've all
+    // been placed. Takes each bus's 'frequencies' into account.
+    // Writes the bus number for device 'i' to 'assignment[i]'.
+    // Only plans the first I2C_MULTI_BUS_MAX_REQUESTS devices.
+    static void plan(const uint32_t* load, size_t num_devices,
+                     const uint32_t* frequencies, size_t num_buses, uint8_t* assignment);
+
+private:
+    struct Bus {
+        I2CBusClient* client;
+        uint32_t frequency;
+        size_t num_requests;
+        uint32_t bits;
+    };
+    Bus buses[I2C_MULTI_BUS_MAX_BUSES] = {};
+    size_t num_buses = 0;
+    I2CRequest* requests[I2C_MULTI_BUS_MAX_REQUESTS] = {};
+    uint8_t request_bus[I2C_MULTI_BUS_MAX_REQUESTS] = {};
+    size_t num_requests = 0;
+    std::atomic<size_t> outstanding{0};
+    std::atomic<size_t> _failures{0};
+    std::function<void()> on_batch_complete;
+
+    void request_complete(I2CRequest& request);
+    void batch_item_complete(bool failed);
+};
+
+#endif //I2C_MULTI_BUS_H
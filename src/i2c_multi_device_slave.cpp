@@ -0,0 +1,85 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <cstring>
+#include "i2c_multi_device_slave.h"
+
+I2CMultiDeviceSlave::I2CMultiDeviceSlave(I2CSlave& slave, const I2CEmulatedDevice* devices, size_t num_devices)
+        : slave(slave), devices(devices), num_devices(num_devices) {
+    memset(device_index, no_device, sizeof(device_index));
+    for (size_t i = 0; i < num_devices; i++) {
+        uint8_t address = devices[i].address & I2C_MAX_7_BIT_ADDRESS;
+        device_index[address] = (uint8_t)i;
+        if (address < first_address) {
+            first_address = address;
+        }
+        if (address > last_address) {
+            last_address = address;
+        }
+    }
+}
+
+void I2CMultiDeviceSlave::listen() {
+    if (num_devices == 0) {
+        return;
+    }
+    slave.after_receive(std::bind(&I2CMultiDeviceSlave::after_receive, this, std::placeholders::_1, std::placeholders::_2));
+    slave.before_receive(std::bind(&I2CMultiDeviceSlave::before_receive, this, std::placeholders::_1));
+    slave.before_transmit(std::bind(&I2CMultiDeviceSlave::before_transmit, this, std::placeholders::_1));
+    slave.after_transmit(std::bind(&I2CMultiDeviceSlave::after_transmit, this, std::placeholders::_1));
+
+    // Make sure the slave doesn't use stale buffers if the master
+    // reaches it before we've seen an address.
+    slave.set_receive_buffer(nullptr, 0);
+    slave.set_transmit_buffer(nullptr, 0);
+    if (first_address == last_address) {
+        slave.listen(first_address);
+    } else {
+        slave.listen_range(first_address, last_address);
+    }
+}
+
+void I2CMultiDeviceSlave::stop_listening() {
+    slave.stop_listening();
+    slave.after_receive(nullptr);
+    slave.before_receive(nullptr);
+    slave.before_transmit(nullptr);
+    slave.after_transmit(nullptr);
+}
+
+void I2CMultiDeviceSlave::before_receive(uint16_t address) {
+    const I2CEmulatedDevice* device = find_device(address);
+    if (device) {
+        slave.set_receive_buffer(device->rx_buffer, device->rx_buffer_size);
+    } else {
+        // Nobody lives here. Swallow the data.
+        slave.set_receive_buffer(nullptr, 0);
+    }
+}
+
+void I2CMultiDeviceSlave::after_receive(size_t length, uint16_t address) {
+    const I2CEmulatedDevice* device = find_device(address);
+    if (device && device->after_receive) {
+        device->after_receive(*device, length);
+    }
+}
+
+void I2CMultiDeviceSlave::before_transmit(uint16_t address) {
+    const I2CEmulatedDevice* device = find_device(address);
+    if (device) {
+        if (device->before_transmit) {
+            device->before_transmit(*device);
+        }
+        slave.set_transmit_buffer(device->tx_buffer, device->tx_buffer_size);
+    } else {
+        // The master will receive 0x00 for every byte it reads.
+        slave.set_transmit_buffer(nullptr, 0);
+    }
+}
+
+void I2CMultiDeviceSlave::after_transmit(uint16_t address) {
+    const I2CEmulatedDevice* device = find_device(address);
+    if (device && device->after_transmit) {
+        device->after_transmit(*device);
+    }
+}
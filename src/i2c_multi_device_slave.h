@@ -0,0 +1,115 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_MULTI_DEVICE_SLAVE_H
+#define I2C_MULTI_DEVICE_SLAVE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "i2c_driver.h"
+
+#ifdef __IMXRT1062__
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#endif
+
+// The highest 7-bit I2C address.
+#define I2C_MAX_7_BIT_ADDRESS 0x7F
+
+// Describes one of the devices emulated by I2CMultiDeviceSlave.
+// Each device has its own buffers and its own callbacks. All
+// fields are plain values so a table of devices can be declared
+// constexpr and placed in flash.
+//
+// The callbacks are called from the interrupt service routine.
+// They must be as fast as possible and must not perform any IO.
+// Set a callback to nullptr if you don't need it.
+struct I2CEmulatedDevice {
+    // The device's 7-bit I2C address.
+    uint8_t address;
+
+    // Where to put data written by the master. The master may write
+    // up to 'rx_buffer_size' bytes. Extra bytes are dropped.
+    uint8_t* rx_buffer;
+    size_t rx_buffer_size;
+
+    // The data that the master reads. If the master asks for more than
+    // 'tx_buffer_size' bytes then the device pads the message with 0x00.
+    const uint8_t* tx_buffer;
+    size_t tx_buffer_size;
+
+    // Called after the master has written 'length' bytes to the device.
+    void (* after_receive)(const I2CEmulatedDevice& device, size_t length);
+
+    // Called just before the device transmits 'tx_buffer' to the master.
+    void (* before_transmit)(const I2CEmulatedDevice& device);
+
+    // Called after the device has transmitted data to the master.
+    void (* after_transmit)(const I2CEmulatedDevice& device);
+
+    // Passed through to the callbacks untouched. Use it to find
+    // the application object that represents this device.
+    void* context;
+};
+
+// Makes a single I2CSlave appear to be many different devices.
+// The devices are defined by a table of I2CEmulatedDevice entries.
+//
+// The slave listens to the whole range of addresses covered by
+// the table. When the master calls an address, the ISR finds the
+// matching device with a single table lookup and switches to that
+// device's buffers before the first data byte arrives. Addresses
+// in the range that don't belong to a device are still ACKed. They
+// ignore any data they receive and send 0x00 if the master reads
+// from them.
+//
+// WARNING: This class registers callbacks on the I2CSlave instance that
+// it wraps. e.g. I2CSlave::after_receive(). If you replace these with your
+// own then you'll break I2CMultiDeviceSlave.
+class I2CMultiDeviceSlave {
+public:
+    // 'devices' must remain valid for as long as the slave is listening.
+    // Each device must have a different address.
+    I2CMultiDeviceSlave(I2CSlave& slave, const I2CEmulatedDevice* devices, size_t num_devices);
+
+    // Listens on the range of addresses used by the devices.
+    // Calls listen_range() on the underlying slave driver and then attaches our
+    // event handlers. Don't call listen on the underlying slave directly or it won't work.
+    //
+    // WARNING: The slave ACKs every address from the lowest device address
+    // to the highest, including the ones without a device. The master
+    // can't tell that those devices are missing. Data written to them is
+    // dropped and reads from them return 0x00. Give the devices consecutive
+    // addresses if another device on the bus uses an address in the gap.
+    void listen();
+
+    // Detach from the bus. None of the devices will be visible to the master.
+    void stop_listening();
+
+    // Returns the device that uses 'address' or nullptr if there isn't one.
+    inline const I2CEmulatedDevice* find_device(uint16_t address) const {
+        if (address > I2C_MAX_7_BIT_ADDRESS) {
+            return nullptr;
+        }
+        uint8_t index = device_index[address];
+        return index == no_device ? nullptr : &devices[index];
+    }
+
+private:
+    static const uint8_t no_device = 0xFF;
+
+    I2CSlave& slave;
+    const I2CEmulatedDevice* const devices;
+    const size_t num_devices;
+    uint8_t first_address = I2C_MAX_7_BIT_ADDRESS;
+    uint8_t last_address = 0;
+
+    // Maps each 7-bit address to an index in 'devices'.
+    uint8_t device_index[I2C_MAX_7_BIT_ADDRESS + 1] = {};
+
+    void before_receive(uint16_t address);
+    void after_receive(size_t length, uint16_t address);
+    void before_transmit(uint16_t address);
+    void after_transmit(uint16_t address);
+};
+
+#endif //I2C_MULTI_DEVICE_SLAVE_H
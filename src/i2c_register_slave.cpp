@@ -1,4 +1,4 @@
-// Copyright © 2019-2020 Richard Gemmell
+// Copyright © 2019-2023 Richard Gemmell
 // Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
 
 #include <cstring>
@@ -7,54 +7,176 @@
 void I2CRegisterSlave::listen(uint8_t address) {
     slave.listen(address);
     slave.after_receive(std::bind(&I2CRegisterSlave::after_receive, this, std::placeholders::_1));
+    slave.after_receive_buffer_full(std::bind(&I2CRegisterSlave::after_receive_buffer_full, this));
     slave.after_transmit(std::bind(&I2CRegisterSlave::after_transmit, this));
     wait_for_reg_num();
 }
 
-void I2CRegisterSlave::after_receive(int len) {
-    uint8_t num_bytes = len;
-    got_reg_num = !got_reg_num;
-    if (got_reg_num) {
-        uint8_t reg_num = rx_buffer[0];
-        if (len > 1) {
-            // Master sent register number and data to write to a buffer in one go
-            if (reg_num < mutable_buffer_size) {
-                uint8_t* buffer = mutable_buffer + reg_num;
-                uint8_t buffer_size = mutable_buffer_size - reg_num;
-                size_t copy_len = len - 1;
-                if (copy_len > buffer_size) {
-                    copy_len = buffer_size;
+void I2CRegisterSlave::track_changes(volatile uint32_t* dirty_bitmap) {
+    dirty_registers = dirty_bitmap;
+    for (size_t i = 0; i < REG_SLAVE_DIRTY_WORDS(mutable_buffer_size); i++) {
+        dirty_registers[i] = 0;
+    }
+}
+
+bool I2CRegisterSlave::collect_changes(uint32_t* changed) {
+    bool any_changes = false;
+    if (!dirty_registers) {
+        return false;
+    }
+    for (size_t i = 0; i < REG_SLAVE_DIRTY_WORDS(mutable_buffer_size); i++) {
+        // Read and clear in one step so we can't miss a write from the ISR.
+        changed[i] = __atomic_exchange_n(&dirty_registers[i], 0, __ATOMIC_RELAXED);
+        any_changes |= (changed[i] != 0);
+    }
+    return any_changes;
+}
+
+// Called by the ISR to record that 'count' registers starting at 'first' have changed.
+void I2CRegisterSlave::mark_dirty(size_t first, size_t count) {
+    size_t end = first + count;
+    while (first < end) {
+        size_t bit = first % 32;
+        size_t num_bits = 32 - bit;
+        if (num_bits > end - first) {
+            num_bits = end - first;
+        }
+        uint32_t mask = (num_bits == 32) ? 0xFFFFFFFF : ((1UL << num_bits) - 1) << bit;
+        __atomic_fetch_or(&dirty_registers[first / 32], mask, __ATOMIC_RELAXED);
+        first += num_bits;
+    }
+}
+
+void I2CRegisterSlave::set_access_map(const I2CRegisterAccess* access_map) {
+    this->access_map = access_map;
+}
+
+// The number of mutable registers the master can read starting at reg_num.
+size_t I2CRegisterSlave::readable_length() {
+    if (!access_map) {
+        return mutable_buffer_size - reg_num;
+    }
+    size_t end = reg_num;
+    while (end < mutable_buffer_size && access_map[end].access != RegisterAccess::write_only) {
+        end++;
+    }
+    return end - reg_num;
+}
+
+void I2CRegisterSlave::receive_into_register() {
+    uint8_t* buffer = mutable_buffer + reg_num;
+    size_t buffer_size = mutable_buffer_size - reg_num;
+    if (access_map) {
+        slave.set_masked_receive_buffer(buffer, buffer_size, access_map + reg_num);
+    } else {
+        slave.set_receive_buffer(buffer, buffer_size);
+    }
+}
+
+// Called by the driver when the master sends more bytes than fit
+// in the current receive buffer.
+void I2CRegisterSlave::after_receive_buffer_full() {
+    if (got_reg_num || writing_data) {
+        // The master wrote past the end of the register file.
+        dropped_bytes++;
+        return;
+    }
+    // Master is sending the register number and the data in one go.
+    // Send the rest of the data straight to the register.
+    writing_data = true;
+    reg_num = parse_reg_num();
+    if (reg_num < mutable_buffer_size) {
+        receive_into_register();
+    } else {
+        // Not a writable register. Drop the data.
+        slave.set_receive_buffer(reg_num_buffer, 0);
+    }
+}
+
+void I2CRegisterSlave::enable_snapshots(uint8_t* snapshot_buffer) {
+    snapshots = snapshot_buffer;
+    front_snapshot = 0;
+    reading_snapshot = 0;
+    memcpy(snapshot(front_snapshot), read_only_buffer, read_only_buffer_size);
+}
+
+void I2CRegisterSlave::commit() {
+    if (!snapshots) {
+        return;
+    }
+    // The ISR only ever switches to the front snapshot so any
+    // snapshot that's neither the front one nor the one being read is free.
+    uint8_t front = front_snapshot;
+    uint8_t reading = reading_snapshot;
+    uint8_t next = 0;
+    while (next == front || next == reading) {
+        next++;
+    }
+    memcpy(snapshot(next), read_only_buffer, read_only_buffer_size);
+    // Make sure the copy is complete before the ISR can see it.
+    std::atomic_signal_fence(std::memory_order_release);
+    front_snapshot = next;
+}
+
+void I2CRegisterSlave::after_receive(size_t len) {
+    size_t num_bytes = len + dropped_bytes;
+    if (!writing_data && !got_reg_num) {
+        if (len != reg_num_size) {
+            // Not a register number. Ignore it.
+            wait_for_reg_num();
+            return;
+        }
+        // The next read or write is aimed at this register.
+        reg_num = parse_reg_num();
+        got_reg_num = true;
+        select_register();
+        return;
+    }
+    if (reg_num >= mutable_buffer_size) {
+        // The master tried to write to a read only register.
+        rejected_write_count++;
+        wait_for_reg_num();
+        return;
+    }
+    if (dirty_registers) {
+        // 'len' bytes landed in the mutable buffer.
+        if (access_map) {
+            for (size_t i = reg_num; i < reg_num + len; i++) {
+                if (access_map[i].access != RegisterAccess::read_only) {
+                    mark_dirty(i, 1);
                 }
-                memcpy(buffer, rx_buffer + 1, copy_len);
             }
-            num_bytes = len - 1;
-            // else it's not a valid registry. Ignore it.
-            got_reg_num = false;
         } else {
-            if (reg_num < mutable_buffer_size) {
-                // The coming read or write is aimed at the mutable buffer.
-                uint8_t* buffer = mutable_buffer + reg_num;
-                uint8_t buffer_size = mutable_buffer_size - reg_num;
-                slave.set_receive_buffer(buffer, buffer_size);
-                slave.set_transmit_buffer(buffer, buffer_size);
-            } else {
-                // reg_num is too big for a write. Discard the next write if there is one.
-                slave.set_receive_buffer(rx_buffer, 0);
-
-                uint8_t offset = reg_num - mutable_buffer_size;
-                if (offset < read_only_buffer_size) {
-                    slave.set_transmit_buffer(read_only_buffer + offset, read_only_buffer_size - offset);
-                } else {
-                    // reg_num is too big for a write. The next read will get dummy data.
-                    slave.set_transmit_buffer(read_only_buffer, 0);
-                }
-            }
+            mark_dirty(reg_num, len);
         }
     }
-    if (!got_reg_num) {
-        if (after_write_callback) {
-            after_write_callback(rx_buffer[0], num_bytes);
+    if (after_write_callback) {
+        after_write_callback(reg_num, num_bytes);
+    }
+    wait_for_reg_num();
+}
+
+void I2CRegisterSlave::select_register() {
+    if (reg_num < mutable_buffer_size) {
+        // The coming read or write is aimed at the mutable buffer.
+        receive_into_register();
+        slave.set_transmit_buffer(mutable_buffer + reg_num, readable_length());
+    } else {
+        // reg_num is too big for a write. Drop the next write if there is one.
+        slave.set_receive_buffer(reg_num_buffer, 0);
+
+        const uint8_t* registers = read_only_buffer;
+        if (snapshots) {
+            reading_snapshot = front_snapshot;
+            std::atomic_signal_fence(std::memory_order_acquire);
+            registers = snapshot(reading_snapshot);
+        }
+        size_t offset = reg_num - mutable_buffer_size;
+        if (offset < read_only_buffer_size) {
+            slave.set_transmit_buffer(registers + offset, read_only_buffer_size - offset);
+        } else {
+            // reg_num is too big for a read. The next read will get dummy data.
+            slave.set_transmit_buffer(registers, 0);
         }
-        wait_for_reg_num();
     }
 }
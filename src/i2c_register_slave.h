@@ -1,9 +1,10 @@
-// Copyright © 2019-2020 Richard Gemmell
+// Copyright © 2019-2023 Richard Gemmell
 // Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
 
 #ifndef I2C_REGISTER_SLAVE_H
 #define I2C_REGISTER_SLAVE_H
 
+#include <atomic>
 #include <functional>
 #include <utility>
 #include "i2c_driver.h"
@@ -12,8 +13,19 @@
 #include "imx_rt1060/imx_rt1060_i2c_driver.h"
 #endif
 
-// Needs to be as big as the largest register plus 1 byte for the registry number.
-#define REG_SLAVE_WRITE_BUFFER_LENGTH 9
+// The number of bytes the master sends to select a register.
+enum class RegisterNumberSize : uint8_t {
+    one_byte = 1,   // Up to 256 registers. The usual choice.
+    two_bytes = 2   // Up to 65536 registers. Sent most significant byte first.
+};
+
+// The number of copies of the read_only buffer used by
+// I2CRegisterSlave::enable_snapshots().
+#define REG_SLAVE_SNAPSHOT_COUNT 3
+
+// The number of 32 bit words needed by I2CRegisterSlave::track_changes()
+// to hold one bit for each of 'num_mutable_bytes' registers.
+#define REG_SLAVE_DIRTY_WORDS(num_mutable_bytes) (((num_mutable_bytes) + 31) / 32)
 
 class II2CRegisterSlave {
 public:
@@ -24,11 +36,16 @@ public:
     // Add a callback to be notified when the master has read a register.
     // This is often used to clear the "new data available" flag if
     // there is one.
-    virtual void after_read(std::function<void(uint8_t the_register)> callback) = 0;
+    virtual void after_read(std::function<void(uint16_t the_register)> callback) = 0;
 
     // Add a callback to be notified when the master has written to a
     // register.
-    virtual void after_write(std::function<void(uint8_t the_register, size_t num_bytes)> callback) = 0;
+    virtual void after_write(std::function<void(uint16_t the_register, size_t num_bytes)> callback) = 0;
+
+    // Publishes the current contents of the read_only buffer to the master.
+    // Does nothing unless snapshots are enabled. The default implementation
+    // does nothing.
+    virtual void commit() {}
 };
 
 // Wraps I2CSlave to make it easy to implement an I2C slave whose interface
@@ -42,6 +59,18 @@ public:
 // This class is intended to represent a single I2C device so it does not
 // support multiple slave addresses.
 //
+// The master selects a register by sending a 1 or 2 byte register number.
+// Register numbers are offsets into the mutable buffer followed by the
+// read_only buffer so the register file can hold more than 256 bytes.
+// Data written by the master goes straight into the mutable buffer. There
+// is no limit to the length of a write other than the size of the buffer.
+//
+// By default, the master reads the read_only buffer directly. If the
+// application changes a multibyte value while the master is reading it
+// then the master may get a mixture of old and new bytes. Call
+// enable_snapshots() to prevent this. The master then reads a copy of the
+// read_only buffer that's only updated when the application calls commit().
+//
 // WARNING: This class registers callbacks on the I2CSlave instance that
 // it wraps. e.g. I2CSlave::after_receive(). If you replace these with your
 // own then you'll break I2CRegisterSlave.
@@ -55,10 +84,15 @@ public:
     // 'read_only_buffer' a set of registers that can be read by the master
     // but not written to. These are usually updated in the main application
     // loop. The master is free to read them whenever it pleases.
+    // 'register_number_size' the number of bytes the master sends to select
+    // a register. Use RegisterNumberSize::two_bytes if the combined size of the
+    // buffers is more than 256 bytes.
     I2CRegisterSlave(I2CSlave& slave,
                      uint8_t* mutable_buffer, size_t num_mutable_bytes,
-                     uint8_t* read_only_buffer, size_t num_read_only_bytes)
+                     uint8_t* read_only_buffer, size_t num_read_only_bytes,
+                     RegisterNumberSize register_number_size = RegisterNumberSize::one_byte)
             : slave(slave),
+              reg_num_size(static_cast<size_t>(register_number_size)),
               mutable_buffer(mutable_buffer), mutable_buffer_size(num_mutable_bytes),
               read_only_buffer(read_only_buffer), read_only_buffer_size(num_read_only_bytes) {
     }
@@ -73,7 +107,7 @@ public:
     //
     // WARNING: This callback is called from an interrupt service routine.
     // The callback needs to be as fast as possible and must not perform any IO.
-    inline void after_read(std::function<void(uint8_t the_register)> callback) override {
+    inline void after_read(std::function<void(uint16_t the_register)> callback) override {
         after_read_callback = std::move(callback);
     }
 
@@ -82,35 +116,118 @@ public:
     //
     // WARNING: This callback is called from an interrupt service routine.
     // The callback needs to be as fast as possible and must not perform any IO.
-    inline void after_write(std::function<void(uint8_t the_register, size_t num_bytes)> callback) override {
+    inline void after_write(std::function<void(uint16_t the_register, size_t num_bytes)> callback) override {
         after_write_callback = std::move(callback);
     }
 
+    // Makes the master read a snapshot of the read_only buffer instead of
+    // the buffer itself. The application can then update the read_only
+    // buffer at leisure and call commit() when it's consistent.
+    // 'snapshot_buffer' must hold REG_SLAVE_SNAPSHOT_COUNT * num_read_only_bytes.
+    // Call this before listen(). It publishes the read_only buffer immediately.
+    void enable_snapshots(uint8_t* snapshot_buffer);
+
+    // Copies the read_only buffer into a free snapshot and makes it the
+    // one the master will see next time it selects a register. A read
+    // that's already in progress carries on with the previous snapshot.
+    // This never blocks and never disables interrupts.
+    //
+    // Don't call this from an interrupt service routine.
+    void commit() override;
+
+    // Makes the slave record which mutable registers the master has written to.
+    // This lets the main loop find out what changed without handling
+    // after_write() in the ISR. Register N is bit (N % 32) of word (N / 32).
+    // 'dirty_bitmap' must hold REG_SLAVE_DIRTY_WORDS(num_mutable_bytes) words.
+    // Call this before listen().
+    void track_changes(volatile uint32_t* dirty_bitmap);
+
+    // Copies the set of registers that the master has written to since the
+    // last call into 'changed' and clears them. Uses the same layout as
+    // track_changes(). 'changed' must be as big as the dirty bitmap.
+    // Returns true if any registers have changed.
+    //
+    // Don't call this from an interrupt service routine.
+    bool collect_changes(uint32_t* changed);
+
+    // Applies access rules to the mutable registers. Without a map, the
+    // master can read and write every bit of every mutable register.
+    // 'access_map' must hold one entry for each mutable register. It's
+    // intended to be declared constexpr so it lives in flash.
+    //
+    // The driver applies the rules as it stores each byte so the master
+    // never sees a value that breaks them. Reads of the mutable buffer
+    // stop at the first write only register. The master receives 0x00
+    // for that register and any that follow it.
+    // Call this before listen().
+    void set_access_map(const I2CRegisterAccess* access_map);
+
+    // The number of writes that the slave has ignored because the master
+    // aimed them at a read only register or one that doesn't exist.
+    // The slave doesn't call after_write() for these.
+    inline uint32_t rejected_writes() const {
+        return rejected_write_count;
+    }
+
+    // True if 'the_register' is set in a bitmap returned by collect_changes().
+    static inline bool is_changed(const uint32_t* changed, uint16_t the_register) {
+        return changed[the_register / 32] & (1UL << (the_register % 32));
+    }
+
 private:
     I2CSlave& slave;
-    uint8_t rx_buffer[REG_SLAVE_WRITE_BUFFER_LENGTH] = {};
+    const size_t reg_num_size;
+    uint8_t reg_num_buffer[sizeof(uint16_t)] = {};
+    uint16_t reg_num = 0;
     bool got_reg_num = false;
+    bool writing_data = false;      // True if the master's data is landing in the mutable buffer.
+    size_t dropped_bytes = 0;       // Bytes sent by the master that didn't fit anywhere.
+    volatile uint32_t rejected_write_count = 0;
     uint8_t* const mutable_buffer;
     const size_t mutable_buffer_size;
     uint8_t* const read_only_buffer;
     const size_t read_only_buffer_size;
-    std::function<void(uint8_t the_register)> after_read_callback = nullptr;
-    std::function<void(uint8_t the_register, size_t num_bytes)> after_write_callback = nullptr;
-
-    void after_receive(int len);
+    uint8_t* snapshots = nullptr;
+    volatile uint8_t front_snapshot = 0;    // Written by commit(). The latest snapshot.
+    volatile uint8_t reading_snapshot = 0;  // Written by the ISR. The snapshot the master is reading.
+    volatile uint32_t* dirty_registers = nullptr;
+    const I2CRegisterAccess* access_map = nullptr;
+
+    std::function<void(uint16_t the_register)> after_read_callback = nullptr;
+    std::function<void(uint16_t the_register, size_t num_bytes)> after_write_callback = nullptr;
+
+    void after_receive(size_t len);
+    void after_receive_buffer_full();
+    void select_register();
+    void mark_dirty(size_t first, size_t count);
+    void receive_into_register();
+    size_t readable_length();
 
     inline void after_transmit() {
         wait_for_reg_num();
         if (after_read_callback) {
-            after_read_callback(rx_buffer[0]);
+            after_read_callback(reg_num);
         }
     }
 
     inline void wait_for_reg_num() {
         got_reg_num = false;
-        slave.set_receive_buffer(rx_buffer, REG_SLAVE_WRITE_BUFFER_LENGTH);
+        writing_data = false;
+        dropped_bytes = 0;
+        slave.set_receive_buffer(reg_num_buffer, reg_num_size);
         slave.set_transmit_buffer(mutable_buffer, 0);
     }
+
+    inline uint8_t* snapshot(uint8_t index) {
+        return snapshots + (index * read_only_buffer_size);
+    }
+
+    inline uint16_t parse_reg_num() {
+        if (reg_num_size == sizeof(uint16_t)) {
+            return (reg_num_buffer[0] << 8) | reg_num_buffer[1];
+        }
+        return reg_num_buffer[0];
+    }
 };
 
 #endif //I2C_REGISTER_SLAVE_H
@@ -0,0 +1,128 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <Arduino.h>
+#include <cstring>
+#include "i2c_scheduler.h"
+
+I2CPeriodicRead::I2CPeriodicRead(uint8_t address, const uint8_t* write_buffer, size_t write_length,
+                                 size_t read_length, uint32_t period_us, uint8_t* storage)
+        : period_us(period_us), read_length(read_length), storage(storage) {
+    request.address = address;
+    request.write_buffer = write_buffer;
+    request.write_length = write_length;
+    request.read_length = read_length;
+    request.on_complete = [this](I2CRequest&) { complete(); };
+}
+
+bool I2CPeriodicRead::latest(uint8_t* destination, uint32_t* timestamp_us) const {
+    while (true) {
+        uint32_t published = sequence.load(std::memory_order_acquire);
+        if (published == 0) {
+            return false;
+        }
+        size_t half = published & 1;
+        memcpy(destination, storage + half * read_length, read_length);
+        uint32_t timestamp = timestamps[half];
+        // The ISR only writes to this half after publishing another sample
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == published) {
+            if (timestamp_us) {
+                *timestamp_us = timestamp;
+            }
+            return true;
+        }
+    }
+}
+
+// Reads into the half that latest() isn't using
+void I2CPeriodicRead::prepare() {
+    size_t half = (sequence.load(std::memory_order_relaxed) + 1) & 1;
+    request.read_buffer = storage + half * read_length;
+    read_due_us = due_us;
+    overran = false;
+}
+
+// Counts the current read as a deadline miss unless it's already been counted
+void I2CPeriodicRead::overrun() {
+    if (!overran) {
+        overran = true;
+        misses = misses + 1;
+    }
+}
+
+// Called by the ISR when the read finishes
+void I2CPeriodicRead::complete() {
+    if (micros() - read_due_us > period_us) {
+        overrun();
+    }
+    if (request.error != I2CError::ok || request.bytes_read != read_length) {
+        _errors = _errors + 1;
+        return;
+    }
+    uint32_t published = sequence.load(std::memory_order_relaxed) + 1;
+    timestamps[published & 1] = request.started_us;
+    sequence.store(published, std::memory_order_release);
+}
+
+I2CScheduler::I2CScheduler(I2CBusArbiter& arbiter, uint8_t priority)
+        : arbiter(arbiter), client(arbiter, queue, I2C_SCHEDULER_MAX_TASKS + 1, priority) {
+}
+
+bool I2CScheduler::add(I2CPeriodicRead& task) {
+    if (num_tasks == I2C_SCHEDULER_MAX_TASKS) {
+        return false;
+    }
+    tasks[num_tasks++] = &task;
+    return true;
+}
+
+void I2CScheduler::start() {
+    uint32_t now = micros();
+    for (size_t i = 0; i < num_tasks; i++) {
+        tasks[i]->due_us = now;
+    }
+    window_start_us = now;
+    window_busy_us = arbiter.busy_time_us();
+    running = true;
+}
+
+void I2CScheduler::stop() {
+    running = false;
+}
+
+void I2CScheduler::on_timer() {
+    if (!running) {
+        return;
+    }
+    uint32_t now = micros();
+    for (size_t i = 0; i < num_tasks; i++) {
+        I2CPeriodicRead& task = *tasks[i];
+        if ((int32_t)(now - task.due_us) < 0) {
+            continue;
+        }
+        if (task.request.finished()) {
+            task.prepare();
+            client.submit(task.request);
+        } else {
+            // The last read is still running
+            task.overrun();
+        }
+        // Skip any periods we've missed completely rather than
+        // starting several reads in a row to catch up.
+        task.due_us += task.period_us;
+        if ((int32_t)(now - task.due_us) >= 0) {
+            task.due_us = now + task.period_us;
+        }
+    }
+}
+
+float I2CScheduler::bus_utilisation() {
+    uint32_t now = micros();
+    uint32_t busy = arbiter.busy_time_us();
+    uint32_t elapsed = now - window_start_us;
+    float utilisation = elapsed ? (float)(busy - window_busy_us) / elapsed : 0.0f;
+    window_start_us = now;
+    window_busy_us = busy;
+    return utilisation;
+}
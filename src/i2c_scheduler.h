@@ -0,0 +1,109 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_SCHEDULER_H
+#define I2C_SCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "i2c_bus_arbiter.h"
+
+// The maximum number of periodic reads that one I2CScheduler can run
+#define I2C_SCHEDULER_MAX_TASKS 8
+
+// Reads the same bytes from a device at a fixed rate. e.g. reads 6 bytes
+// from an IMU's register 0x3B every 1000 microseconds.
+//
+// The latest sample is kept in a double buffer. The ISR writes the next
+// sample into one half while the application reads the other, so
+// latest() never blocks the ISR and never returns half of one sample and
+// half of another.
+class I2CPeriodicRead {
+public:
+    // 'write_buffer' is sent before each read. Usually the register number.
+    // Set 'write_length' to 0 to read without writing first.
+    // 'storage' holds 2 samples so it must be at least 2 * 'read_length' bytes.
+    I2CPeriodicRead(uint8_t address, const uint8_t* write_buffer, size_t write_length,
+                    size_t read_length, uint32_t period_us, uint8_t* storage);
+
+    // Copies the latest sample into 'destination' which must hold 'read_length' bytes.
+    // 'timestamp_us' is set to micros() when the arbiter started the read
+    // on the bus. This is later than when the read was due if the bus was busy.
+    // Returns false if there hasn't been a successful read yet.
+    // Don't call this from an interrupt service routine.
+    bool latest(uint8_t* destination, uint32_t* timestamp_us = nullptr) const;
+
+    // The number of successful reads
+    inline uint32_t samples() const { return sequence.load(std::memory_order_relaxed); }
+
+    // The number of reads that failed. e.g. because the device didn't reply.
+    inline uint32_t errors() const { return _errors; }
+
+    // The number of reads that hadn't finished 'period_us' after they were
+    // due. i.e. the next read was due first. Each late read counts once.
+    inline uint32_t deadline_misses() const { return misses; }
+
+    const uint32_t period_us;
+
+private:
+    friend class I2CScheduler;
+    I2CRequest request;
+    const size_t read_length;
+    uint8_t* const storage;
+    uint32_t timestamps[2] = {};
+    std::atomic<uint32_t> sequence{0};  // Samples published. The latest is in half 'sequence & 1'.
+    uint32_t due_us = 0;                // When the next read should start
+    uint32_t read_due_us = 0;           // When the current read was due
+    volatile bool overran = false;      // The current read has been counted as a deadline miss
+    volatile uint32_t _errors = 0;
+    volatile uint32_t misses = 0;
+
+    void prepare();
+    void overrun();
+    void complete();
+};
+
+// Starts periodic reads from a timer interrupt so they don't depend on
+// how busy loop() is. The reads are queued on an I2CBusArbiter so other
+// clients can share the bus.
+//
+// Call on_timer() from an IntervalTimer that runs at least as often as
+// the shortest period. The timer's period sets the jitter. e.g.
+//   IntervalTimer timer;
+//   scheduler.start();
+//   timer.begin([]() { scheduler.on_timer(); }, 100);
+class I2CScheduler {
+public:
+    // The scheduler's reads have 'priority' in the arbiter.
+    explicit I2CScheduler(I2CBusArbiter& arbiter, uint8_t priority = 0);
+
+    // Adds a read to the schedule. Call this before start().
+    // Returns false if the schedule is full.
+    bool add(I2CPeriodicRead& task);
+
+    // Makes every read due straight away
+    void start();
+
+    // Stops starting reads. Reads that have already started will finish.
+    void stop();
+
+    // Starts the reads that are due. Call this from a timer ISR.
+    void on_timer();
+
+    // The fraction of the time since the last call that the bus was busy.
+    // Includes requests from the arbiter's other clients.
+    float bus_utilisation();
+
+private:
+    I2CBusArbiter& arbiter;
+    I2CRequest* queue[I2C_SCHEDULER_MAX_TASKS + 1] = {};
+    I2CBusClient client;
+    I2CPeriodicRead* tasks[I2C_SCHEDULER_MAX_TASKS] = {};
+    size_t num_tasks = 0;
+    volatile bool running = false;
+    uint32_t window_start_us = 0;
+    uint32_t window_busy_us = 0;
+};
+
+#endif //I2C_SCHEDULER_H
@@ -0,0 +1,107 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <Arduino.h>
+#include <atomic>
+#include <cstring>
+#include "i2c_transaction_log.h"
+
+void I2CTransactionLog::record(uint8_t flags, uint16_t address, size_t length, const uint8_t* payload, I2CError error) {
+    size_t payload_length = length < max_payload ? length : max_payload;
+    if (payload == nullptr) {
+        payload_length = 0;
+    }
+    if (payload_length < length) {
+        flags |= I2C_LOG_FLAG_TRUNCATED;
+    }
+    size_t entry_length = I2C_LOG_HEADER_LENGTH + payload_length;
+
+    // One byte is always left empty so that head == tail means the log is empty.
+    size_t position = head;
+    if (entry_length >= size - available()) {
+        dropped_entries++;
+        return;
+    }
+
+    uint32_t timestamp = micros();
+    uint16_t count = length < UINT16_MAX ? length : UINT16_MAX;
+    uint8_t header[I2C_LOG_HEADER_LENGTH] = {
+        I2C_LOG_MARKER,
+        flags,
+        static_cast<uint8_t>(error),
+        static_cast<uint8_t>(payload_length),
+        static_cast<uint8_t>(timestamp), static_cast<uint8_t>(timestamp >> 8),
+        static_cast<uint8_t>(timestamp >> 16), static_cast<uint8_t>(timestamp >> 24),
+        static_cast<uint8_t>(address), static_cast<uint8_t>(address >> 8),
+        static_cast<uint8_t>(count), static_cast<uint8_t>(count >> 8)
+    };
+    copy_in(position, header, sizeof(header));
+    copy_in((position + sizeof(header)) % size, payload, payload_length);
+
+    // Make sure the entry is complete before the reader can see it.
+    std::atomic_signal_fence(std::memory_order_release);
+    head = (position + entry_length) % size;
+}
+
+size_t I2CTransactionLog::available() const {
+    return size == 0 ? 0 : (head + size - tail) % size;
+}
+
+size_t I2CTransactionLog::read(uint8_t* destination, size_t max_length) {
+    size_t length = available();
+    if (length > max_length) {
+        length = max_length;
+    }
+    if (length == 0) {
+        return 0;
+    }
+    std::atomic_signal_fence(std::memory_order_acquire);
+    size_t position = tail;
+    size_t first = size - position;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(destination, buffer + position, first);
+    memcpy(destination + first, buffer, length - first);
+    std::atomic_signal_fence(std::memory_order_release);
+    tail = (position + length) % size;
+    return length;
+}
+
+size_t I2CTransactionLog::write_to(Print& out) {
+    size_t total = 0;
+    size_t length = available();
+    std::atomic_signal_fence(std::memory_order_acquire);
+    while (length > 0) {
+        // Write the contiguous bytes up to the end of the buffer in one go.
+        size_t position = tail;
+        size_t chunk = size - position;
+        if (chunk > length) {
+            chunk = length;
+        }
+        out.write(buffer + position, chunk);
+        std::atomic_signal_fence(std::memory_order_release);
+        tail = (position + chunk) % size;
+        total += chunk;
+        length -= chunk;
+    }
+    return total;
+}
+
+void I2CTransactionLog::clear() {
+    tail = head;
+    dropped_entries = 0;
+}
+
+// Copies 'length' bytes into the ring buffer starting at 'position'.
+void I2CTransactionLog::copy_in(size_t position, const uint8_t* source, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    size_t first = size - position;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(buffer + position, source, first);
+    memcpy(buffer, source + first, length - first);
+}
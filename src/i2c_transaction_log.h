@@ -0,0 +1,91 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_TRANSACTION_LOG_H
+#define I2C_TRANSACTION_LOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include "i2c_driver.h"
+
+class Print;
+
+// Each entry in the log is a 12 byte header followed by the payload.
+// Multibyte fields are little endian.
+//
+//   offset  size  field
+//        0     1  marker. Always I2C_LOG_MARKER
+//        1     1  flags. Port number (0 for LPI2C1) in bits 0-2 plus I2C_LOG_FLAG_*
+//        2     1  error. An I2CError
+//        3     1  payload_length. The number of payload bytes that follow the header
+//        4     4  timestamp. micros() when the transaction ended
+//        8     2  address. The 7 bit address the master called
+//       10     2  length. The number of bytes transferred
+//       12     n  payload. The first 'payload_length' bytes of the transfer
+//
+// tools/transaction_log/decode_transaction_log.py converts a log to CSV or JSON.
+#define I2C_LOG_MARKER 0xA5
+#define I2C_LOG_HEADER_LENGTH 12
+#define I2C_LOG_FLAG_PORT_MASK 0x07
+#define I2C_LOG_FLAG_SLAVE 0x08         // Recorded by a slave. Otherwise by a master.
+#define I2C_LOG_FLAG_READ 0x10          // The master read from the slave. Otherwise it wrote.
+#define I2C_LOG_FLAG_TRUNCATED 0x20     // The payload holds fewer bytes than 'length'
+
+// A fixed size ring buffer that records I2C transactions in a compact
+// binary format. The drivers append an entry from their ISRs at the end
+// of each transaction. Recording is just a copy so it doesn't change the
+// bus timing the way Serial.print() does in DEBUG_I2C builds. The main
+// loop streams the log out in bulk with write_to() or read().
+//
+// The log never overwrites entries that haven't been read. If it's full,
+// new entries are dropped and counted.
+//
+// One log may be shared by several ports as long as their ISRs can't
+// interrupt each other. That's true if they have the same priority which
+// is the default.
+class I2CTransactionLog {
+public:
+    // 'buffer' holds the log. Bigger buffers let the main loop read the
+    // log less often.
+    // 'max_payload' limits the number of payload bytes stored for each
+    // transaction. Use 0 to record the headers only.
+    I2CTransactionLog(uint8_t* buffer, size_t size, uint8_t max_payload = 16)
+        : buffer(buffer), size(size), max_payload(max_payload) {
+    }
+
+    // Appends an entry to the log. Called by the drivers from their ISRs.
+    // 'payload' holds the bytes transferred. It may be nullptr if 'length' is 0.
+    void record(uint8_t flags, uint16_t address, size_t length, const uint8_t* payload, I2CError error);
+
+    // The number of bytes waiting to be read
+    size_t available() const;
+
+    // Copies up to 'max_length' bytes out of the log and removes them.
+    // Entries may be split across calls. Returns the number of bytes copied.
+    // Don't call this from an interrupt service routine.
+    size_t read(uint8_t* destination, size_t max_length);
+
+    // Writes everything in the log to 'out' and removes it. e.g. Serial
+    // Returns the number of bytes written.
+    // Don't call this from an interrupt service routine.
+    size_t write_to(Print& out);
+
+    // The number of entries dropped because the log was full
+    inline uint32_t dropped() const { return dropped_entries; }
+
+    // Discards everything in the log. Don't call this while
+    // a driver that uses the log is active.
+    void clear();
+
+private:
+    uint8_t* const buffer;
+    const size_t size;
+    const uint8_t max_payload;
+    volatile size_t head = 0;       // Written by the ISR. Where the next entry goes.
+    volatile size_t tail = 0;       // Written by the reader. The next byte to read.
+    volatile uint32_t dropped_entries = 0;
+
+    void copy_in(size_t position, const uint8_t* source, size_t length);
+};
+
+#endif //I2C_TRANSACTION_LOG_H
@@ -0,0 +1,34 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <Arduino.h>
+#include "i2c_triggered_read.h"
+
+I2CTriggeredRead::I2CTriggeredRead(I2CBusArbiter& arbiter, uint8_t address,
+                                   const uint8_t* write_buffer, size_t write_length,
+                                   uint8_t* read_buffer, size_t read_length, uint8_t priority)
+        : client(arbiter, queue, 2, priority) {
+    request.address = address;
+    request.write_buffer = write_buffer;
+    request.write_length = write_length;
+    request.read_buffer = read_buffer;
+    request.read_length = read_length;
+    request.on_complete = [this](I2CRequest& finished_request) {
+        if (callback) {
+            callback(finished_request, timestamp_us);
+        }
+    };
+}
+
+void I2CTriggeredRead::on_complete(std::function<void(const I2CRequest& request, uint32_t timestamp_us)> new_callback) {
+    callback = new_callback;
+}
+
+bool I2CTriggeredRead::trigger() {
+    if (!request.finished()) {
+        _overruns = _overruns + 1;
+        return false;
+    }
+    timestamp_us = micros();
+    return client.submit(request);
+}
@@ -0,0 +1,55 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_TRIGGERED_READ_H
+#define I2C_TRIGGERED_READ_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "i2c_bus_arbiter.h"
+
+// Starts a prepared read as soon as a device says it has data. e.g. when
+// an IMU raises its data ready (DRDY) pin.
+//
+// Call trigger() from the pin's interrupt. The read starts inside the
+// interrupt if the bus is free or as soon as the current request
+// finishes if it isn't. loop() isn't involved so there's no extra latency.
+//   I2CTriggeredRead imu_read(arbiter, 0x68, &reg, 1, sample, 6);
+//   attachInterrupt(DRDY_PIN, []() { imu_read.trigger(); }, RISING);
+class I2CTriggeredRead {
+public:
+    // Writes 'write_buffer' then reads 'read_length' bytes into 'read_buffer'
+    // after a repeated START. Set 'write_length' to 0 to read without
+    // writing first. The read has 'priority' in the arbiter. Use 0 to
+    // start it before requests from other clients.
+    I2CTriggeredRead(I2CBusArbiter& arbiter, uint8_t address,
+                     const uint8_t* write_buffer, size_t write_length,
+                     uint8_t* read_buffer, size_t read_length, uint8_t priority = 0);
+
+    // Called by the master's ISR when the read finishes. 'timestamp_us'
+    // is micros() when trigger() was called. Check request.error before
+    // using the data. 'read_buffer' won't change until the next trigger().
+    void on_complete(std::function<void(const I2CRequest& request, uint32_t timestamp_us)> callback);
+
+    // Starts the read. Call this from the pin's ISR.
+    // Returns false if the last read hasn't finished yet.
+    bool trigger();
+
+    // True when the last read has finished
+    inline bool finished() const { return request.finished(); }
+
+    // The number of times trigger() was called while a read was running.
+    // If this goes up the bus is too slow for the data rate.
+    inline uint32_t overruns() const { return _overruns; }
+
+private:
+    I2CRequest request;
+    I2CRequest* queue[2] = {};
+    I2CBusClient client;
+    std::function<void(const I2CRequest& request, uint32_t timestamp_us)> callback;
+    volatile uint32_t timestamp_us = 0;
+    volatile uint32_t _overruns = 0;
+};
+
+#endif //I2C_TRIGGERED_READ_H
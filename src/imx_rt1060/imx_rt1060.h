@@ -6,6 +6,10 @@
 
 #include <cstdint>
 
+#ifdef LPI2C_SIMULATOR
+// Runs the driver on the host against simulated peripherals. See host/README.md.
+#include "simulated_lpi2c.h"
+#else
 typedef struct {
 	const uint32_t VERID;
 	const uint32_t PARAM;
@@ -53,5 +57,6 @@ typedef struct {
 #define LPI2C2		(*(IMXRT_LPI2C_Registers *)0x403F4000)  // Not connected to any pins on the Teensy 4.0
 #define LPI2C3		(*(IMXRT_LPI2C_Registers *)0x403F8000)
 #define LPI2C4		(*(IMXRT_LPI2C_Registers *)0x403FC000)
+#endif
 
 #endif //IMX_RT1060_H
\ No newline at end of file
@@ -14,12 +14,12 @@
 #include <imxrt.h>
 #include <pins_arduino.h>
 #include "imx_rt1060_i2c_driver.h"
+#include "../i2c_transaction_log.h"
 
 #define DUMMY_BYTE 0x00 // Used when there's no real data to write.
 #define NUM_FIFOS 4     // Number of Rx and Tx FIFOs available to master
 #define MASTER_READ 1   // Makes the address a read request
 #define MASTER_WRITE 0  // Makes the address a write request
-#define MAX_MASTER_READ_LENGTH 256  // Maximum number of bytes that can be read by a single Master read
 #define CLOCK_STRETCH_TIMEOUT 15000 // Timeout if a device stretches SCL this long, in microseconds
 
 // Debug tools
@@ -247,6 +247,7 @@ size_t IMX_RT1060_I2CMaster::get_bytes_transferred() {
 
 void IMX_RT1060_I2CMaster::write_async(uint8_t address, const uint8_t* buffer, size_t num_bytes, bool send_stop) {
     if (!start(address, MASTER_WRITE)) {
+        transfer_failed();
         return;
     }
     if (num_bytes == 0) {
@@ -263,12 +264,14 @@ void IMX_RT1060_I2CMaster::write_async(uint8_t address, const uint8_t* buffer, s
 }
 
 void IMX_RT1060_I2CMaster::read_async(uint8_t address, uint8_t* buffer, size_t num_bytes, bool send_stop) {
-    if (num_bytes > MAX_MASTER_READ_LENGTH) {
+    if (num_bytes > max_read_length) {
         _error = I2CError::invalid_request;
+        transfer_failed();
         return;
     }
 
     if (!start(address, MASTER_READ)) {
+        transfer_failed();
         return;
     }
     if (num_bytes == 0) {
@@ -329,6 +332,10 @@ void IMX_RT1060_I2CMaster::_interrupt_service_routine() {
             abort_transaction_async();
         }
         // else already trying to end the transaction
+        if (!(port->MSR & LPI2C_MSR_MBF)) {
+            // We don't own the bus so there won't be a STOP to wait for
+            state = State::idle;
+        }
     }
 
     if (msr & LPI2C_MSR_SDF) {
@@ -340,6 +347,9 @@ void IMX_RT1060_I2CMaster::_interrupt_service_routine() {
     if (msr & LPI2C_MSR_RDF) {
         if (ignore_tdf) {
             if (buff.not_started_reading()) {
+                if (state == State::starting) {
+                    timestamp_address = ARM_DWT_CYCCNT;
+                }
                 _error = I2CError::ok;
                 state = State::transferring;
             }
@@ -365,6 +375,9 @@ void IMX_RT1060_I2CMaster::_interrupt_service_routine() {
 
     if (!ignore_tdf && (msr & LPI2C_MSR_TDF)) {
         if (buff.not_started_writing()) {
+            if (state == State::starting) {
+                timestamp_address = ARM_DWT_CYCCNT;
+            }
             _error = I2CError::ok;
             state = State::transferring;
         }
@@ -388,6 +401,42 @@ void IMX_RT1060_I2CMaster::_interrupt_service_routine() {
         }
         // else ignore it. This flag is frequently set in read transfers.
     }
+
+    if (timestamp_pending && finished()) {
+        timestamp_pending = false;
+        timestamp_stop = ARM_DWT_CYCCNT;
+        if (!has_error() && timestamp_address == 0) {
+            // A probe. There weren't any data interrupts.
+            timestamp_address = timestamp_stop;
+        }
+    }
+    if (log_pending && finished()) {
+        log_transaction();
+    }
+    if (callback_pending && finished()) {
+        // The callback may start another transfer
+        callback_pending = false;
+        after_transfer_callback();
+    }
+}
+
+void IMX_RT1060_I2CMaster::after_transfer(std::function<void()> callback) {
+    after_transfer_callback = callback;
+}
+
+// Reports a transfer that couldn't be started so there won't be an interrupt.
+void IMX_RT1060_I2CMaster::transfer_failed() {
+    callback_pending = false;
+    if (after_transfer_callback) {
+        after_transfer_callback();
+    }
+}
+
+void IMX_RT1060_I2CMaster::log_transaction() {
+    log_pending = false;
+    uint8_t port_number = static_cast<uint8_t>(config.irq - IRQ_LPI2C1);
+    transaction_log->record(log_flags | port_number, log_address,
+                            buff.get_bytes_transferred(), buff.data(), _error);
 }
 
 inline uint8_t IMX_RT1060_I2CMaster::tx_fifo_count() {
@@ -425,6 +474,14 @@ bool IMX_RT1060_I2CMaster::start(uint8_t address, uint32_t direction) {
     ignore_tdf = direction;
     _error = I2CError::ok;
     state = State::starting;
+    callback_pending = (bool)after_transfer_callback;
+    if (transaction_log) {
+        // Zero length transfers don't initialise the buffer
+        buff.reset();
+        log_pending = true;
+        log_flags = direction == MASTER_READ ? I2C_LOG_FLAG_READ : 0;
+        log_address = address;
+    }
 
     // Make sure the FIFOs are empty before we start.
     if (tx_fifo_count() > 0 || rx_fifo_count() > 0) {
@@ -437,14 +494,25 @@ bool IMX_RT1060_I2CMaster::start(uint8_t address, uint32_t direction) {
         #endif
         _error = I2CError::master_fifos_not_empty;
         abort_transaction_async();
+        state = State::idle;
         return false;
     }
 
     // Clear status flags
     clear_all_msr_flags();
 
+    // Switch to the device's speed unless we're about to send a repeated START
+    if (!(port->MSR & LPI2C_MSR_MBF)) {
+        uint8_t device_speed = device_speeds[address & 0x7F];
+        use_speed(device_speed ? device_speed - 1 : bus_speed);
+    }
+
     // Send a START to the slave at 'address'
     port->MCR |= LPI2C_MCR_MEN;
+    timestamp_pending = true;
+    timestamp_address = 0;
+    timestamp_stop = 0;
+    timestamp_start = ARM_DWT_CYCCNT;
     uint8_t i2c_address = (address & 0x7F) << 1;
     port->MTDR = LPI2C_MTDR_CMD_START | i2c_address | direction;
 
@@ -477,26 +545,72 @@ void IMX_RT1060_I2CMaster::abort_transaction_async() {
     }
 }
 
+// The master timing registers for one speed
+struct I2CMasterClockRegisters {
+    uint32_t MCCR0;
+    uint32_t MCFGR1;
+    uint32_t MCFGR2;
+    uint32_t MCFGR3;
+};
+
+static constexpr I2CMasterClockRegisters clock_registers(const I2CMasterConfiguration& timings) {
+    return {
+        LPI2C_MCCR0_CLKHI(timings.CLKHI) | LPI2C_MCCR0_CLKLO(timings.CLKLO) |
+            LPI2C_MCCR0_DATAVD(timings.DATAVD) | LPI2C_MCCR0_SETHOLD(timings.SETHOLD),
+        LPI2C_MCFGR1_PRESCALE(timings.PRESCALE),
+        LPI2C_MCFGR2_FILTSDA(timings.FILTSDA) | LPI2C_MCFGR2_FILTSCL(timings.FILTSCL) |
+            LPI2C_MCFGR2_BUSIDLE(timings.BUSIDLE),
+        LPI2C_MCFGR3_PINLOW(timings.PINLOW)
+    };
+}
+
+// Worked out in advance so switching speed is just 4 register writes
+static const I2CMasterClockRegisters master_clock_registers[] = {
+    clock_registers(DefaultStandardModeMasterConfiguration),
+    clock_registers(DefaultFastModeMasterConfiguration),
+    clock_registers(DefaultFastModePlusMasterConfiguration)
+};
+
 // Supports 100 kHz, 400 kHz and 1 MHz modes.
-void IMX_RT1060_I2CMaster::set_clock(uint32_t frequency) {
-    I2CMasterConfiguration timings;
+// Returns an index into master_clock_registers.
+static uint8_t speed_for(uint32_t frequency) {
     if (frequency < 400'000) {
         // Use Standard Mode - up to 100 kHz
-        timings = DefaultStandardModeMasterConfiguration;
+        return 0;
     } else if (frequency < 1'000'000) {
         // Use Fast Mode - up to 400 kHz
-        timings = DefaultFastModeMasterConfiguration;
+        return 1;
     } else {
         // Use Fast Mode Plus - up to 1 MHz
-        timings = DefaultFastModePlusMasterConfiguration;
+        return 2;
     }
-    port->MCCR0 = LPI2C_MCCR0_CLKHI(timings.CLKHI) | LPI2C_MCCR0_CLKLO(timings.CLKLO) |
-                  LPI2C_MCCR0_DATAVD(timings.DATAVD) | LPI2C_MCCR0_SETHOLD(timings.SETHOLD);
-    port->MCFGR1 = LPI2C_MCFGR1_PRESCALE(timings.PRESCALE);
-    port->MCFGR2 = LPI2C_MCFGR2_FILTSDA(timings.FILTSDA) | LPI2C_MCFGR2_FILTSCL(timings.FILTSCL) |
-                   LPI2C_MCFGR2_BUSIDLE(timings.BUSIDLE);
-    port->MCFGR3 = LPI2C_MCFGR3_PINLOW(timings.PINLOW);
-    port->MCCR1 = port->MCCR0;
+}
+
+void IMX_RT1060_I2CMaster::set_clock(uint32_t frequency) {
+    bus_speed = speed_for(frequency);
+    // Make sure use_speed() writes the registers
+    active_speed = UINT8_MAX;
+    use_speed(bus_speed);
+}
+
+void IMX_RT1060_I2CMaster::set_device_frequency(uint8_t address, uint32_t frequency) {
+    device_speeds[address & 0x7F] = frequency ? speed_for(frequency) + 1 : 0;
+}
+
+// Call this while the master doesn't own the bus.
+// The timing registers can only be changed while the master is disabled.
+void IMX_RT1060_I2CMaster::use_speed(uint8_t speed) {
+    if (speed == active_speed) {
+        return;
+    }
+    const I2CMasterClockRegisters& registers = master_clock_registers[speed];
+    port->MCR &= ~LPI2C_MCR_MEN;
+    port->MCCR0 = registers.MCCR0;
+    port->MCFGR1 = registers.MCFGR1;
+    port->MCFGR2 = registers.MCFGR2;
+    port->MCFGR3 = registers.MCFGR3;
+    port->MCCR1 = registers.MCCR0;
+    active_speed = speed;
 }
 
 void IMX_RT1060_I2CSlave::listen(uint8_t address) {
@@ -555,7 +669,11 @@ void IMX_RT1060_I2CSlave::listen(uint32_t samr, uint32_t address_config) {
 
     // Set up interrupts
     attachInterruptVector(config.irq, isr);
-    port->SIER = (LPI2C_SIER_RSIE | LPI2C_SIER_SDIE | LPI2C_SIER_TDIE | LPI2C_SIER_RDIE);
+    uint32_t sier = (LPI2C_SIER_RSIE | LPI2C_SIER_SDIE | LPI2C_SIER_TDIE | LPI2C_SIER_RDIE);
+    if (address_interrupt) {
+        sier |= LPI2C_SIER_AVIE;
+    }
+    port->SIER = sier;
     NVIC_ENABLE_IRQ(config.irq);
 
     // Enable Slave Mode
@@ -571,6 +689,14 @@ inline void IMX_RT1060_I2CSlave::after_receive(std::function<void(size_t len, ui
     after_receive_callback = callback;
 }
 
+inline void IMX_RT1060_I2CSlave::before_receive(std::function<void(uint16_t address)> callback) {
+    before_receive_callback = callback;
+}
+
+inline void IMX_RT1060_I2CSlave::after_receive_buffer_full(std::function<void(uint16_t address)> callback) {
+    receive_buffer_full_callback = callback;
+}
+
 inline void IMX_RT1060_I2CSlave::before_transmit(std::function<void(uint16_t address)> callback) {
     before_transmit_callback = callback;
 }
@@ -587,6 +713,10 @@ inline void IMX_RT1060_I2CSlave::set_receive_buffer(uint8_t* buffer, size_t size
     rx_buffer.initialise(buffer, size);
 }
 
+inline void IMX_RT1060_I2CSlave::set_masked_receive_buffer(uint8_t* buffer, size_t size, const I2CRegisterAccess* rules) {
+    rx_buffer.initialise(buffer, size, rules);
+}
+
 // WARNING: Do not call directly.
 void IMX_RT1060_I2CSlave::_interrupt_service_routine() {
     // Read the slave status register
@@ -596,6 +726,8 @@ void IMX_RT1060_I2CSlave::_interrupt_service_routine() {
     if (ssr & LPI2C_SSR_AVF) {
         // Find out which address was used and clear to the address flag.
         address_called = (port->SASR & LPI2C_SASR_RADDR(0x7FF)) >> 1;
+        timestamp_start = timestamp_address = ARM_DWT_CYCCNT;
+        timestamp_stop = 0;
     }
 
     if (ssr & (LPI2C_SSR_RSF | LPI2C_SSR_SDF)) {
@@ -610,23 +742,31 @@ void IMX_RT1060_I2CSlave::_interrupt_service_routine() {
         if (srdr & LPI2C_SRDR_SOF) {
             // Start of Frame (The first byte since a (repeated) START or STOP condition)
             _error = I2CError::ok;
-            if (rx_buffer.initialised()) {
-                rx_buffer.reset();
-                state = State::receiving;
+            if (before_receive_callback) {
+                before_receive_callback(address_called);
             }
+            // Enter the receiving state even without a buffer so
+            // after_receive() reports the end of the write.
+            rx_buffer.reset();
+            state = State::receiving;
         }
         uint8_t data = srdr & LPI2C_SRDR_DATA(0xFF);
         if (rx_buffer.initialised()) {
             if (!rx_buffer.write(data)) {
                 // The buffer is already full.
-                // Don't NACK. Just swallow the byte. See "Slave Receiver NACKs" above.
-                _error = I2CError::buffer_overflow;
+                // Give the application a chance to supply another one.
+                if (receive_buffer_full_callback) {
+                    receive_buffer_full_callback(address_called);
+                }
+                if (!rx_buffer.write(data)) {
+                    // Don't NACK. Just swallow the byte. See "Slave Receiver NACKs" above.
+                    _error = I2CError::buffer_overflow;
+                }
             }
         } else {
             // We are not interested in reading anything.
             // Don't NACK. Just swallow the byte. See "Slave Receiver NACKs" above.
             _error = I2CError::buffer_overflow;
-            state = State::idle;
         }
     }
 
@@ -685,6 +825,10 @@ void IMX_RT1060_I2CSlave::_interrupt_service_routine() {
 
 // Called from within the ISR when we receive a Repeated START or STOP
 void IMX_RT1060_I2CSlave::end_of_frame() {
+    timestamp_stop = ARM_DWT_CYCCNT;
+    if (transaction_log && state != State::idle) {
+        log_transaction();
+    }
     if (state == State::receiving) {
         if (after_receive_callback) {
             after_receive_callback(rx_buffer.get_bytes_transferred(), address_called);
@@ -707,6 +851,21 @@ void IMX_RT1060_I2CSlave::end_of_frame() {
     state = State::idle;
 }
 
+void IMX_RT1060_I2CSlave::log_transaction() {
+    uint8_t flags = I2C_LOG_FLAG_SLAVE | static_cast<uint8_t>(config.irq - IRQ_LPI2C1);
+    if (state == State::transmitting) {
+        // We're always asked for one more byte than the master reads.
+        // If we had enough data, the extra byte came from the buffer.
+        size_t length = tx_buffer.get_bytes_transferred();
+        if (!trailing_byte_sent && length > 0) {
+            length--;
+        }
+        transaction_log->record(flags | I2C_LOG_FLAG_READ, address_called, length, tx_buffer.data(), _error);
+    } else {
+        transaction_log->record(flags, address_called, rx_buffer.get_bytes_transferred(), rx_buffer.data(), _error);
+    }
+}
+
 IMX_RT1060_I2CBase::Config i2c1_config = {
         CCM_CCGR2,
         CCM_CCGR2_LPI2C1(CCM_CCGR_ON),
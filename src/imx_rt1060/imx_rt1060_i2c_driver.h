@@ -9,6 +9,8 @@
 #include "imx_rt1060.h"
 #include "../i2c_driver.h"
 
+class I2CTransactionLog;
+
 // A read or write buffer.
 // You cannot use the same buffer for both reading and writing.
 // This class is an implementation detail of the driver and
@@ -20,10 +22,13 @@ public:
     // May be called inside or outside the ISR.
     // This should be safe because it can never be called while
     // the ISR is trying to read from the buffer or write to it.
-    inline void initialise(uint8_t* new_buffer, size_t new_size) {
+    // If 'new_rules' is set then write() merges each byte into the
+    // buffer according to the matching rule.
+    inline void initialise(uint8_t* new_buffer, size_t new_size, const I2CRegisterAccess* new_rules = nullptr) {
         reset();
         buffer = new_buffer;
         size = new_size;
+        rules = new_rules;
     }
 
     inline bool initialised() {
@@ -39,6 +44,10 @@ public:
     inline bool write(uint8_t data) {
         if (next_index == size) {
             return false;
+        } else if (rules) {
+            buffer[next_index] = rules[next_index].apply(buffer[next_index], data);
+            next_index++;
+            return true;
         } else {
             buffer[next_index++] = data;
             return true;
@@ -49,6 +58,11 @@ public:
         return next_index;
     }
 
+    // The start of the buffer. Used to log the data transferred.
+    inline const uint8_t* data() {
+        return const_cast<const uint8_t*>(buffer);
+    }
+
     // Caller is responsible for preventing a read beyond the end of the buffer.
     inline uint8_t read() {
         return buffer[next_index++];
@@ -76,6 +90,7 @@ public:
 
 private:
     volatile uint8_t* buffer;
+    const I2CRegisterAccess* volatile rules = nullptr;
     volatile size_t size = 0;
     volatile size_t next_index = 0;
 };
@@ -116,6 +131,15 @@ public:
 
     void end() override;
 
+    // Makes the master use a different speed when it talks to 'address'.
+    // e.g. Runs a 1 MHz sensor at full speed on a bus that has to run at
+    // 100 kHz for older devices. 'frequency' is rounded down to a supported
+    // mode like begin(). Set 'frequency' to 0 to use the bus frequency again.
+    // The master switches speed before the START. A repeated START to
+    // another device keeps the current speed.
+    // Call this between transactions.
+    void set_device_frequency(uint8_t address, uint32_t frequency);
+
     bool finished() override;
 
     size_t get_bytes_transferred() override;
@@ -124,6 +148,15 @@ public:
 
     void read_async(uint8_t address, uint8_t* buffer, size_t num_bytes, bool send_stop) override;
 
+    // Call this between transactions.
+    void after_transfer(std::function<void()> callback) override;
+
+    // Records every transaction in 'log'. Use nullptr to stop recording.
+    // Call this between transactions.
+    inline void set_transaction_log(I2CTransactionLog* log) {
+        transaction_log = log;
+    }
+
     // DO NOT call this method directly.
     void _interrupt_service_routine();
 
@@ -147,9 +180,22 @@ private:
     volatile State state = State::idle;
     volatile uint32_t ignore_tdf = false;       // True for a receive transfer
     volatile bool stop_on_completion = false;   // True if the transmit transfer requires a stop.
+    I2CTransactionLog* transaction_log = nullptr;
+    volatile bool log_pending = false;          // True until the current transaction has been logged.
+    uint8_t log_flags = 0;
+    uint8_t log_address = 0;
+    std::function<void()> after_transfer_callback;
+    volatile bool callback_pending = false;     // True until after_transfer_callback has been called for this transfer
+    volatile bool timestamp_pending = false;    // True until the end of this transfer has been timestamped
+    uint8_t bus_speed = 0;                      // The speed set by begin()
+    uint8_t active_speed = 0;                   // The speed in the timing registers
+    uint8_t device_speeds[128] = {};            // 0 to use bus_speed otherwise the device's speed + 1
 
     void (* isr)();
     void set_clock(uint32_t frequency);
+    void use_speed(uint8_t speed);
+    void log_transaction();
+    void transfer_failed();
     void abort_transaction_async();
     bool start(uint8_t address, uint32_t direction);
     uint8_t tx_fifo_count();
@@ -177,6 +223,10 @@ public:
 
     void after_receive(std::function<void(size_t length, uint16_t address)> callback) override;
 
+    void before_receive(std::function<void(uint16_t address)> callback) override;
+
+    void after_receive_buffer_full(std::function<void(uint16_t address)> callback) override;
+
     void before_transmit(std::function<void(uint16_t address)> callback) override;
 
     void after_transmit(std::function<void(uint16_t address)> callback) override;
@@ -185,6 +235,22 @@ public:
 
     void set_receive_buffer(uint8_t* buffer, size_t size) override;
 
+    void set_masked_receive_buffer(uint8_t* buffer, size_t size, const I2CRegisterAccess* rules) override;
+
+    // Records every transaction in 'log'. Use nullptr to stop recording.
+    // Call this before listen().
+    inline void set_transaction_log(I2CTransactionLog* log) {
+        transaction_log = log;
+    }
+
+    // Enables the address valid interrupt so get_timestamps() reports
+    // when the address was matched rather than when the first byte of a
+    // write arrived. Costs an extra interrupt per transaction.
+    // Call this before listen().
+    inline void set_timestamp_address(bool enable) {
+        address_interrupt = enable;
+    }
+
     void _interrupt_service_routine();
 
 private:
@@ -207,9 +273,13 @@ private:
     I2CBuffer rx_buffer;
     I2CBuffer tx_buffer;
     bool trailing_byte_sent = false;
+    I2CTransactionLog* transaction_log = nullptr;
+    bool address_interrupt = false;     // Set by set_timestamp_address()
 
     void (* isr)();
     std::function<void(size_t length, uint16_t address)> after_receive_callback = nullptr;
+    std::function<void(uint16_t address)> before_receive_callback = nullptr;
+    std::function<void(uint16_t address)> receive_buffer_full_callback = nullptr;
     std::function<void(uint16_t address)> before_transmit_callback = nullptr;
     std::function<void(uint16_t address)> after_transmit_callback = nullptr;
 
@@ -217,6 +287,7 @@ private:
 
     // Called from within the ISR when we receive a Repeated START or STOP
     void end_of_frame();
+    void log_transaction();
 };
 
 extern IMX_RT1060_I2CSlave Slave;   // Pins 19 and 18; SCL0 and SDA0
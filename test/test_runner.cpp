@@ -9,6 +9,8 @@
 //#include "example/example.h"
 #include "unit/test_i2c_device.h"
 #include "unit/test_i2c_register_slave.h"
+#include "unit/test_i2c_multi_device_slave.h"
+#include "unit/test_i2c_transaction_log.h"
 
 // End-to-End Loopback Tests
 #ifdef LOOPBACK_TEST_HARNESS
@@ -46,6 +48,8 @@ void run_all_tests() {
 //    test(new ExampleTestSuite());
     test(new I2CDeviceTest());
     test(new I2CRegisterSlaveTest());
+    test(new I2CMultiDeviceSlaveTest());
+    test(new I2CTransactionLogTest());
 
     // Full Stack Tests
     // These tests require working hardware
@@ -164,6 +164,19 @@ public:
         }
     }
 
+    // Prints the trace in the format read by tools/bus_trace_export/bus_trace_export.py
+    // which converts it to a VCD file or sigrok session for PulseView.
+    static void print_trace_dump(const bus_trace::BusTrace& trace, const char* name) {
+        Serial.printf("TRACE,%s\n", name);
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            const bus_trace::BusEvent* event = trace.event(i);
+            Serial.printf("EDGE,%d,%d,%d\n",
+                          common::hal::TeensyTimestamp::ticks_to_nanos(event->delta_t_in_ticks),
+                          (event->flags & bus_trace::BusEventFlags::SDA_LINE_STATE) ? 1 : 0,
+                          (event->flags & bus_trace::BusEventFlags::SCL_LINE_STATE) ? 1 : 0);
+        }
+    }
+
     static void print_traces(bus_trace::BusTrace& actual, bus_trace::BusTrace& expected) {
         Serial.println("Actual:");
         Serial.print(actual.to_message());
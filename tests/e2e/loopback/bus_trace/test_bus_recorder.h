@@ -55,6 +55,7 @@ public:
                 .data_byte(BYTE_A).nack()
                 .stop_bit();
 //        print_traces(trace, expected_trace);
+//        print_trace_dump(trace, "i2c_timings");    // See tools/bus_trace_export
 //        for (size_t i = 0; i < trace.event_count(); ++i) {
 //            Serial.printf("Index %d: delta %d ns\n", i, common::hal::TeensyTimestamp::ticks_to_nanos(trace.event(i)->delta_t_in_ticks));
 //        }
@@ -0,0 +1,172 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_HOST_TEST_I2C_BUS_ARBITER_TEST
+#ifdef TEENSY_I2C_HOST_TEST_I2C_BUS_ARBITER_TEST
+
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_bus_arbiter.h"
+#include "lpi2c_simulator.h"
+#include "utils/test_suite.h"
+
+// Runs I2CBusArbiter on the real driver and the simulator.
+// Master (LPI2C1) is connected to Slave1 (LPI2C3).
+class I2CBusArbiterTest : public TestSuite {
+public:
+    static const uint8_t slave_address = 0x2D;
+    static const uint64_t timeout_ns = 100'000'000;
+    static uint8_t slave_rx[16];
+    static size_t slave_rx_length;
+    static uint8_t completed[8];
+    static size_t num_completed;
+
+    void setUp() override {
+        lpi2c_simulator.reset();
+        lpi2c_simulator.timing = LPI2CSimulator::Timing();
+        lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+        memset(slave_rx, 0, sizeof(slave_rx));
+        slave_rx_length = 0;
+        num_completed = 0;
+        Slave1.after_receive([](size_t length, uint16_t address) { slave_rx_length = length; });
+        Slave1.set_receive_buffer(slave_rx, sizeof(slave_rx));
+        Slave1.listen(slave_address);
+        Master.begin(400'000);
+    }
+
+    void tearDown() override {
+        Master.end();
+        Slave1.stop_listening();
+        Slave1.after_receive(nullptr);
+    }
+
+    static bool wait_until_idle(const I2CBusArbiter& arbiter) {
+        return lpi2c_simulator.run_until([&arbiter]() { return arbiter.idle(); }, timeout_ns);
+    }
+
+    // Records the order that requests finish in. The id is the first byte written.
+    static void record_completion(I2CRequest& request) {
+        completed[num_completed++] = request.write_buffer[0];
+    }
+
+    static void test_runs_highest_priority_request_next() {
+        I2CBusArbiter arbiter(Master);
+        I2CRequest* low_queue[4];
+        I2CRequest* high_queue[4];
+        I2CBusClient low(arbiter, low_queue, 4, 5);
+        I2CBusClient high(arbiter, high_queue, 4, 1);
+        const uint8_t ids[] = {1, 2, 3, 4};
+        I2CRequest requests[4];
+        for (size_t i = 0; i < 4; i++) {
+            requests[i].address = slave_address;
+            requests[i].write_buffer = &ids[i];
+            requests[i].write_length = 1;
+            requests[i].on_complete = record_completion;
+        }
+
+        // The first request starts straight away. The rest wait for it.
+        TEST_ASSERT_TRUE(low.submit(requests[0]));
+        TEST_ASSERT_TRUE(low.submit(requests[1]));
+        TEST_ASSERT_TRUE(high.submit(requests[2]));
+        TEST_ASSERT_TRUE(high.submit(requests[3]));
+        TEST_ASSERT_FALSE(arbiter.idle());
+
+        // Only the ISR starts the queued requests
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        const uint8_t expected[] = {1, 3, 4, 2};
+        TEST_ASSERT_EQUAL(sizeof(expected), num_completed);
+        TEST_ASSERT_EQUAL_MEMORY(expected, completed, sizeof(expected));
+        for (const I2CRequest& request : requests) {
+            TEST_ASSERT_TRUE(request.finished());
+            TEST_ASSERT_EQUAL(I2CError::ok, request.error);
+        }
+    }
+
+    static void test_reads_register_with_repeated_start() {
+        const uint8_t reg[] = {0x07};
+        const uint8_t data[] = {0xA1, 0xB2, 0xC3};
+        uint8_t rx[sizeof(data)] = {};
+        Slave1.set_transmit_buffer(data, sizeof(data));
+        I2CBusArbiter arbiter(Master);
+        I2CRequest* queue[2];
+        I2CBusClient client(arbiter, queue, 2, 0);
+        I2CRequest request;
+        request.address = slave_address;
+        request.write_buffer = reg;
+        request.write_length = sizeof(reg);
+        request.read_buffer = rx;
+        request.read_length = sizeof(rx);
+
+        TEST_ASSERT_TRUE(client.submit(request));
+
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_TRUE(request.finished());
+        TEST_ASSERT_EQUAL(I2CError::ok, request.error);
+        TEST_ASSERT_EQUAL(sizeof(data), request.bytes_read);
+        TEST_ASSERT_EQUAL_MEMORY(data, rx, sizeof(data));
+        TEST_ASSERT_EQUAL(sizeof(reg), slave_rx_length);
+        TEST_ASSERT_EQUAL(reg[0], slave_rx[0]);
+    }
+
+    static void test_failed_request_does_not_stop_the_queue() {
+        I2CBusArbiter arbiter(Master);
+        I2CRequest* queue[4];
+        I2CBusClient client(arbiter, queue, 4, 0);
+        uint8_t too_big[300];
+        I2CRequest missing_slave, invalid, probe;
+        missing_slave.address = slave_address + 1;
+        invalid.address = slave_address;
+        invalid.read_buffer = too_big;
+        invalid.read_length = sizeof(too_big);
+        probe.address = slave_address;
+
+        TEST_ASSERT_TRUE(client.submit(missing_slave));
+        TEST_ASSERT_TRUE(client.submit(invalid));
+        TEST_ASSERT_TRUE(client.submit(probe));
+
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_EQUAL(I2CError::address_nak, missing_slave.error);
+        TEST_ASSERT_EQUAL(I2CError::invalid_request, invalid.error);
+        TEST_ASSERT_TRUE(probe.finished());
+        TEST_ASSERT_EQUAL(I2CError::ok, probe.error);
+    }
+
+    static void test_rejects_request_when_queue_is_full() {
+        I2CBusArbiter arbiter(Master);
+        I2CRequest* queue[2];
+        I2CBusClient client(arbiter, queue, 2, 0);
+        I2CRequest first, second, third;
+        first.address = second.address = third.address = slave_address;
+
+        TEST_ASSERT_TRUE(client.submit(first));     // Starts straight away
+        TEST_ASSERT_FALSE(client.submit(first));    // Still running
+        TEST_ASSERT_TRUE(client.submit(second));
+        TEST_ASSERT_FALSE(client.submit(third));    // Queue is full
+        TEST_ASSERT_EQUAL(1, client.pending());
+
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_TRUE(client.submit(third));
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_TRUE(third.finished());
+    }
+
+    // Include all the tests here
+    void test() override {
+        RUN_TEST(test_runs_highest_priority_request_next);
+        RUN_TEST(test_reads_register_with_repeated_start);
+        RUN_TEST(test_failed_request_does_not_stop_the_queue);
+        RUN_TEST(test_rejects_request_when_queue_is_full);
+    }
+
+    I2CBusArbiterTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t I2CBusArbiterTest::slave_rx[16];
+size_t I2CBusArbiterTest::slave_rx_length;
+uint8_t I2CBusArbiterTest::completed[8];
+size_t I2CBusArbiterTest::num_completed;
+
+#endif //TEENSY_I2C_HOST_TEST_I2C_BUS_ARBITER_TEST
@@ -0,0 +1,212 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_HOST_TEST_I2C_FIFO_DRAIN_TEST
+#ifdef TEENSY_I2C_HOST_TEST_I2C_FIFO_DRAIN_TEST
+
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_fifo_drain.h"
+#include "lpi2c_simulator.h"
+#include "utils/test_suite.h"
+
+// Runs I2CFifoDrain on the real driver and the simulator.
+// Master (LPI2C1) reads from Slave1 (LPI2C3) which pretends to be a
+// device with a FIFO. Byte 'i' of the device's data stream is i & 0xFF.
+class I2CFifoDrainTest : public TestSuite {
+public:
+    static const uint8_t slave_address = 0x2D;
+    static const uint8_t count_register = 0x72;
+    static const uint8_t data_register = 0x74;
+    static const uint64_t timeout_ns = 100'000'000;
+    static uint8_t stream[512];
+    static size_t produced;             // Bytes the device has put in its FIFO
+    static uint16_t count_status;       // Status bits that share the count register
+    static I2CFifoDevice device;
+    static I2CFifoDrain* drain;
+    static uint8_t slave_rx[2];
+    static uint8_t selected_register;
+    static uint8_t count_tx[2];
+
+    void setUp() override {
+        lpi2c_simulator.reset();
+        lpi2c_simulator.timing = LPI2CSimulator::Timing();
+        lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+        for (size_t i = 0; i < sizeof(stream); i++) {
+            stream[i] = i & 0xFF;
+        }
+        produced = 0;
+        count_status = 0;
+        device = I2CFifoDevice();
+        device.address = slave_address;
+        device.count_register = count_register;
+        device.data_register = data_register;
+        drain = nullptr;
+        Slave1.after_receive([](size_t length, uint16_t address) { selected_register = slave_rx[0]; });
+        Slave1.before_transmit([](uint16_t address) { prepare_transmit(); });
+        Slave1.set_receive_buffer(slave_rx, sizeof(slave_rx));
+        Slave1.listen(slave_address);
+        Master.begin(1'000'000);
+    }
+
+    void tearDown() override {
+        Master.end();
+        Slave1.stop_listening();
+        Slave1.after_receive(nullptr);
+        Slave1.before_transmit(nullptr);
+    }
+
+    // The device forgets the bytes that the drain has read
+    static void prepare_transmit() {
+        size_t consumed = drain->bytes_read();
+        if (selected_register == count_register) {
+            uint16_t count = produced - consumed;
+            if (device.count_in_samples) {
+                count /= device.sample_size;
+            }
+            count |= count_status;
+            uint8_t high = count >> 8;
+            uint8_t low = count & 0xFF;
+            count_tx[0] = device.count_big_endian ? high : low;
+            count_tx[1] = device.count_big_endian ? low : high;
+            Slave1.set_transmit_buffer(count_tx, device.count_length);
+        } else {
+            Slave1.set_transmit_buffer(stream + consumed, produced - consumed);
+        }
+    }
+
+    static bool wait_until_idle(const I2CBusArbiter& arbiter) {
+        return lpi2c_simulator.run_until([&arbiter]() { return arbiter.idle(); }, timeout_ns);
+    }
+
+    static void assert_stream(const uint8_t* data, size_t first, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            TEST_ASSERT_EQUAL((first + i) & 0xFF, data[i]);
+        }
+    }
+
+    static void test_drains_fifo_into_ring_buffer() {
+        I2CBusArbiter arbiter(Master);
+        device.sample_size = 6;
+        uint8_t ring[48];
+        I2CFifoDrain fifo(arbiter, device, ring, sizeof(ring));
+        drain = &fifo;
+        produced = 60;
+
+        // The ISR reads the count then the data with no help from the test
+        fifo.start();
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_EQUAL(48, fifo.bytes_read());
+        TEST_ASSERT_EQUAL(48, fifo.available());
+        TEST_ASSERT_EQUAL(1, fifo.overflows());     // 2 samples didn't fit
+        TEST_ASSERT_EQUAL(0, fifo.errors());
+
+        uint8_t data[48];
+        TEST_ASSERT_EQUAL(24, fifo.read(data, 24));
+        assert_stream(data, 0, 24);
+
+        // The rest wraps round to the start of the ring buffer
+        TEST_ASSERT_TRUE(fifo.poll());
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_EQUAL(60, fifo.bytes_read());
+        TEST_ASSERT_EQUAL(36, fifo.available());
+        size_t length;
+        const uint8_t* block = fifo.peek(length);
+        TEST_ASSERT_EQUAL(24, length);
+        assert_stream(block, 24, length);
+        fifo.consume(length);
+        block = fifo.peek(length);
+        TEST_ASSERT_EQUAL(12, length);
+        assert_stream(block, 48, length);
+        fifo.consume(length);
+        TEST_ASSERT_EQUAL(0, fifo.available());
+    }
+
+    static void test_reads_large_fifo_in_several_transfers() {
+        I2CBusArbiter arbiter(Master);
+        device.sample_size = 2;
+        device.count_in_samples = true;
+        device.count_big_endian = false;
+        device.count_mask = 0x07FF;
+        count_status = 0x8000;
+        uint8_t ring[512];
+        I2CFifoDrain fifo(arbiter, device, ring, sizeof(ring));
+        drain = &fifo;
+        produced = 300;
+
+        // The master can only read 256 bytes at a time
+        uint64_t start_ns = lpi2c_simulator.now_ns();
+        fifo.start();
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        uint64_t elapsed_ns = lpi2c_simulator.now_ns() - start_ns;
+
+        TEST_ASSERT_EQUAL(0, fifo.errors());
+        TEST_ASSERT_EQUAL(300, fifo.available());
+        uint8_t data[300];
+        TEST_ASSERT_EQUAL(300, fifo.read(data, sizeof(data)));
+        assert_stream(data, 0, sizeof(data));
+        // 2 count reads and 2 data reads of 4 bytes overhead each plus the
+        // data. About 1 us per bit. The ISR starts each read straight away.
+        uint64_t bus_ns = (4 * 4 + 2 * 2 + 300) * 9 * 1'000;
+        TEST_ASSERT_TRUE(elapsed_ns < bus_ns * 110 / 100);
+    }
+
+    static void test_stops_when_device_does_not_reply() {
+        I2CBusArbiter arbiter(Master);
+        device.address = slave_address + 1;
+        uint8_t ring[16];
+        I2CFifoDrain fifo(arbiter, device, ring, sizeof(ring));
+        drain = &fifo;
+        produced = 8;
+
+        TEST_ASSERT_FALSE(fifo.poll());     // Not started
+        fifo.start();
+        TEST_ASSERT_TRUE(wait_until_idle(arbiter));
+        TEST_ASSERT_EQUAL(1, fifo.errors());
+        TEST_ASSERT_EQUAL(0, fifo.available());
+
+        fifo.stop();
+        TEST_ASSERT_FALSE(fifo.poll());
+        TEST_ASSERT_TRUE(arbiter.idle());
+    }
+
+    static void test_rejects_invalid_sample_size() {
+        I2CBusArbiter arbiter(Master);
+        uint8_t ring[16];
+        const uint16_t sample_sizes[] = {0, I2CMaster::max_read_length + 1};
+        for (uint16_t sample_size : sample_sizes) {
+            device.sample_size = sample_size;
+            I2CFifoDrain fifo(arbiter, device, ring, sizeof(ring));
+            drain = &fifo;
+            produced = 8;
+
+            TEST_ASSERT_FALSE(fifo.start());
+            TEST_ASSERT_FALSE(fifo.poll());
+            TEST_ASSERT_TRUE(arbiter.idle());
+        }
+    }
+
+    // Include all the tests here
+    void test() override {
+        RUN_TEST(test_drains_fifo_into_ring_buffer);
+        RUN_TEST(test_reads_large_fifo_in_several_transfers);
+        RUN_TEST(test_stops_when_device_does_not_reply);
+        RUN_TEST(test_rejects_invalid_sample_size);
+    }
+
+    I2CFifoDrainTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t I2CFifoDrainTest::stream[512];
+size_t I2CFifoDrainTest::produced;
+uint16_t I2CFifoDrainTest::count_status;
+I2CFifoDevice I2CFifoDrainTest::device;
+I2CFifoDrain* I2CFifoDrainTest::drain;
+uint8_t I2CFifoDrainTest::slave_rx[2];
+uint8_t I2CFifoDrainTest::selected_register;
+uint8_t I2CFifoDrainTest::count_tx[2];
+
+#endif //TEENSY_I2C_HOST_TEST_I2C_FIFO_DRAIN_TEST
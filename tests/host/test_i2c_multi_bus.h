@@ -0,0 +1,196 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_HOST_TEST_I2C_MULTI_BUS_TEST
+#ifdef TEENSY_I2C_HOST_TEST_I2C_MULTI_BUS_TEST
+
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_multi_bus.h"
+#include "lpi2c_simulator.h"
+#include "utils/test_suite.h"
+
+// LPI2C2 isn't connected to any pins on the Teensy but the simulator
+// has it. It lets the tests run 2 buses with a slave on each.
+// Bus 0: Master (LPI2C1) and Slave1 (LPI2C3)
+// Bus 1: Master2 (LPI2C4) and SlaveOnLPI2C2 (LPI2C2)
+IMX_RT1060_I2CBase::Config test_lpi2c2_config = {
+        CCM_CCGR2,
+        0,
+        IMX_RT1060_I2CBase::PinInfo{18U, 3U | 0x10U, &IOMUXC_LPI2C1_SDA_SELECT_INPUT, 1U},
+        IMX_RT1060_I2CBase::PinInfo{19U, 3U | 0x10U, &IOMUXC_LPI2C1_SCL_SELECT_INPUT, 1U},
+        false,
+        {},
+        {},
+        IRQ_LPI2C2
+};
+
+static void test_lpi2c2_slave_isr();
+
+IMX_RT1060_I2CSlave SlaveOnLPI2C2(&LPI2C2, test_lpi2c2_config, test_lpi2c2_slave_isr);
+
+static void test_lpi2c2_slave_isr() {
+    SlaveOnLPI2C2._interrupt_service_routine();
+}
+
+class I2CMultiBusTest : public TestSuite {
+public:
+    static const uint8_t slave_address = 0x2D;
+    static const uint64_t timeout_ns = 100'000'000;
+    static const size_t batch_size = 12;
+    static uint8_t slave_rx[2][4];
+    static size_t batches_completed;
+
+    void setUp() override {
+        lpi2c_simulator.reset();
+        lpi2c_simulator.timing = LPI2CSimulator::Timing();
+        lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+        lpi2c_simulator.connect(simulated_lpi2c4, simulated_lpi2c2);
+        batches_completed = 0;
+        Slave1.set_receive_buffer(slave_rx[0], sizeof(slave_rx[0]));
+        Slave1.listen(slave_address);
+        SlaveOnLPI2C2.set_receive_buffer(slave_rx[1], sizeof(slave_rx[1]));
+        SlaveOnLPI2C2.listen(slave_address);
+        Master.begin(400'000);
+        Master2.begin(400'000);
+    }
+
+    void tearDown() override {
+        Master.end();
+        Master2.end();
+        Slave1.stop_listening();
+        SlaveOnLPI2C2.stop_listening();
+    }
+
+    static void count_batch() {
+        batches_completed++;
+    }
+
+    // Returns how long the batch took in nanoseconds
+    static uint64_t run_batch(I2CMultiBusExecutor& executor) {
+        uint64_t start_ns = lpi2c_simulator.now_ns();
+        executor.run(count_batch);
+        lpi2c_simulator.run_until([&executor]() { return executor.finished(); }, timeout_ns);
+        return lpi2c_simulator.now_ns() - start_ns;
+    }
+
+    static void test_runs_buses_in_parallel() {
+        I2CBusArbiter arbiter0(Master);
+        I2CBusArbiter arbiter1(Master2);
+        I2CRequest* queue0[batch_size + 1];
+        I2CRequest* queue1[batch_size + 1];
+        I2CBusClient client0(arbiter0, queue0, batch_size + 1, 0);
+        I2CBusClient client1(arbiter1, queue1, batch_size + 1, 0);
+        I2CMultiBusExecutor executor;
+        TEST_ASSERT_EQUAL(0, executor.add_bus(client0, 400'000));
+        TEST_ASSERT_EQUAL(1, executor.add_bus(client1, 400'000));
+        const uint8_t data[] = {0x01, 0x02, 0x03, 0x04};
+        I2CRequest requests[batch_size];
+        for (I2CRequest& request : requests) {
+            request.address = slave_address;
+            request.write_buffer = data;
+            request.write_length = sizeof(data);
+        }
+
+        // Everything on one bus
+        for (I2CRequest& request : requests) {
+            TEST_ASSERT_TRUE(executor.add(0, request));
+        }
+        uint64_t serial_ns = run_batch(executor);
+        TEST_ASSERT_TRUE(executor.finished());
+        TEST_ASSERT_EQUAL(0, executor.failures());
+
+        // Half on each bus
+        TEST_ASSERT_TRUE(executor.clear());
+        for (size_t i = 0; i < batch_size; i++) {
+            TEST_ASSERT_TRUE(executor.add(i % 2, requests[i]));
+        }
+        TEST_ASSERT_EQUAL(executor.estimated_time_us(0), executor.estimated_time_us(1));
+        uint64_t parallel_ns = run_batch(executor);
+
+        TEST_ASSERT_TRUE(executor.finished());
+        TEST_ASSERT_EQUAL(0, executor.failures());
+        TEST_ASSERT_EQUAL(2, batches_completed);
+        TEST_ASSERT_TRUE(parallel_ns < serial_ns * 55 / 100);
+        TEST_ASSERT_EQUAL_MEMORY(data, slave_rx[0], sizeof(data));
+        TEST_ASSERT_EQUAL_MEMORY(data, slave_rx[1], sizeof(data));
+        // Each bus does 6 writes of 47 bits at 400 kHz
+        TEST_ASSERT_EQUAL(47, I2CMultiBusExecutor::bits(requests[0]));
+        TEST_ASSERT_EQUAL(6 * 47 * 1'000'000 / 400'000, executor.estimated_time_us());
+    }
+
+    static void test_counts_failures_and_still_completes() {
+        I2CBusArbiter arbiter0(Master);
+        I2CBusArbiter arbiter1(Master2);
+        I2CRequest* queue0[4];
+        I2CRequest* queue1[2];
+        I2CBusClient client0(arbiter0, queue0, 4, 0);
+        I2CBusClient client1(arbiter1, queue1, 2, 0);
+        I2CMultiBusExecutor executor;
+        executor.add_bus(client0, 400'000);
+        executor.add_bus(client1, 400'000);
+        I2CRequest present, missing, extra;
+        present.address = slave_address;
+        missing.address = slave_address + 1;
+        extra.address = slave_address;
+
+        TEST_ASSERT_TRUE(executor.add(0, present));
+        TEST_ASSERT_TRUE(executor.add(1, missing));
+        TEST_ASSERT_FALSE(executor.add(1, extra));   // Queue is full
+        TEST_ASSERT_FALSE(executor.add(2, extra));   // No such bus
+        run_batch(executor);
+
+        TEST_ASSERT_TRUE(executor.finished());
+        TEST_ASSERT_EQUAL(1, batches_completed);
+        TEST_ASSERT_EQUAL(1, executor.failures());
+        TEST_ASSERT_EQUAL(I2CError::ok, present.error);
+        TEST_ASSERT_EQUAL(I2CError::address_nak, missing.error);
+    }
+
+    static void test_plan_balances_load_by_frequency() {
+        const size_t num_devices = 18;
+        uint32_t load[num_devices];
+        for (size_t i = 0; i < num_devices; i++) {
+            load[i] = 100;
+        }
+        uint8_t assignment[num_devices];
+        size_t per_bus[3] = {};
+
+        const uint32_t equal[] = {400'000, 400'000, 400'000};
+        I2CMultiBusExecutor::plan(load, num_devices, equal, 3, assignment);
+        for (uint8_t bus : assignment) {
+            per_bus[bus]++;
+        }
+        TEST_ASSERT_EQUAL(6, per_bus[0]);
+        TEST_ASSERT_EQUAL(6, per_bus[1]);
+        TEST_ASSERT_EQUAL(6, per_bus[2]);
+
+        // The slow bus gets a quarter as much work as the fast ones
+        const uint32_t mixed[] = {400'000, 100'000, 400'000};
+        memset(per_bus, 0, sizeof(per_bus));
+        I2CMultiBusExecutor::plan(load, num_devices, mixed, 3, assignment);
+        for (uint8_t bus : assignment) {
+            per_bus[bus]++;
+        }
+        TEST_ASSERT_EQUAL(8, per_bus[0]);
+        TEST_ASSERT_EQUAL(2, per_bus[1]);
+        TEST_ASSERT_EQUAL(8, per_bus[2]);
+    }
+
+    // Include all the tests here
+    void test() override {
+        RUN_TEST(test_runs_buses_in_parallel);
+        RUN_TEST(test_counts_failures_and_still_completes);
+        RUN_TEST(test_plan_balances_load_by_frequency);
+    }
+
+    I2CMultiBusTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t I2CMultiBusTest::slave_rx[2][4];
+size_t I2CMultiBusTest::batches_completed;
+
+#endif //TEENSY_I2C_HOST_TEST_I2C_MULTI_BUS_TEST
@@ -0,0 +1,169 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_HOST_TEST_I2C_SCHEDULER_TEST
+#ifdef TEENSY_I2C_HOST_TEST_I2C_SCHEDULER_TEST
+
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_scheduler.h"
+#include "lpi2c_simulator.h"
+#include "utils/test_suite.h"
+
+// Runs I2CScheduler on the real driver and the simulator.
+// Master (LPI2C1) reads from Slave1 (LPI2C3).
+class I2CSchedulerTest : public TestSuite {
+public:
+    static const uint8_t slave_address = 0x2D;
+    static const uint32_t timer_period_us = 100;
+    static uint8_t slave_rx[4];
+    static uint8_t slave_tx[8];
+
+    void setUp() override {
+        lpi2c_simulator.reset();
+        lpi2c_simulator.timing = LPI2CSimulator::Timing();
+        lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+        const uint8_t data[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+        memcpy(slave_tx, data, sizeof(slave_tx));
+        Slave1.set_receive_buffer(slave_rx, sizeof(slave_rx));
+        Slave1.listen(slave_address);
+        Slave1.set_transmit_buffer(slave_tx, sizeof(slave_tx));
+    }
+
+    void tearDown() override {
+        Master.end();
+        Slave1.stop_listening();
+    }
+
+    // Stands in for an IntervalTimer
+    static void run_timer(I2CScheduler& scheduler, uint32_t duration_us) {
+        for (uint32_t t = 0; t < duration_us; t += timer_period_us) {
+            scheduler.on_timer();
+            lpi2c_simulator.advance(timer_period_us * 1000ULL);
+        }
+    }
+
+    static void test_reads_each_device_at_its_own_rate() {
+        Master.begin(400'000);
+        I2CBusArbiter arbiter(Master);
+        I2CScheduler scheduler(arbiter);
+        uint8_t fast_storage[4], slow_storage[8];
+        I2CPeriodicRead fast(slave_address, nullptr, 0, 2, 1000, fast_storage);
+        I2CPeriodicRead slow(slave_address, nullptr, 0, 4, 5000, slow_storage);
+        TEST_ASSERT_TRUE(scheduler.add(fast));
+        TEST_ASSERT_TRUE(scheduler.add(slow));
+        uint8_t sample[4] = {};
+        TEST_ASSERT_FALSE(fast.latest(sample));
+
+        uint32_t start_us = micros();
+        scheduler.start();
+        run_timer(scheduler, 20'000);
+
+        TEST_ASSERT_EQUAL(20, fast.samples());
+        TEST_ASSERT_EQUAL(4, slow.samples());
+        TEST_ASSERT_EQUAL(0, fast.deadline_misses() + slow.deadline_misses());
+        TEST_ASSERT_EQUAL(0, fast.errors() + slow.errors());
+        uint32_t timestamp = 0;
+        TEST_ASSERT_TRUE(slow.latest(sample, &timestamp));
+        TEST_ASSERT_EQUAL_MEMORY(slave_tx, sample, 4);
+        TEST_ASSERT_UINT32_WITHIN(1000, start_us + 15'000, timestamp);
+        TEST_ASSERT_TRUE(fast.latest(sample, &timestamp));
+        TEST_ASSERT_EQUAL_MEMORY(slave_tx, sample, 2);
+        TEST_ASSERT_UINT32_WITHIN(1000, start_us + 19'000, timestamp);
+
+        // Each fast read takes about 72 us and each slow read 105 us
+        float utilisation = scheduler.bus_utilisation();
+        TEST_ASSERT_FLOAT_WITHIN(0.03, (20 * 72.0 + 4 * 105.0) / 20'000, utilisation);
+    }
+
+    static void test_reports_deadline_misses_when_bus_is_too_slow() {
+        Master.begin(100'000);
+        I2CBusArbiter arbiter(Master);
+        I2CScheduler scheduler(arbiter);
+        const uint8_t reg = 0x01;
+        uint8_t storage[8];
+        // A 4 byte register read takes about 650 us at 100 kHz
+        I2CPeriodicRead task(slave_address, &reg, 1, 4, 300, storage);
+        scheduler.add(task);
+
+        scheduler.start();
+        run_timer(scheduler, 10'000);
+
+        // The next read can't start until the timer notices the last one has finished
+        TEST_ASSERT_TRUE(task.samples() > 0);
+        // Every read is late but each one only counts once
+        TEST_ASSERT_TRUE(task.deadline_misses() >= task.samples());
+        TEST_ASSERT_TRUE(task.deadline_misses() <= task.samples() + 1);
+        float utilisation = scheduler.bus_utilisation();
+        TEST_ASSERT_TRUE(utilisation > 0.6);
+
+        // Don't leave the master part way through a read
+        scheduler.stop();
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([&arbiter]() { return arbiter.idle(); }, 10'000'000));
+    }
+
+    static void test_timestamp_is_when_read_started_on_bus() {
+        Master.begin(100'000);
+        I2CBusArbiter arbiter(Master);
+        I2CScheduler scheduler(arbiter, 1);
+        uint8_t storage[4];
+        I2CPeriodicRead task(slave_address, nullptr, 0, 2, 5000, storage);
+        scheduler.add(task);
+        // Another client holds the bus for about 1 ms when the read is due
+        I2CRequest* other_queue[2];
+        I2CBusClient other(arbiter, other_queue, 2, 0);
+        uint8_t other_buffer[8];
+        I2CRequest busy;
+        busy.address = slave_address;
+        busy.read_buffer = other_buffer;
+        busy.read_length = sizeof(other_buffer);
+        TEST_ASSERT_TRUE(other.submit(busy));
+
+        uint32_t due_us = micros();
+        scheduler.start();
+        run_timer(scheduler, 3'000);
+
+        uint32_t timestamp = 0;
+        uint8_t sample[2];
+        TEST_ASSERT_TRUE(task.latest(sample, &timestamp));
+        TEST_ASSERT_TRUE(timestamp - due_us > 800);
+        TEST_ASSERT_EQUAL(0, task.deadline_misses());
+    }
+
+    static void test_counts_errors_and_keeps_last_good_sample() {
+        Master.begin(400'000);
+        I2CBusArbiter arbiter(Master);
+        I2CScheduler scheduler(arbiter);
+        uint8_t storage[2];
+        I2CPeriodicRead missing(slave_address + 1, nullptr, 0, 1, 1000, storage);
+        scheduler.add(missing);
+
+        scheduler.start();
+        run_timer(scheduler, 5'000);
+        scheduler.stop();
+        run_timer(scheduler, 5'000);
+
+        uint8_t sample;
+        TEST_ASSERT_EQUAL(5, missing.errors());
+        TEST_ASSERT_EQUAL(0, missing.samples());
+        TEST_ASSERT_FALSE(missing.latest(&sample));
+    }
+
+    // Include all the tests here
+    void test() override {
+        RUN_TEST(test_reads_each_device_at_its_own_rate);
+        RUN_TEST(test_reports_deadline_misses_when_bus_is_too_slow);
+        RUN_TEST(test_timestamp_is_when_read_started_on_bus);
+        RUN_TEST(test_counts_errors_and_keeps_last_good_sample);
+    }
+
+    I2CSchedulerTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t I2CSchedulerTest::slave_rx[4];
+uint8_t I2CSchedulerTest::slave_tx[8];
+
+#endif //TEENSY_I2C_HOST_TEST_I2C_SCHEDULER_TEST
@@ -0,0 +1,134 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_HOST_TEST_I2C_TRIGGERED_READ_TEST
+#ifdef TEENSY_I2C_HOST_TEST_I2C_TRIGGERED_READ_TEST
+
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_triggered_read.h"
+#include "lpi2c_simulator.h"
+#include "utils/test_suite.h"
+
+// Runs I2CTriggeredRead on the real driver and the simulator.
+// Master (LPI2C1) reads from Slave1 (LPI2C3). The tests call
+// trigger() directly instead of from a pin interrupt.
+class I2CTriggeredReadTest : public TestSuite {
+public:
+    static const uint8_t slave_address = 0x2D;
+    static const uint64_t timeout_ns = 100'000'000;
+    static uint8_t slave_rx[4];
+    static const uint8_t slave_tx[3];
+    static uint32_t completions;
+    static uint32_t completed_timestamp_us;
+    static uint64_t completed_ns;
+    static bool other_request_finished;
+
+    void setUp() override {
+        lpi2c_simulator.reset();
+        lpi2c_simulator.timing = LPI2CSimulator::Timing();
+        lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+        completions = 0;
+        completed_timestamp_us = 0;
+        completed_ns = 0;
+        other_request_finished = false;
+        Slave1.set_receive_buffer(slave_rx, sizeof(slave_rx));
+        Slave1.listen(slave_address);
+        Slave1.set_transmit_buffer(slave_tx, sizeof(slave_tx));
+        Master.begin(400'000);
+    }
+
+    void tearDown() override {
+        Master.end();
+        Slave1.stop_listening();
+    }
+
+    static void record_completion(const I2CRequest& request, uint32_t timestamp_us) {
+        completions++;
+        completed_timestamp_us = timestamp_us;
+        completed_ns = lpi2c_simulator.now_ns();
+    }
+
+    static void test_trigger_starts_read_straight_away() {
+        I2CBusArbiter arbiter(Master);
+        const uint8_t reg = 0x07;
+        uint8_t sample[sizeof(slave_tx)] = {};
+        I2CTriggeredRead read(arbiter, slave_address, &reg, 1, sample, sizeof(sample));
+        read.on_complete(record_completion);
+        lpi2c_simulator.advance(1'000'000);
+
+        uint32_t trigger_us = micros();
+        uint64_t trigger_ns = lpi2c_simulator.now_ns();
+        TEST_ASSERT_TRUE(read.trigger());
+        TEST_ASSERT_FALSE(read.finished());
+        TEST_ASSERT_FALSE(Master.finished());   // Already on the bus
+
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([&read]() { return read.finished(); }, timeout_ns));
+        TEST_ASSERT_EQUAL(1, completions);
+        TEST_ASSERT_EQUAL_MEMORY(slave_tx, sample, sizeof(slave_tx));
+        TEST_ASSERT_UINT32_WITHIN(1, trigger_us, completed_timestamp_us);
+        // 6 bytes including 2 addresses at 2.5 us per bit
+        // plus START, repeated START and STOP
+        TEST_ASSERT_TRUE(completed_ns - trigger_ns < 160'000);
+    }
+
+    static void test_waits_for_current_request_then_goes_first() {
+        I2CBusArbiter arbiter(Master);
+        I2CRequest* other_queue[3];
+        I2CBusClient other(arbiter, other_queue, 3, 5);
+        I2CRequest first, second;
+        first.address = second.address = slave_address;
+        uint8_t sample[sizeof(slave_tx)];
+        I2CTriggeredRead read(arbiter, slave_address, nullptr, 0, sample, sizeof(sample));
+        read.on_complete([&second](const I2CRequest& request, uint32_t timestamp_us) {
+            other_request_finished = second.finished();
+            completions++;
+        });
+
+        other.submit(first);
+        other.submit(second);
+        TEST_ASSERT_TRUE(read.trigger());
+
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([&arbiter]() { return arbiter.idle(); }, timeout_ns));
+        TEST_ASSERT_EQUAL(1, completions);
+        TEST_ASSERT_FALSE(other_request_finished);
+        TEST_ASSERT_EQUAL(I2CError::ok, first.error);
+        TEST_ASSERT_EQUAL(I2CError::ok, second.error);
+    }
+
+    static void test_counts_overruns() {
+        I2CBusArbiter arbiter(Master);
+        uint8_t sample[sizeof(slave_tx)];
+        I2CTriggeredRead read(arbiter, slave_address, nullptr, 0, sample, sizeof(sample));
+
+        TEST_ASSERT_TRUE(read.trigger());
+        TEST_ASSERT_FALSE(read.trigger());
+        TEST_ASSERT_EQUAL(1, read.overruns());
+
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([&read]() { return read.finished(); }, timeout_ns));
+        TEST_ASSERT_TRUE(read.trigger());
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([&read]() { return read.finished(); }, timeout_ns));
+        TEST_ASSERT_EQUAL(1, read.overruns());
+    }
+
+    // Include all the tests here
+    void test() override {
+        RUN_TEST(test_trigger_starts_read_straight_away);
+        RUN_TEST(test_waits_for_current_request_then_goes_first);
+        RUN_TEST(test_counts_overruns);
+    }
+
+    I2CTriggeredReadTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t I2CTriggeredReadTest::slave_rx[4];
+const uint8_t I2CTriggeredReadTest::slave_tx[3] = {0xA1, 0xB2, 0xC3};
+uint32_t I2CTriggeredReadTest::completions;
+uint32_t I2CTriggeredReadTest::completed_timestamp_us;
+uint64_t I2CTriggeredReadTest::completed_ns;
+bool I2CTriggeredReadTest::other_request_finished;
+
+#endif //TEENSY_I2C_HOST_TEST_I2C_TRIGGERED_READ_TEST
@@ -0,0 +1,495 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_HOST_TEST_LPI2C_SIMULATOR_TEST
+#ifdef TEENSY_I2C_HOST_TEST_LPI2C_SIMULATOR_TEST
+
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "imx_rt1060/imx_rt1060_i2c_driver.h"
+#include "i2c_driver_wire.h"
+#include "i2c_transaction_log.h"
+#include "lpi2c_simulator.h"
+#include "utils/test_suite.h"
+
+// Runs the real driver against the simulator.
+// Master (LPI2C1) is connected to Slave1 (LPI2C3).
+class LPI2CSimulatorTest : public TestSuite {
+public:
+    static const uint8_t slave_address = 0x2D;
+    static const uint64_t timeout_ns = 100'000'000;
+    static uint8_t slave_rx[16];
+    static size_t slave_rx_length;
+    static uint32_t slave_transmits;
+
+    void setUp() override {
+        lpi2c_simulator.reset();
+        lpi2c_simulator.timing = LPI2CSimulator::Timing();
+        lpi2c_simulator.connect(simulated_lpi2c1, simulated_lpi2c3);
+        memset(slave_rx, 0, sizeof(slave_rx));
+        slave_rx_length = 0;
+        slave_transmits = 0;
+        Slave1.after_receive([](size_t length, uint16_t address) { slave_rx_length = length; });
+        Slave1.after_transmit([](uint16_t address) { slave_transmits++; });
+        Slave1.set_receive_buffer(slave_rx, sizeof(slave_rx));
+        Slave1.listen(slave_address);
+    }
+
+    void tearDown() override {
+        Master.end();
+        Slave1.stop_listening();
+        Master.set_transaction_log(nullptr);
+        Master.set_device_frequency(slave_address, 0);
+        Master.after_transfer(nullptr);
+        Slave1.set_transaction_log(nullptr);
+        Slave1.set_timestamp_address(false);
+    }
+
+    static bool wait_for_master() {
+        return lpi2c_simulator.run_until([]() { return Master.finished(); }, timeout_ns);
+    }
+
+    static void test_master_writes_to_slave() {
+        const uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+        TEST_ASSERT_EQUAL(sizeof(data), Master.get_bytes_transferred());
+        TEST_ASSERT_EQUAL(sizeof(data), slave_rx_length);
+        TEST_ASSERT_EQUAL_MEMORY(data, slave_rx, sizeof(data));
+    }
+
+    static void test_master_reads_from_slave() {
+        const uint8_t data[] = {0xA1, 0xB2, 0xC3, 0xD4, 0xE5};
+        uint8_t rx[sizeof(data)] = {};
+        Slave1.set_transmit_buffer(data, sizeof(data));
+        Master.begin(400'000);
+
+        Master.read_async(slave_address, rx, sizeof(rx), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+        TEST_ASSERT_EQUAL_MEMORY(data, rx, sizeof(data));
+        TEST_ASSERT_EQUAL(1, slave_transmits);
+        TEST_ASSERT_EQUAL(I2CError::ok, Slave1.error());
+    }
+
+    static void test_master_gets_nak_from_missing_slave() {
+        uint8_t rx[1] = {};
+        Master.begin(400'000);
+
+        Master.read_async(slave_address + 1, rx, sizeof(rx), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_EQUAL(I2CError::address_nak, Master.error());
+        TEST_ASSERT_EQUAL(0, slave_transmits);
+    }
+
+    static void test_zero_length_write_probes_slave() {
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, nullptr, 0, true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+    }
+
+    static void test_slave_applies_access_rules_as_it_stores_each_byte() {
+        const I2CRegisterAccess rules[] = {
+                {RegisterAccess::read_write, 0x0F},
+                {RegisterAccess::read_only, 0xFF},
+                {RegisterAccess::write_1_to_clear, 0xFF},
+        };
+        uint8_t registers[] = {0xA0, 0x55, 0xFF};
+        Slave1.set_masked_receive_buffer(registers, sizeof(registers), rules);
+        const uint8_t data[] = {0xFF, 0x00, 0x0F};
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_EQUAL(sizeof(data), slave_rx_length);
+        const uint8_t expected[] = {0xAF, 0x55, 0xF0};
+        TEST_ASSERT_EQUAL_MEMORY(expected, registers, sizeof(registers));
+    }
+
+    static void test_repeated_start_ends_slave_receive() {
+        const uint8_t reg[] = {0x07};
+        const uint8_t data[] = {0x55, 0x66};
+        uint8_t rx[sizeof(data)] = {};
+        Slave1.set_transmit_buffer(data, sizeof(data));
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, reg, sizeof(reg), false);
+        TEST_ASSERT_TRUE(wait_for_master());
+        Master.read_async(slave_address, rx, sizeof(rx), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+        TEST_ASSERT_EQUAL(1, slave_rx_length);
+        TEST_ASSERT_EQUAL_HEX8(0x07, slave_rx[0]);
+        TEST_ASSERT_EQUAL_MEMORY(data, rx, sizeof(data));
+    }
+
+    static void test_master_does_not_report_abandoned_transfer() {
+        const uint8_t data[] = {0x01, 0x02, 0x03, 0x04};
+        static uint32_t callbacks;
+        static I2CError callback_error;
+        callbacks = 0;
+        Master.after_transfer([]() {
+            callbacks++;
+            callback_error = Master.error();
+        });
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+        Master.write_async(slave_address, data, sizeof(data), true);
+
+        TEST_ASSERT_EQUAL(1, callbacks);
+        TEST_ASSERT_EQUAL(I2CError::master_not_ready, callback_error);
+        TEST_ASSERT_TRUE(wait_for_master());
+        lpi2c_simulator.run_until([]() { return false; }, timeout_ns / 10);
+        TEST_ASSERT_EQUAL(1, callbacks);
+    }
+
+    static void test_slave_stretches_clock_when_isr_is_slow() {
+        const uint8_t data[] = {0x11, 0x22, 0x33, 0x44};
+        lpi2c_simulator.timing.isr_entry_ns = 50'000;
+        Master.begin(1'000'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+        TEST_ASSERT_EQUAL_MEMORY(data, slave_rx, sizeof(data));
+        TEST_ASSERT_TRUE(simulated_lpi2c1.stats.clock_stretch_ns > 0);
+    }
+
+    static void test_standard_mode_takes_9_clocks_per_byte() {
+        uint8_t data[10] = {};
+        Master.begin(100'000);
+
+        uint64_t start = lpi2c_simulator.now_ns();
+        Master.write_async(slave_address, data, sizeof(data), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+        uint64_t elapsed = lpi2c_simulator.now_ns() - start;
+
+        // 11 bytes including the address at 10 us per clock
+        // plus START and STOP
+        uint64_t bytes_ns = 11 * 9 * 10'000;
+        TEST_ASSERT_TRUE(elapsed > bytes_ns);
+        TEST_ASSERT_TRUE(elapsed < bytes_ns + 20'000);
+    }
+
+    // Returns how long the write took in nanoseconds
+    static uint64_t timed_write(uint8_t address, const uint8_t* data, size_t length) {
+        uint64_t start = lpi2c_simulator.now_ns();
+        Master.write_async(address, data, length, true);
+        wait_for_master();
+        return lpi2c_simulator.now_ns() - start;
+    }
+
+    static void test_master_switches_speed_for_each_device() {
+        const uint8_t fast_device = slave_address;
+        const uint8_t slow_device = slave_address + 1;
+        const uint8_t data[10] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A};
+        Slave1.listen(fast_device, slow_device);
+        Master.begin(100'000);
+        Master.set_device_frequency(fast_device, 1'000'000);
+
+        uint64_t fast_ns = timed_write(fast_device, data, sizeof(data));
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+        TEST_ASSERT_EQUAL_MEMORY(data, slave_rx, sizeof(data));
+        uint64_t slow_ns = timed_write(slow_device, data, sizeof(data));
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+        uint64_t fast_again_ns = timed_write(fast_device, data, sizeof(data));
+        TEST_ASSERT_EQUAL(I2CError::ok, Master.error());
+
+        // 11 bytes including the address. About 10 us per clock at 100 kHz.
+        TEST_ASSERT_TRUE(slow_ns > 11 * 9 * 10'000);
+        TEST_ASSERT_TRUE(fast_ns * 5 < slow_ns);
+        TEST_ASSERT_TRUE(fast_again_ns * 5 < slow_ns);
+
+        // Back to the bus frequency
+        Master.set_device_frequency(fast_device, 0);
+        TEST_ASSERT_TRUE(timed_write(fast_device, data, sizeof(data)) > 11 * 9 * 10'000);
+    }
+
+    static void test_master_and_slave_record_timestamps() {
+        const uint8_t data[] = {0x01, 0x02};
+        static I2CTimestamps slave_timestamps;
+        Slave1.after_receive([](size_t length, uint16_t address) {
+            slave_timestamps = Slave1.get_timestamps();
+        });
+        Master.begin(100'000);
+        lpi2c_simulator.advance(1'000'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+
+        // 3 bytes including the address at 10 us per clock and 600 cycles per us
+        const uint32_t cycles_per_bit = 10 * 600;
+        I2CTimestamps master_timestamps = Master.get_timestamps();
+        uint32_t master_cycles = master_timestamps.stop - master_timestamps.start;
+        TEST_ASSERT_UINT32_WITHIN(2 * cycles_per_bit, 27 * cycles_per_bit, master_cycles);
+        TEST_ASSERT_TRUE(master_timestamps.address - master_timestamps.start < 10 * cycles_per_bit);
+
+        // By default the slave doesn't see the address until the first byte arrives
+        TEST_ASSERT_TRUE(slave_timestamps.address - master_timestamps.start > 17 * cycles_per_bit);
+        TEST_ASSERT_EQUAL(slave_timestamps.start, slave_timestamps.address);
+        TEST_ASSERT_UINT32_WITHIN(2 * cycles_per_bit, slave_timestamps.stop, master_timestamps.stop);
+    }
+
+    static void test_slave_can_timestamp_address_match() {
+        const uint8_t data[] = {0x01, 0x02};
+        static I2CTimestamps slave_timestamps;
+        Slave1.set_timestamp_address(true);
+        Slave1.listen(slave_address);
+        Slave1.after_receive([](size_t length, uint16_t address) {
+            slave_rx_length = length;
+            slave_timestamps = Slave1.get_timestamps();
+        });
+        Master.begin(100'000);
+        lpi2c_simulator.advance(1'000'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+
+        // The address takes 9 clocks at 10 us per clock and 600 cycles per us
+        const uint32_t cycles_per_bit = 10 * 600;
+        uint32_t address_cycles = slave_timestamps.address - Master.get_timestamps().start;
+        TEST_ASSERT_UINT32_WITHIN(2 * cycles_per_bit, 9 * cycles_per_bit, address_cycles);
+        TEST_ASSERT_EQUAL(sizeof(data), slave_rx_length);
+    }
+
+    static void test_counts_interrupts() {
+        uint8_t data[8] = {};
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_TRUE(simulated_lpi2c1.stats.isr_entries > 0);
+        // One RDF per byte plus address and end of frame flags
+        TEST_ASSERT_TRUE(simulated_lpi2c3.stats.isr_entries >= sizeof(data));
+        TEST_ASSERT_EQUAL(sizeof(data), simulated_lpi2c1.stats.master_bytes_sent);
+        TEST_ASSERT_EQUAL(sizeof(data), simulated_lpi2c3.stats.slave_bytes_received);
+        TEST_ASSERT_EQUAL(0, lpi2c_simulator.interrupt_storms());
+    }
+
+    static void test_profiles_register_accesses_by_isr_cause() {
+        uint8_t data[8] = {};
+        Master.begin(400'000);
+        simulated_lpi2c1.profile.reset();
+        simulated_lpi2c3.profile.reset();
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+
+        TEST_ASSERT_TRUE(wait_for_master());
+        const RegisterAccessProfile& master = simulated_lpi2c1.profile;
+        const RegisterAccessProfile& slave = simulated_lpi2c3.profile;
+        // The master ISR fills the FIFO and the slave ISR empties SRDR
+        TEST_ASSERT_TRUE(master.writes(IsrCause::master_transmit, LPI2CRegisterId::MTDR) >= sizeof(data));
+        TEST_ASSERT_EQUAL(sizeof(data), slave.reads(IsrCause::slave_receive, LPI2CRegisterId::SRDR));
+        TEST_ASSERT_EQUAL(0, slave.reads(IsrCause::main, LPI2CRegisterId::SRDR));
+        // The address and START command are written by write_async()
+        TEST_ASSERT_TRUE(master.writes(IsrCause::main, LPI2CRegisterId::MTDR) > 0);
+        TEST_ASSERT_EQUAL(simulated_lpi2c3.stats.isr_entries,
+                          slave.isr_entries(IsrCause::slave_receive) + slave.isr_entries(IsrCause::slave_end));
+    }
+
+    static void test_drivers_record_transactions_in_log() {
+        const uint8_t data[] = {0x01, 0x02, 0x03};
+        const uint8_t tx[] = {0xA1, 0xB2};
+        uint8_t rx[sizeof(tx)] = {};
+        uint8_t log_buffer[128];
+        I2CTransactionLog log(log_buffer, sizeof(log_buffer));
+        Master.set_transaction_log(&log);
+        Slave1.set_transaction_log(&log);
+        Slave1.set_transmit_buffer(tx, sizeof(tx));
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+        Master.read_async(slave_address, rx, sizeof(rx), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+        Master.write_async(slave_address + 1, nullptr, 0, true);
+        TEST_ASSERT_TRUE(wait_for_master());
+
+        // The master sees the STOP before the slave does
+        uint8_t entries[128];
+        size_t length = log.read(entries, sizeof(entries));
+        const size_t h = I2C_LOG_HEADER_LENGTH;
+        TEST_ASSERT_EQUAL(5 * h + 2 * sizeof(data) + 2 * sizeof(tx), length);
+        const uint8_t* entry = entries;
+        TEST_ASSERT_EQUAL(0, entry[1]);
+        TEST_ASSERT_EQUAL(slave_address, entry[8]);
+        TEST_ASSERT_EQUAL(sizeof(data), entry[10]);
+        TEST_ASSERT_EQUAL_MEMORY(data, entry + h, sizeof(data));
+        entry += h + sizeof(data);
+        TEST_ASSERT_EQUAL(I2C_LOG_FLAG_SLAVE | 2, entry[1]);
+        TEST_ASSERT_EQUAL(static_cast<uint8_t>(I2CError::ok), entry[2]);
+        TEST_ASSERT_EQUAL_MEMORY(data, entry + h, sizeof(data));
+        entry += h + sizeof(data);
+        TEST_ASSERT_EQUAL(I2C_LOG_FLAG_READ, entry[1]);
+        TEST_ASSERT_EQUAL(sizeof(tx), entry[10]);
+        TEST_ASSERT_EQUAL_MEMORY(tx, entry + h, sizeof(tx));
+        entry += h + sizeof(tx);
+        TEST_ASSERT_EQUAL(I2C_LOG_FLAG_SLAVE | I2C_LOG_FLAG_READ | 2, entry[1]);
+        TEST_ASSERT_EQUAL(sizeof(tx), entry[10]);
+        TEST_ASSERT_EQUAL_MEMORY(tx, entry + h, sizeof(tx));
+        entry += h + sizeof(tx);
+        TEST_ASSERT_EQUAL(0, entry[1]);
+        TEST_ASSERT_EQUAL(slave_address + 1, entry[8]);
+        TEST_ASSERT_EQUAL(static_cast<uint8_t>(I2CError::address_nak), entry[2]);
+        TEST_ASSERT_EQUAL(0, entry[3]);
+    }
+
+    static void test_wire_with_large_buffers_transfers_in_one_transaction() {
+        uint8_t wire_rx[64];
+        uint8_t wire_tx[64];
+        I2CDriverWire wire(Master, Slave, wire_rx, sizeof(wire_rx), wire_tx, sizeof(wire_tx));
+        TEST_ASSERT_EQUAL(I2CDriverWire::rx_buffer_length, Wire.rxBufferLength());
+        TEST_ASSERT_EQUAL(I2CDriverWire::tx_buffer_length, Wire.txBufferLength());
+        I2CDriverWire default_wire(Master, Slave);
+        TEST_ASSERT_EQUAL(I2CDriverWire::rx_buffer_length, default_wire.rxBufferLength());
+        uint8_t data[48];
+        for (size_t i = 0; i < sizeof(data); i++) {
+            data[i] = (uint8_t)i;
+        }
+        uint8_t received[sizeof(data)] = {};
+        Slave1.set_receive_buffer(received, sizeof(received));
+        Slave1.set_transmit_buffer(data, sizeof(data));
+        wire.setClock(400'000);
+        wire.begin();
+
+        wire.beginTransmission(slave_address);
+        TEST_ASSERT_EQUAL(sizeof(data), wire.write(data, sizeof(data)));
+        TEST_ASSERT_EQUAL(0, wire.endTransmission());
+        TEST_ASSERT_EQUAL(sizeof(data), slave_rx_length);
+        TEST_ASSERT_EQUAL_MEMORY(data, received, sizeof(data));
+
+        TEST_ASSERT_EQUAL(sizeof(data), wire.requestFrom(slave_address, sizeof(data)));
+        for (size_t i = 0; i < sizeof(data); i++) {
+            TEST_ASSERT_EQUAL(data[i], wire.read());
+        }
+        TEST_ASSERT_EQUAL(1, slave_transmits);
+    }
+
+    static void test_wire_async_transfers_return_immediately() {
+        const uint8_t data[] = {0x11, 0x22, 0x33, 0x44};
+        Slave1.set_transmit_buffer(data, sizeof(data));
+        Wire.setClock(400'000);
+        Wire.begin();
+
+        Wire.beginTransmission(slave_address);
+        Wire.write(data, sizeof(data));
+        Wire.endTransmissionAsync();
+        TEST_ASSERT_FALSE(Wire.done());
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([]() { return Wire.done(); }, timeout_ns));
+        TEST_ASSERT_EQUAL(0, Wire.getLastResult());
+        TEST_ASSERT_EQUAL_MEMORY(data, slave_rx, sizeof(data));
+
+        Wire.requestFromAsync(slave_address, sizeof(data));
+        TEST_ASSERT_FALSE(Wire.done());
+        TEST_ASSERT_EQUAL(0, Wire.available());
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([]() { return Wire.available() > 0; }, timeout_ns));
+        TEST_ASSERT_TRUE(Wire.done());
+        TEST_ASSERT_EQUAL(0, Wire.getLastResult());
+        TEST_ASSERT_EQUAL(sizeof(data), Wire.available());
+        TEST_ASSERT_EQUAL(data[0], Wire.peek());
+        for (uint8_t expected : data) {
+            TEST_ASSERT_EQUAL(expected, Wire.read());
+        }
+        TEST_ASSERT_EQUAL(I2CDriverWire::no_more_bytes, Wire.read());
+
+        Wire.beginTransmission(slave_address + 1);
+        Wire.endTransmissionAsync();
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([]() { return Wire.done(); }, timeout_ns));
+        TEST_ASSERT_EQUAL(2, Wire.getLastResult());
+        Wire.end();
+    }
+
+    static void test_wire_gives_up_after_timeout() {
+        Wire.begin();
+        // The master's ISR never runs so it never finishes
+        lpi2c_simulator.enable_irq(IRQ_LPI2C1, false);
+
+        Wire.beginTransmission(slave_address);
+        Wire.write(0x01);
+        TEST_ASSERT_EQUAL(I2CDriverWire::timeout_result, Wire.endTransmission());
+        TEST_ASSERT_TRUE(Wire.done());
+        TEST_ASSERT_EQUAL(I2CDriverWire::timeout_result, Wire.getLastResult());
+
+        // The next call doesn't wait for the transfer that timed out
+        uint32_t start_ms = millis();
+        Wire.beginTransmission(slave_address);
+        TEST_ASSERT_TRUE(millis() - start_ms < I2CDriverWire::timeout_millis / 2);
+        lpi2c_simulator.enable_irq(IRQ_LPI2C1, true);
+        TEST_ASSERT_TRUE(wait_for_master());
+        Wire.end();
+    }
+
+    static void test_wire_slave_exposes_received_bytes_without_copying() {
+        const uint8_t data[] = {0x10, 0x20, 0x30, 0x40, 0x50};
+        uint8_t wire_rx[4];
+        uint8_t wire_tx[4];
+        uint8_t user_rx[40] = {};
+        I2CDriverWire wire(Master1, Slave1, wire_rx, sizeof(wire_rx), wire_tx, sizeof(wire_tx));
+        wire.setReceiveBuffer(user_rx, sizeof(user_rx));
+        TEST_ASSERT_EQUAL(sizeof(user_rx), wire.rxBufferLength());
+        wire.begin(slave_address);
+        Master.begin(400'000);
+
+        Master.write_async(slave_address, data, sizeof(data), true);
+        TEST_ASSERT_TRUE(wait_for_master());
+        TEST_ASSERT_TRUE(lpi2c_simulator.run_until([&wire]() { return wire.length() > 0; }, timeout_ns));
+
+        TEST_ASSERT_EQUAL(sizeof(data), wire.length());
+        TEST_ASSERT_EQUAL_PTR(user_rx, wire.data());
+        TEST_ASSERT_EQUAL_MEMORY(data, wire.data(), sizeof(data));
+        wire.skip(2);
+        TEST_ASSERT_EQUAL(sizeof(data) - 2, wire.length());
+        TEST_ASSERT_EQUAL_PTR(user_rx + 2, wire.data());
+        TEST_ASSERT_EQUAL(data[2], wire.read());
+        wire.skip(100);
+        TEST_ASSERT_EQUAL(0, wire.available());
+        wire.end();
+    }
+
+    // Include all the tests here
+    void test() override {
+        RUN_TEST(test_master_writes_to_slave);
+        RUN_TEST(test_master_reads_from_slave);
+        RUN_TEST(test_master_gets_nak_from_missing_slave);
+        RUN_TEST(test_zero_length_write_probes_slave);
+        RUN_TEST(test_slave_applies_access_rules_as_it_stores_each_byte);
+        RUN_TEST(test_repeated_start_ends_slave_receive);
+        RUN_TEST(test_master_does_not_report_abandoned_transfer);
+        RUN_TEST(test_slave_stretches_clock_when_isr_is_slow);
+        RUN_TEST(test_standard_mode_takes_9_clocks_per_byte);
+        RUN_TEST(test_master_switches_speed_for_each_device);
+        RUN_TEST(test_master_and_slave_record_timestamps);
+        RUN_TEST(test_slave_can_timestamp_address_match);
+        RUN_TEST(test_counts_interrupts);
+        RUN_TEST(test_profiles_register_accesses_by_isr_cause);
+        RUN_TEST(test_drivers_record_transactions_in_log);
+        RUN_TEST(test_wire_with_large_buffers_transfers_in_one_transaction);
+        RUN_TEST(test_wire_async_transfers_return_immediately);
+        RUN_TEST(test_wire_gives_up_after_timeout);
+        RUN_TEST(test_wire_slave_exposes_received_bytes_without_copying);
+    }
+
+    LPI2CSimulatorTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t LPI2CSimulatorTest::slave_rx[16];
+size_t LPI2CSimulatorTest::slave_rx_length;
+uint32_t LPI2CSimulatorTest::slave_transmits;
+
+#endif //TEENSY_I2C_HOST_TEST_LPI2C_SIMULATOR_TEST
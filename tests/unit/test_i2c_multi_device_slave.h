@@ -0,0 +1,223 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_UNIT_TEST_I2C_MULTI_DEVICE_SLAVE_TEST
+#ifdef TEENSY_I2C_UNIT_TEST_I2C_MULTI_DEVICE_SLAVE_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <cstdint>
+#include "i2c_multi_device_slave.h"
+#include "utils/test_suite.h"
+
+// Mimics the order in which IMX_RT1060_I2CSlave calls its callbacks.
+class MultiDeviceDummySlave : public I2CSlave {
+public:
+    virtual ~MultiDeviceDummySlave() = default;
+
+    void listen(uint8_t address) override {
+        first_address = address;
+        last_address = address;
+    };
+
+    void listen(uint8_t first, uint8_t second) override {
+        // Not implemented as not required by I2CMultiDeviceSlave
+    }
+
+    void listen_range(uint8_t first, uint8_t last) override {
+        first_address = first;
+        last_address = last;
+    }
+
+    void stop_listening() override {
+        first_address = 0;
+        last_address = 0;
+    };
+
+    void after_receive(std::function<void(size_t length, uint16_t address)> callback) override {
+        after_receive_callback = callback;
+    }
+
+    void before_receive(std::function<void(uint16_t address)> callback) override {
+        before_receive_callback = callback;
+    };
+
+    void after_receive_buffer_full(std::function<void(uint16_t address)> callback) override {
+        // Not implemented as not required by I2CMultiDeviceSlave
+    };
+
+    void before_transmit(std::function<void(uint16_t address)> callback) override {
+        before_transmit_callback = callback;
+    };
+
+    void after_transmit(std::function<void(uint16_t address)> callback) override {
+        after_transmit_callback = callback;
+    };
+
+    void set_transmit_buffer(const uint8_t* buffer, size_t size) override {
+        tx_buffer = buffer;
+        tx_buffer_size = size;
+    };
+
+    void set_receive_buffer(uint8_t* buffer, size_t size) override {
+        rx_buffer = buffer;
+        rx_buffer_size = size;
+    }
+
+    // The master writes 'len' bytes to 'address'
+    void master_write(uint16_t address, const uint8_t* buffer, size_t len) {
+        if (before_receive_callback) {
+            before_receive_callback(address);
+        }
+        if (rx_buffer_size > 0) {
+            memcpy(rx_buffer, buffer, min(len, rx_buffer_size));
+            if (after_receive_callback) {
+                after_receive_callback(min(len, rx_buffer_size), address);
+            }
+        }
+    }
+
+    // The master reads 'len' bytes from 'address'
+    void master_read(uint16_t address, uint8_t* buffer, size_t len) {
+        if (before_transmit_callback) {
+            before_transmit_callback(address);
+        }
+        memset(buffer, 0, len);
+        if (tx_buffer) {
+            memcpy(buffer, tx_buffer, min(len, tx_buffer_size));
+        }
+        if (after_transmit_callback) {
+            after_transmit_callback(address);
+        }
+    }
+
+    uint8_t first_address = 0;
+    uint8_t last_address = 0;
+
+private:
+    uint8_t* rx_buffer = nullptr;
+    size_t rx_buffer_size = 0;
+    const uint8_t* tx_buffer = nullptr;
+    size_t tx_buffer_size = 0;
+    std::function<void(size_t length, uint16_t address)> after_receive_callback = nullptr;
+    std::function<void(uint16_t address)> before_receive_callback = nullptr;
+    std::function<void(uint16_t address)> before_transmit_callback = nullptr;
+    std::function<void(uint16_t address)> after_transmit_callback = nullptr;
+};
+
+class I2CMultiDeviceSlaveTest : public TestSuite {
+public:
+    static MultiDeviceDummySlave* dummy;
+    static uint8_t rx_a[2];
+    static uint8_t rx_b[2];
+    static uint8_t tx_a[2];
+    static uint8_t tx_b[2];
+    static const I2CEmulatedDevice* last_device;
+    static size_t last_length;
+
+    static void on_receive(const I2CEmulatedDevice& device, size_t length) {
+        last_device = &device;
+        last_length = length;
+    }
+
+    static void on_transmit(const I2CEmulatedDevice& device) {
+        last_device = &device;
+    }
+
+    static const I2CEmulatedDevice devices[];
+
+    void setUp() override {
+        dummy = new MultiDeviceDummySlave();
+        memset(rx_a, 0, sizeof(rx_a));
+        memset(rx_b, 0, sizeof(rx_b));
+        last_device = nullptr;
+        last_length = 0;
+    }
+
+    void tearDown() override {
+        delete(dummy);
+        dummy = nullptr;
+    }
+
+    static void test_listens_to_range_covering_all_devices() {
+        I2CMultiDeviceSlave multi_slave(*dummy, devices, 2);
+        multi_slave.listen();
+
+        TEST_ASSERT_EQUAL(0x10, dummy->first_address);
+        TEST_ASSERT_EQUAL(0x30, dummy->last_address);
+    }
+
+    static void test_finds_device_by_address() {
+        I2CMultiDeviceSlave multi_slave(*dummy, devices, 2);
+
+        TEST_ASSERT_EQUAL_PTR(&devices[1], multi_slave.find_device(0x10));
+        TEST_ASSERT_EQUAL_PTR(&devices[0], multi_slave.find_device(0x30));
+        TEST_ASSERT_NULL(multi_slave.find_device(0x20));
+        TEST_ASSERT_NULL(multi_slave.find_device(0x200));
+    }
+
+    static void test_master_writes_to_the_device_it_called() {
+        I2CMultiDeviceSlave multi_slave(*dummy, devices, 2);
+        multi_slave.listen();
+
+        uint8_t data[] = {0xAA, 0xBB};
+        dummy->master_write(0x10, data, sizeof(data));
+
+        uint8_t blank[] = {0x00, 0x00};
+        TEST_ASSERT_EQUAL_MEMORY(blank, rx_a, sizeof(rx_a));
+        TEST_ASSERT_EQUAL_MEMORY(data, rx_b, sizeof(rx_b));
+        TEST_ASSERT_EQUAL_PTR(&devices[1], last_device);
+        TEST_ASSERT_EQUAL(sizeof(data), last_length);
+    }
+
+    static void test_master_reads_from_the_device_it_called() {
+        I2CMultiDeviceSlave multi_slave(*dummy, devices, 2);
+        multi_slave.listen();
+
+        uint8_t data[2] = {};
+        dummy->master_read(0x30, data, sizeof(data));
+
+        TEST_ASSERT_EQUAL_MEMORY(tx_a, data, sizeof(data));
+        TEST_ASSERT_EQUAL_PTR(&devices[0], last_device);
+    }
+
+    static void test_ignores_addresses_without_a_device() {
+        I2CMultiDeviceSlave multi_slave(*dummy, devices, 2);
+        multi_slave.listen();
+
+        uint8_t data[] = {0xAA, 0xBB};
+        dummy->master_write(0x20, data, sizeof(data));
+        dummy->master_read(0x20, data, sizeof(data));
+
+        uint8_t blank[] = {0x00, 0x00};
+        TEST_ASSERT_EQUAL_MEMORY(blank, rx_a, sizeof(rx_a));
+        TEST_ASSERT_EQUAL_MEMORY(blank, rx_b, sizeof(rx_b));
+        TEST_ASSERT_EQUAL_MEMORY(blank, data, sizeof(data));
+        TEST_ASSERT_NULL(last_device);
+    }
+
+    void test() final {
+        RUN_TEST(test_listens_to_range_covering_all_devices);
+        RUN_TEST(test_finds_device_by_address);
+        RUN_TEST(test_master_writes_to_the_device_it_called);
+        RUN_TEST(test_master_reads_from_the_device_it_called);
+        RUN_TEST(test_ignores_addresses_without_a_device);
+    }
+
+    I2CMultiDeviceSlaveTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+MultiDeviceDummySlave* I2CMultiDeviceSlaveTest::dummy;
+uint8_t I2CMultiDeviceSlaveTest::rx_a[2] = {};
+uint8_t I2CMultiDeviceSlaveTest::rx_b[2] = {};
+uint8_t I2CMultiDeviceSlaveTest::tx_a[2] = {0x0A, 0x0B};
+uint8_t I2CMultiDeviceSlaveTest::tx_b[2] = {0x1A, 0x1B};
+const I2CEmulatedDevice* I2CMultiDeviceSlaveTest::last_device = nullptr;
+size_t I2CMultiDeviceSlaveTest::last_length = 0;
+const I2CEmulatedDevice I2CMultiDeviceSlaveTest::devices[] = {
+        {0x30, rx_a, sizeof(rx_a), tx_a, sizeof(tx_a), on_receive, nullptr, on_transmit, nullptr},
+        {0x10, rx_b, sizeof(rx_b), tx_b, sizeof(tx_b), on_receive, nullptr, on_transmit, nullptr},
+};
+
+#endif //TEENSY_I2C_UNIT_TEST_I2C_MULTI_DEVICE_SLAVE_TEST
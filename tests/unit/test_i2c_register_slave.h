@@ -29,6 +29,10 @@ public:
         after_receive_callback = callback;
     }
 
+    void after_receive_buffer_full(std::function<void(uint16_t address)> callback) override {
+        after_receive_buffer_full_callback = callback;
+    };
+
     void before_transmit(std::function<void(uint16_t address)> callback) override {
     };
 
@@ -44,34 +48,53 @@ public:
     void set_receive_buffer(uint8_t* buffer, size_t size) override {
         latest_rx_buffer = buffer;
         latest_rx_buffer_size = size;
+        rx_index = 0;
+        latest_rx_rules = nullptr;
     }
 
-    void write(uint8_t reg_num, uint8_t* buffer, size_t len) {
-        if (latest_rx_buffer) {
-            latest_rx_buffer[0] = reg_num;
-            memcpy(latest_rx_buffer+1, buffer, min(len, latest_rx_buffer_size-1));
-            if(after_receive_callback) {
-                after_receive_callback(len+1, address);
+    void set_masked_receive_buffer(uint8_t* buffer, size_t size, const I2CRegisterAccess* rules) override {
+        set_receive_buffer(buffer, size);
+        latest_rx_rules = rules;
+    }
+
+    // Mimics the way IMX_RT1060_I2CSlave stores each byte it receives.
+    // Without a receive buffer, it drops the bytes but still calls after_receive.
+    void receive(const uint8_t* buffer, size_t len) {
+        rx_index = 0;
+        for (size_t i = 0; i < len && latest_rx_buffer_size > 0; i++) {
+            if (rx_index >= latest_rx_buffer_size && after_receive_buffer_full_callback) {
+                after_receive_buffer_full_callback(address);
             }
+            if (rx_index < latest_rx_buffer_size) {
+                uint8_t& value = latest_rx_buffer[rx_index];
+                value = latest_rx_rules ? latest_rx_rules[rx_index].apply(value, buffer[i]) : buffer[i];
+                rx_index++;
+            }
+        }
+        if(after_receive_callback) {
+            after_receive_callback(rx_index, address);
         }
     }
 
+    void write(uint8_t reg_num, uint8_t* buffer, size_t len) {
+        uint8_t frame[256];
+        len = min(len, sizeof(frame) - 1);
+        frame[0] = reg_num;
+        memcpy(frame + 1, buffer, len);
+        receive(frame, len + 1);
+    }
+
     void write_reg_number(uint8_t reg_num) {
-        if (latest_rx_buffer != nullptr && latest_rx_buffer_size > 0) {
-            latest_rx_buffer[0] = reg_num;
-            if(after_receive_callback) {
-                after_receive_callback(sizeof(uint8_t), address);
-            }
-        }
+        receive(&reg_num, sizeof(reg_num));
+    }
+
+    void write_reg_number_16(uint16_t reg_num) {
+        uint8_t frame[] = {(uint8_t)(reg_num >> 8), (uint8_t)(reg_num & 0xFF)};
+        receive(frame, sizeof(frame));
     }
 
     void write_value(uint8_t* buffer, size_t len) {
-        if (latest_rx_buffer) {
-            memcpy(latest_rx_buffer, buffer, min(len, latest_rx_buffer_size));
-            if(after_receive_callback) {
-                after_receive_callback(len, address);
-            }
-        }
+        receive(buffer, len);
     }
 
     void read_value(uint8_t* buffer, size_t len) {
@@ -86,6 +109,7 @@ public:
     void reset() {
         latest_rx_buffer = nullptr;
         latest_rx_buffer_size = 0;
+        latest_rx_rules = nullptr;
         latest_tx_buffer = nullptr;
         latest_tx_buffer_size = 0;
     }
@@ -93,11 +117,14 @@ public:
     uint16_t address = 0;
     uint8_t* latest_rx_buffer = nullptr;
     size_t latest_rx_buffer_size = 0;
+    const I2CRegisterAccess* latest_rx_rules = nullptr;
     const uint8_t* latest_tx_buffer = nullptr;
     size_t latest_tx_buffer_size = 0;
 
 private:
+    size_t rx_index = 0;
     std::function<void(size_t length, uint16_t address)> after_receive_callback = nullptr;
+    std::function<void(uint16_t address)> after_receive_buffer_full_callback = nullptr;
 //    std::function<void(uint16_t address)> before_transmit_callback = nullptr;
     std::function<void(uint16_t address)> after_transmit_callback = nullptr;
 };
@@ -244,6 +271,32 @@ public:
         TEST_ASSERT_EQUAL_MEMORY(expected, big_settings, sizeof(big_settings));
     }
 
+    static void test_rejects_writes_to_read_only_registers() {
+        uint8_t original[sizeof(read_only)];
+        memcpy(original, read_only, sizeof(read_only));
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, settings, sizeof(settings), read_only, sizeof(read_only));
+        reg_slave.listen(address);
+        bool after_write_called = false;
+        reg_slave.after_write([&after_write_called](uint16_t the_register, size_t num_bytes) {
+            after_write_called = true;
+        });
+
+        uint8_t reg = sizeof(settings) + 1;    // a read only register
+        uint16_t value = 0xAABB;
+        dummy->write_reg_number(reg);
+        dummy->write_value((uint8_t*)&value, sizeof(value));
+        dummy->write(reg, (uint8_t*)&value, sizeof(value));
+
+        TEST_ASSERT_EQUAL_MEMORY(original, read_only, sizeof(read_only));
+        TEST_ASSERT_FALSE(after_write_called);
+        TEST_ASSERT_EQUAL(2, reg_slave.rejected_writes());
+
+        // The slave is ready for the next register number
+        dummy->write(0x01, (uint8_t*)&value, sizeof(value));
+        TEST_ASSERT_TRUE(after_write_called);
+        TEST_ASSERT_EQUAL(0xBB, settings[1]);
+    }
+
     static void test_master_cannot_write_too_many_bytes_to_a_register_with_single_transaction() {
         uint8_t big_settings[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
         size_t claimed_settings_size = 2;
@@ -431,7 +484,7 @@ public:
         };
         reg_slave.after_write(callback);
 
-        uint8_t reg = 0x0A;
+        uint8_t reg = 0x01;
         dummy->write_reg_number(reg);
         TEST_ASSERT_EQUAL(0, callback_reg_num); // Shouldn't have been called yet.
 
@@ -453,13 +506,313 @@ public:
         };
         reg_slave.after_write(callback);
 
-        uint8_t reg = 0x0A;
+        uint8_t reg = 0x01;
         uint16_t value = 0xFF;
         dummy->write(reg, (uint8_t*)&value, sizeof(value));
         TEST_ASSERT_EQUAL(reg, callback_reg_num);
         TEST_ASSERT_EQUAL(sizeof(value), callback_num_bytes);
     }
 
+    static void test_master_can_write_many_bytes_in_single_transaction() {
+        uint8_t big_settings[200] = {};
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, big_settings, sizeof(big_settings), read_only,
+                                                      sizeof(read_only));
+        reg_slave.listen(address);
+        size_t callback_num_bytes = 0;
+        reg_slave.after_write([&callback_num_bytes](uint16_t the_register, size_t num_bytes) {
+            callback_num_bytes = num_bytes;
+        });
+
+        uint8_t value[150];
+        for (size_t i = 0; i < sizeof(value); i++) {
+            value[i] = i + 1;
+        }
+        dummy->write(0x10, value, sizeof(value));
+
+        TEST_ASSERT_EQUAL_MEMORY(value, big_settings + 0x10, sizeof(value));
+        TEST_ASSERT_EQUAL(0x00, big_settings[0x10 + sizeof(value)]);
+        TEST_ASSERT_EQUAL(sizeof(value), callback_num_bytes);
+    }
+
+    static void test_master_can_write_to_16_bit_register() {
+        uint8_t big_settings[300] = {};
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, big_settings, sizeof(big_settings), read_only,
+                                                      sizeof(read_only), RegisterNumberSize::two_bytes);
+        reg_slave.listen(address);
+        uint16_t callback_reg_num = 0;
+        reg_slave.after_write([&callback_reg_num](uint16_t the_register, size_t num_bytes) {
+            callback_reg_num = the_register;
+        });
+
+        uint16_t value = 0xBBAA;
+        dummy->write_reg_number_16(0x0102);
+        dummy->write_value((uint8_t*)&value, sizeof(value));
+
+        TEST_ASSERT_EQUAL(0xAA, big_settings[0x0102]);
+        TEST_ASSERT_EQUAL(0xBB, big_settings[0x0103]);
+        TEST_ASSERT_EQUAL(0x0102, callback_reg_num);
+    }
+
+    static void test_master_can_write_to_16_bit_register_in_single_transaction() {
+        uint8_t big_settings[300] = {};
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, big_settings, sizeof(big_settings), read_only,
+                                                      sizeof(read_only), RegisterNumberSize::two_bytes);
+        reg_slave.listen(address);
+
+        uint8_t frame[] = {0x01, 0x20, 0xAA, 0xBB};
+        dummy->write_value(frame, sizeof(frame));
+
+        TEST_ASSERT_EQUAL(0xAA, big_settings[0x0120]);
+        TEST_ASSERT_EQUAL(0xBB, big_settings[0x0121]);
+    }
+
+    static void test_master_can_read_from_16_bit_readonly_register() {
+        uint8_t big_settings[300] = {};
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, big_settings, sizeof(big_settings), read_only,
+                                                      sizeof(read_only), RegisterNumberSize::two_bytes);
+        reg_slave.listen(address);
+
+        uint16_t value = 0;
+        dummy->write_reg_number_16(sizeof(big_settings) + 1);
+        dummy->read_value((uint8_t*)&value, sizeof(value));
+
+        TEST_ASSERT_EQUAL(0x0C0B, value);
+    }
+
+    static void test_ignores_incomplete_16_bit_register_number() {
+        uint8_t big_settings[300] = {};
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, big_settings, sizeof(big_settings), read_only,
+                                                      sizeof(read_only), RegisterNumberSize::two_bytes);
+        reg_slave.listen(address);
+
+        uint8_t value = 0xAA;
+        dummy->write_reg_number(0x00);
+        dummy->write_value(&value, sizeof(value));
+
+        uint8_t expected[sizeof(big_settings)] = {};
+        TEST_ASSERT_EQUAL_MEMORY(expected, big_settings, sizeof(big_settings));
+    }
+
+    static void test_master_reads_snapshot_not_read_only_buffer() {
+        uint8_t live[] = {0x0A, 0x0B, 0x0C, 0x0D};
+        uint8_t snapshots[REG_SLAVE_SNAPSHOT_COUNT * sizeof(live)];
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, settings, sizeof(settings), live, sizeof(live));
+        reg_slave.enable_snapshots(snapshots);
+        reg_slave.listen(address);
+
+        live[0] = 0xFF; // Not committed
+        uint16_t value = 0;
+        dummy->write_reg_number(sizeof(settings));
+        dummy->read_value((uint8_t*)&value, sizeof(value));
+
+        TEST_ASSERT_EQUAL(0x0B0A, value);
+    }
+
+    static void test_master_reads_committed_snapshot() {
+        uint8_t live[] = {0x0A, 0x0B, 0x0C, 0x0D};
+        uint8_t snapshots[REG_SLAVE_SNAPSHOT_COUNT * sizeof(live)];
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, settings, sizeof(settings), live, sizeof(live));
+        reg_slave.enable_snapshots(snapshots);
+        reg_slave.listen(address);
+
+        live[0] = 0xAA;
+        live[1] = 0xBB;
+        reg_slave.commit();
+        uint16_t value = 0;
+        dummy->write_reg_number(sizeof(settings));
+        dummy->read_value((uint8_t*)&value, sizeof(value));
+
+        TEST_ASSERT_EQUAL(0xBBAA, value);
+    }
+
+    static void test_commit_does_not_change_read_in_progress() {
+        uint8_t live[] = {0x0A, 0x0B, 0x0C, 0x0D};
+        uint8_t snapshots[REG_SLAVE_SNAPSHOT_COUNT * sizeof(live)];
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, settings, sizeof(settings), live, sizeof(live));
+        reg_slave.enable_snapshots(snapshots);
+        reg_slave.listen(address);
+
+        // Master selects the register then the app commits several times
+        dummy->write_reg_number(sizeof(settings));
+        for (uint8_t i = 1; i <= 5; i++) {
+            memset(live, i, sizeof(live));
+            reg_slave.commit();
+        }
+        uint16_t value_1 = 0;
+        dummy->read_value((uint8_t*)&value_1, sizeof(value_1));
+        TEST_ASSERT_EQUAL(0x0B0A, value_1);
+
+        // The next read sees the latest commit
+        uint16_t value_2 = 0;
+        dummy->write_reg_number(sizeof(settings));
+        dummy->read_value((uint8_t*)&value_2, sizeof(value_2));
+        TEST_ASSERT_EQUAL(0x0505, value_2);
+    }
+
+    static void test_records_registers_changed_by_master() {
+        uint8_t big_settings[40] = {};
+        volatile uint32_t dirty[REG_SLAVE_DIRTY_WORDS(sizeof(big_settings))];
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, big_settings, sizeof(big_settings), read_only,
+                                                      sizeof(read_only));
+        reg_slave.track_changes(dirty);
+        reg_slave.listen(address);
+
+        uint32_t value = 0xAABBCCDD;
+        dummy->write(30, (uint8_t*)&value, sizeof(value));
+        dummy->write_reg_number(1);
+        dummy->write_value((uint8_t*)&value, 1);
+
+        uint32_t changed[REG_SLAVE_DIRTY_WORDS(sizeof(big_settings))] = {};
+        TEST_ASSERT_TRUE(reg_slave.collect_changes(changed));
+        TEST_ASSERT_EQUAL_HEX32(0xC0000002, changed[0]);
+        TEST_ASSERT_EQUAL_HEX32(0x00000003, changed[1]);
+        TEST_ASSERT_TRUE(I2CRegisterSlave::is_changed(changed, 33));
+        TEST_ASSERT_FALSE(I2CRegisterSlave::is_changed(changed, 34));
+    }
+
+    static void test_collect_changes_clears_dirty_registers() {
+        volatile uint32_t dirty[REG_SLAVE_DIRTY_WORDS(sizeof(settings))];
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, settings, sizeof(settings), read_only, sizeof(read_only));
+        reg_slave.track_changes(dirty);
+        reg_slave.listen(address);
+
+        uint8_t value = 0xAA;
+        dummy->write(2, &value, sizeof(value));
+        uint32_t changed[REG_SLAVE_DIRTY_WORDS(sizeof(settings))] = {};
+        TEST_ASSERT_TRUE(reg_slave.collect_changes(changed));
+        TEST_ASSERT_EQUAL_HEX32(0x04, changed[0]);
+
+        TEST_ASSERT_FALSE(reg_slave.collect_changes(changed));
+        TEST_ASSERT_EQUAL_HEX32(0x00, changed[0]);
+    }
+
+    static void test_ignores_writes_to_read_only_registers_when_tracking_changes() {
+        volatile uint32_t dirty[REG_SLAVE_DIRTY_WORDS(sizeof(settings))];
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, settings, sizeof(settings), blank_read_only,
+                                                      sizeof(blank_read_only));
+        reg_slave.track_changes(dirty);
+        reg_slave.listen(address);
+
+        uint16_t value = 0xAABB;
+        dummy->write(sizeof(settings), (uint8_t*)&value, sizeof(value));
+        dummy->write_reg_number(sizeof(settings) + 1);
+        dummy->write_value((uint8_t*)&value, sizeof(value));
+
+        uint32_t changed[REG_SLAVE_DIRTY_WORDS(sizeof(settings))] = {};
+        TEST_ASSERT_FALSE(reg_slave.collect_changes(changed));
+    }
+
+    static void test_access_map_applies_write_masks() {
+        uint8_t regs[] = {0x00, 0xFF, 0xFF, 0xFF};
+        const I2CRegisterAccess access_map[] = {
+                {RegisterAccess::read_write, 0xFF},
+                {RegisterAccess::read_write, 0x0F},
+                {RegisterAccess::read_only, 0xFF},
+                {RegisterAccess::write_1_to_clear, 0xF0},
+        };
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, regs, sizeof(regs), read_only, sizeof(read_only));
+        reg_slave.set_access_map(access_map);
+        reg_slave.listen(address);
+
+        uint8_t values[] = {0xAA, 0x00, 0x00, 0x30};
+        dummy->write(0, values, sizeof(values));
+
+        uint8_t expected[] = {0xAA, 0xF0, 0xFF, 0xCF};
+        TEST_ASSERT_EQUAL_MEMORY(expected, regs, sizeof(regs));
+    }
+
+    static void test_access_map_applies_to_writes_after_register_number() {
+        uint8_t regs[] = {0x00, 0xFF, 0xFF, 0xFF};
+        const I2CRegisterAccess access_map[] = {
+                {RegisterAccess::read_write, 0xFF},
+                {RegisterAccess::read_write, 0x0F},
+                {RegisterAccess::read_only, 0xFF},
+                {RegisterAccess::write_1_to_clear, 0xF0},
+        };
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, regs, sizeof(regs), read_only, sizeof(read_only));
+        reg_slave.set_access_map(access_map);
+        reg_slave.listen(address);
+
+        uint8_t values[] = {0x00, 0x00, 0xF3};
+        dummy->write_reg_number(1);
+        dummy->write_value(values, sizeof(values));
+
+        uint8_t expected[] = {0x00, 0xF0, 0xFF, 0x0F};
+        TEST_ASSERT_EQUAL_MEMORY(expected, regs, sizeof(regs));
+    }
+
+    static void test_access_map_handles_long_writes() {
+        const size_t num_regs = 48;
+        uint8_t regs[num_regs] = {};
+        I2CRegisterAccess access_map[num_regs];
+        for (size_t i = 0; i < num_regs; i++) {
+            access_map[i] = {RegisterAccess::read_write, 0x7F};
+        }
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, regs, sizeof(regs), read_only, sizeof(read_only));
+        reg_slave.set_access_map(access_map);
+        reg_slave.listen(address);
+        size_t callback_num_bytes = 0;
+        reg_slave.after_write([&callback_num_bytes](uint16_t the_register, size_t num_bytes) {
+            callback_num_bytes = num_bytes;
+        });
+
+        uint8_t values[num_regs];
+        memset(values, 0xFF, sizeof(values));
+        dummy->write(2, values, sizeof(values));
+
+        TEST_ASSERT_EQUAL(0x00, regs[1]);
+        for (size_t i = 2; i < num_regs; i++) {
+            TEST_ASSERT_EQUAL_HEX8(0x7F, regs[i]);
+        }
+        TEST_ASSERT_EQUAL(sizeof(values), callback_num_bytes);
+    }
+
+    static void test_master_cannot_read_write_only_register() {
+        uint8_t regs[] = {0xAA, 0xBB, 0xCC, 0xDD};
+        const I2CRegisterAccess access_map[] = {
+                {RegisterAccess::read_write, 0xFF},
+                {RegisterAccess::read_write, 0xFF},
+                {RegisterAccess::write_only, 0xFF},
+                {RegisterAccess::read_write, 0xFF},
+        };
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, regs, sizeof(regs), read_only, sizeof(read_only));
+        reg_slave.set_access_map(access_map);
+        reg_slave.listen(address);
+
+        uint8_t value_1[4] = {};
+        dummy->write_reg_number(0);
+        dummy->read_value(value_1, sizeof(value_1));
+        uint8_t expected_1[] = {0xAA, 0xBB, 0x00, 0x00};
+        TEST_ASSERT_EQUAL_MEMORY(expected_1, value_1, sizeof(value_1));
+
+        uint8_t value_2 = 0;
+        dummy->write_reg_number(3);
+        dummy->read_value(&value_2, sizeof(value_2));
+        TEST_ASSERT_EQUAL_HEX8(0xDD, value_2);
+    }
+
+    static void test_access_map_does_not_mark_read_only_registers_as_changed() {
+        uint8_t regs[] = {0x00, 0x00, 0x00, 0x00};
+        volatile uint32_t dirty[REG_SLAVE_DIRTY_WORDS(sizeof(regs))];
+        const I2CRegisterAccess access_map[] = {
+                {RegisterAccess::read_write, 0xFF},
+                {RegisterAccess::read_only, 0xFF},
+                {RegisterAccess::write_only, 0xFF},
+                {RegisterAccess::read_write, 0xFF},
+        };
+        I2CRegisterSlave reg_slave = I2CRegisterSlave(*dummy, regs, sizeof(regs), read_only, sizeof(read_only));
+        reg_slave.set_access_map(access_map);
+        reg_slave.track_changes(dirty);
+        reg_slave.listen(address);
+
+        uint8_t values[] = {0x01, 0x02, 0x03};
+        dummy->write(0, values, sizeof(values));
+
+        uint32_t changed[REG_SLAVE_DIRTY_WORDS(sizeof(regs))] = {};
+        TEST_ASSERT_TRUE(reg_slave.collect_changes(changed));
+        TEST_ASSERT_EQUAL_HEX32(0x05, changed[0]);
+    }
+
     void test() final {
         RUN_TEST(test_listen_calls_listen_on_driver);
 
@@ -472,6 +825,7 @@ public:
         RUN_TEST(test_master_can_write_register_in_single_transaction);
         RUN_TEST(test_master_can_write_to_multiple_registers_with_single_transactions);
         RUN_TEST(test_ignores_single_transaction_write_to_non_existent_register);
+        RUN_TEST(test_rejects_writes_to_read_only_registers);
         RUN_TEST(test_master_cannot_write_too_many_bytes_to_a_register_with_single_transaction);
 
         RUN_TEST(test_master_can_read_from_mutable_register);
@@ -489,6 +843,26 @@ public:
         RUN_TEST(test_app_receives_callback_after_read);
         RUN_TEST(test_app_receives_callback_after_write);
         RUN_TEST(test_app_receives_callback_after_write_with_register);
+
+        RUN_TEST(test_master_can_write_many_bytes_in_single_transaction);
+        RUN_TEST(test_master_can_write_to_16_bit_register);
+        RUN_TEST(test_master_can_write_to_16_bit_register_in_single_transaction);
+        RUN_TEST(test_master_can_read_from_16_bit_readonly_register);
+        RUN_TEST(test_ignores_incomplete_16_bit_register_number);
+
+        RUN_TEST(test_master_reads_snapshot_not_read_only_buffer);
+        RUN_TEST(test_master_reads_committed_snapshot);
+        RUN_TEST(test_commit_does_not_change_read_in_progress);
+
+        RUN_TEST(test_records_registers_changed_by_master);
+        RUN_TEST(test_collect_changes_clears_dirty_registers);
+        RUN_TEST(test_ignores_writes_to_read_only_registers_when_tracking_changes);
+
+        RUN_TEST(test_access_map_applies_write_masks);
+        RUN_TEST(test_access_map_applies_to_writes_after_register_number);
+        RUN_TEST(test_access_map_handles_long_writes);
+        RUN_TEST(test_master_cannot_read_write_only_register);
+        RUN_TEST(test_access_map_does_not_mark_read_only_registers_as_changed);
     }
 
     I2CRegisterSlaveTest() : TestSuite(__FILE__) {};
@@ -0,0 +1,154 @@
+// Copyright © 2023 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#define TEENSY_I2C_UNIT_TEST_I2C_TRANSACTION_LOG_TEST
+#ifdef TEENSY_I2C_UNIT_TEST_I2C_TRANSACTION_LOG_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include "i2c_transaction_log.h"
+#include "utils/test_suite.h"
+
+// Collects everything written to it.
+class LogSink : public Print {
+public:
+    size_t write(uint8_t b) override {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        memcpy(data + length, buffer, size);
+        length += size;
+        writes++;
+        return size;
+    }
+
+    uint8_t data[64] = {};
+    size_t length = 0;
+    size_t writes = 0;
+};
+
+class I2CTransactionLogTest : public TestSuite {
+public:
+    static uint8_t buffer[40];
+    static const uint8_t payload[8];
+
+    void setUp() override {
+        memset(buffer, 0, sizeof(buffer));
+    }
+
+    static void test_records_header_and_payload() {
+        I2CTransactionLog log(buffer, sizeof(buffer), 4);
+
+        log.record(I2C_LOG_FLAG_READ | 2, 0x2D, 3, payload, I2CError::data_nak);
+
+        uint8_t entry[I2C_LOG_HEADER_LENGTH + 3];
+        TEST_ASSERT_EQUAL(sizeof(entry), log.available());
+        TEST_ASSERT_EQUAL(sizeof(entry), log.read(entry, sizeof(entry)));
+        TEST_ASSERT_EQUAL(I2C_LOG_MARKER, entry[0]);
+        TEST_ASSERT_EQUAL(I2C_LOG_FLAG_READ | 2, entry[1]);
+        TEST_ASSERT_EQUAL(static_cast<uint8_t>(I2CError::data_nak), entry[2]);
+        TEST_ASSERT_EQUAL(3, entry[3]);
+        TEST_ASSERT_EQUAL(0x2D, entry[8]);
+        TEST_ASSERT_EQUAL(0x00, entry[9]);
+        TEST_ASSERT_EQUAL(3, entry[10]);
+        TEST_ASSERT_EQUAL(0, entry[11]);
+        TEST_ASSERT_EQUAL_MEMORY(payload, entry + I2C_LOG_HEADER_LENGTH, 3);
+        TEST_ASSERT_EQUAL(0, log.available());
+    }
+
+    static void test_truncates_long_payloads() {
+        I2CTransactionLog log(buffer, sizeof(buffer), 4);
+
+        log.record(0, 0x10, sizeof(payload), payload, I2CError::ok);
+
+        uint8_t entry[I2C_LOG_HEADER_LENGTH + 4];
+        TEST_ASSERT_EQUAL(sizeof(entry), log.read(entry, sizeof(buffer)));
+        TEST_ASSERT_EQUAL(I2C_LOG_FLAG_TRUNCATED, entry[1]);
+        TEST_ASSERT_EQUAL(4, entry[3]);
+        TEST_ASSERT_EQUAL(sizeof(payload), entry[10]);
+        TEST_ASSERT_EQUAL_MEMORY(payload, entry + I2C_LOG_HEADER_LENGTH, 4);
+    }
+
+    static void test_drops_entries_when_full() {
+        I2CTransactionLog log(buffer, sizeof(buffer), 0);
+
+        for (int i = 0; i < 4; i++) {
+            log.record(0, 0x10 + i, 0, nullptr, I2CError::ok);
+        }
+
+        // 40 bytes holds 3 headers and leaves one byte empty
+        TEST_ASSERT_EQUAL(3 * I2C_LOG_HEADER_LENGTH, log.available());
+        TEST_ASSERT_EQUAL(1, log.dropped());
+        uint8_t entries[3 * I2C_LOG_HEADER_LENGTH];
+        log.read(entries, sizeof(entries));
+        TEST_ASSERT_EQUAL(0x12, entries[2 * I2C_LOG_HEADER_LENGTH + 8]);
+    }
+
+    static void test_entries_wrap_around_the_buffer() {
+        I2CTransactionLog log(buffer, sizeof(buffer), 8);
+        uint8_t entry[I2C_LOG_HEADER_LENGTH + 8];
+
+        // Move the start along so that the second 20 byte entry wraps
+        log.record(0, 0x10, 2, payload, I2CError::ok);
+        TEST_ASSERT_EQUAL(I2C_LOG_HEADER_LENGTH + 2, log.read(entry, sizeof(entry)));
+        for (int i = 0; i < 3; i++) {
+            log.record(0, 0x20 + i, sizeof(payload), payload, I2CError::ok);
+            TEST_ASSERT_EQUAL(sizeof(entry), log.read(entry, sizeof(entry)));
+            TEST_ASSERT_EQUAL(I2C_LOG_MARKER, entry[0]);
+            TEST_ASSERT_EQUAL(0x20 + i, entry[8]);
+            TEST_ASSERT_EQUAL_MEMORY(payload, entry + I2C_LOG_HEADER_LENGTH, sizeof(payload));
+        }
+        TEST_ASSERT_EQUAL(0, log.dropped());
+    }
+
+    static void test_reader_may_split_entries() {
+        I2CTransactionLog log(buffer, sizeof(buffer), 8);
+        log.record(0, 0x30, 2, payload, I2CError::ok);
+
+        uint8_t entry[I2C_LOG_HEADER_LENGTH + 2];
+        TEST_ASSERT_EQUAL(5, log.read(entry, 5));
+        TEST_ASSERT_EQUAL(sizeof(entry) - 5, log.read(entry + 5, sizeof(buffer)));
+        TEST_ASSERT_EQUAL(I2C_LOG_MARKER, entry[0]);
+        TEST_ASSERT_EQUAL(0x30, entry[8]);
+        TEST_ASSERT_EQUAL_MEMORY(payload, entry + I2C_LOG_HEADER_LENGTH, 2);
+    }
+
+    static void test_write_to_streams_everything() {
+        I2CTransactionLog log(buffer, sizeof(buffer), 8);
+        LogSink sink;
+        uint8_t entry[I2C_LOG_HEADER_LENGTH + 8];
+        log.record(0, 0x40, sizeof(payload), payload, I2CError::ok);
+        log.record(0, 0x40, 0, nullptr, I2CError::ok);
+        log.read(entry, sizeof(entry));
+        log.read(entry, I2C_LOG_HEADER_LENGTH);
+        log.record(0, 0x41, sizeof(payload), payload, I2CError::ok);
+
+        // The entry wraps so it takes 2 writes
+        TEST_ASSERT_EQUAL(sizeof(entry), log.write_to(sink));
+        TEST_ASSERT_EQUAL(sizeof(entry), sink.length);
+        TEST_ASSERT_EQUAL(2, sink.writes);
+        TEST_ASSERT_EQUAL(0x41, sink.data[8]);
+        TEST_ASSERT_EQUAL_MEMORY(payload, sink.data + I2C_LOG_HEADER_LENGTH, sizeof(payload));
+        TEST_ASSERT_EQUAL(0, log.available());
+    }
+
+    void test() final {
+        RUN_TEST(test_records_header_and_payload);
+        RUN_TEST(test_truncates_long_payloads);
+        RUN_TEST(test_drops_entries_when_full);
+        RUN_TEST(test_entries_wrap_around_the_buffer);
+        RUN_TEST(test_reader_may_split_entries);
+        RUN_TEST(test_write_to_streams_everything);
+    }
+
+    I2CTransactionLogTest() : TestSuite(__FILE__) {};
+};
+
+// Define statics
+uint8_t I2CTransactionLogTest::buffer[40];
+const uint8_t I2CTransactionLogTest::payload[8] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+
+#endif //TEENSY_I2C_UNIT_TEST_I2C_TRANSACTION_LOG_TEST
@@ -0,0 +1,164 @@
+# Converts BusTrace recordings into files that PulseView can open.
+#
+# Usage:
+#   python bus_trace_export.py test_output.txt trace.vcd
+#   python bus_trace_export.py --index 2 test_output.txt trace.sr
+#
+# The input is the serial output of E2ETestBase::print_trace_dump(). It may
+# contain other text. Each trace starts with a "TRACE,<name>" line followed
+# by one "EDGE,<delta_ns>,<sda>,<scl>" line per event.
+#
+# The output format depends on the extension. ".vcd" writes a Value Change
+# Dump. ".sr" writes a sigrok session. Add the I2C decoder in PulseView with
+# SCL on the first channel and SDA on the second.
+#
+# to_edges() converts a pair of scope_simulator I2CLines so that simulated
+# and recorded traces can be compared side by side.
+import argparse
+import configparser
+import io
+import zipfile
+from dataclasses import dataclass, field
+from typing import List
+
+
+@dataclass
+class Edge:
+    time_ns: int
+    sda: int
+    scl: int
+
+
+@dataclass
+class Trace:
+    name: str
+    edges: List[Edge] = field(default_factory=list)
+
+
+def parse_dump(text: str) -> List[Trace]:
+    traces = []
+    time_ns = 0
+    for line in text.splitlines():
+        parts = line.strip().split(',')
+        if parts[0] == 'TRACE' and len(parts) == 2:
+            traces.append(Trace(parts[1]))
+            time_ns = 0
+        elif parts[0] == 'EDGE' and len(parts) == 4 and traces:
+            time_ns += int(parts[1])
+            traces[-1].edges.append(Edge(time_ns, int(parts[2]), int(parts[3])))
+    return traces
+
+
+def to_edges(sda, scl, threshold: float = 0.5) -> List[Edge]:
+    # Converts scope_simulator I2CLines to digital edges. An edge happens
+    # when the voltage crosses 'threshold' * Vdd.
+    changes = []
+    for line, name in [(sda, 'sda'), (scl, 'scl')]:
+        for i, direction in enumerate(line.get_edge_directions()):
+            at = round(line.get_time_from_edge(i, threshold * line.HIGH))
+            changes.append((at, name, 1 if direction == '↑' else 0))
+    state = {'sda': initial_state(sda), 'scl': initial_state(scl)}
+    edges = [Edge(0, state['sda'], state['scl'])]
+    for at, name, value in sorted(changes, key=lambda c: c[0]):
+        state[name] = value
+        edge = Edge(at, state['sda'], state['scl'])
+        if edges[-1].time_ns == at:
+            edges[-1] = edge
+        else:
+            edges.append(edge)
+    return edges
+
+
+def initial_state(line) -> int:
+    directions = line.get_edge_directions()
+    if directions:
+        return 0 if directions[0] == '↑' else 1
+    return 1
+
+
+def write_vcd(edges: List[Edge], out):
+    out.write('$timescale 1ns $end\n')
+    out.write('$scope module i2c $end\n')
+    out.write('$var wire 1 ! SCL $end\n')
+    out.write('$var wire 1 " SDA $end\n')
+    out.write('$upscope $end\n')
+    out.write('$enddefinitions $end\n')
+    previous = None
+    for edge in edges:
+        if previous is None:
+            out.write(f'#{edge.time_ns}\n$dumpvars\n{edge.scl}!\n{edge.sda}"\n$end\n')
+        else:
+            changes = ''
+            if edge.scl != previous.scl:
+                changes += f'{edge.scl}!\n'
+            if edge.sda != previous.sda:
+                changes += f'{edge.sda}"\n'
+            if changes:
+                out.write(f'#{edge.time_ns}\n{changes}')
+        previous = edge
+    if previous is not None:
+        # Show the final state for a little while
+        out.write(f'#{previous.time_ns + 1000}\n')
+
+
+def to_samples(edges: List[Edge], samplerate_hz: int) -> bytes:
+    # One byte per sample. Bit 0 is SCL. Bit 1 is SDA.
+    if not edges:
+        return b''
+    period_ns = 1e9 / samplerate_hz
+    end_ns = edges[-1].time_ns + 1000
+    samples = bytearray(int(end_ns / period_ns) + 1)
+    index = 0
+    for i in range(len(samples)):
+        t = i * period_ns
+        while index + 1 < len(edges) and edges[index + 1].time_ns <= t:
+            index += 1
+        samples[i] = edges[index].scl | (edges[index].sda << 1)
+    return bytes(samples)
+
+
+def write_sigrok(edges: List[Edge], out, samplerate_hz: int = 100_000_000):
+    metadata = configparser.ConfigParser()
+    metadata.optionxform = str
+    metadata['global'] = {'sigrok version': '0.5.2'}
+    metadata['device 1'] = {
+        'capturefile': 'logic-1',
+        'total probes': '2',
+        'samplerate': f'{samplerate_hz // 1_000_000} MHz',
+        'total analog': '0',
+        'probe1': 'SCL',
+        'probe2': 'SDA',
+        'unitsize': '1',
+    }
+    text = io.StringIO()
+    metadata.write(text)
+    with zipfile.ZipFile(out, 'w', zipfile.ZIP_DEFLATED) as session:
+        session.writestr('version', '2')
+        session.writestr('metadata', text.getvalue())
+        session.writestr('logic-1-1', to_samples(edges, samplerate_hz))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Converts a BusTrace dump to VCD or a sigrok session.')
+    parser.add_argument('dump', help='Serial output containing the dump')
+    parser.add_argument('output', help='Output file. Must end with .vcd or .sr')
+    parser.add_argument('--index', type=int, default=0, help='Which trace to convert if there are several')
+    parser.add_argument('--samplerate', type=int, default=100, help='Sigrok sample rate in MHz')
+    args = parser.parse_args()
+
+    with open(args.dump, encoding='utf-8', errors='replace') as f:
+        traces = parse_dump(f.read())
+    if args.index >= len(traces):
+        parser.error(f'Found {len(traces)} traces in {args.dump}')
+    edges = traces[args.index].edges
+    if args.output.endswith('.vcd'):
+        with open(args.output, 'w', newline='\n') as out:
+            write_vcd(edges, out)
+    elif args.output.endswith('.sr'):
+        write_sigrok(edges, args.output, args.samplerate * 1_000_000)
+    else:
+        parser.error('The output file must end with .vcd or .sr')
+
+
+if __name__ == '__main__':
+    main()
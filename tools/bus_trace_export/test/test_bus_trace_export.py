@@ -0,0 +1,77 @@
+import io
+import zipfile
+from unittest import TestCase
+
+from bus_trace_export.bus_trace_export import Edge, parse_dump, to_edges, to_samples, write_sigrok, write_vcd
+
+DUMP = '''Run Full Stack (E2E) Loopback Tests
+TRACE,first
+EDGE,0,1,1
+EDGE,500,0,1
+EDGE,250,0,0
+Some other output
+TRACE,second
+EDGE,0,1,1
+'''
+
+
+class FakeLine:
+    # Behaves like scope_simulator's I2CLine
+    HIGH = 1.0
+
+    def __init__(self, edges):
+        self.edges = edges
+
+    def get_edge_directions(self):
+        return [direction for _, direction in self.edges]
+
+    def get_time_from_edge(self, index, v):
+        return self.edges[index][0] + 10
+
+
+class TestBusTraceExport(TestCase):
+    def test_parses_dump(self):
+        traces = parse_dump(DUMP)
+
+        self.assertEqual(['first', 'second'], [t.name for t in traces])
+        self.assertEqual([Edge(0, 1, 1), Edge(500, 0, 1), Edge(750, 0, 0)], traces[0].edges)
+        self.assertEqual(1, len(traces[1].edges))
+
+    def test_writes_vcd(self):
+        out = io.StringIO()
+
+        write_vcd(parse_dump(DUMP)[0].edges, out)
+
+        vcd = out.getvalue()
+        self.assertIn('$var wire 1 ! SCL $end', vcd)
+        self.assertIn('$var wire 1 " SDA $end', vcd)
+        self.assertIn('#0\n$dumpvars\n1!\n1"\n$end\n', vcd)
+        self.assertIn('#500\n0"\n', vcd)
+        self.assertIn('#750\n0!\n', vcd)
+
+    def test_samples_hold_each_state_until_next_edge(self):
+        edges = [Edge(0, 1, 1), Edge(20, 0, 1), Edge(40, 0, 0)]
+
+        samples = to_samples(edges, 100_000_000)
+
+        self.assertEqual(bytes([3, 3, 1, 1, 0]), samples[:5])
+
+    def test_writes_sigrok_session(self):
+        out = io.BytesIO()
+
+        write_sigrok([Edge(0, 1, 1), Edge(20, 0, 1)], out)
+
+        with zipfile.ZipFile(out) as session:
+            self.assertEqual(b'2', session.read('version'))
+            metadata = session.read('metadata').decode()
+            self.assertIn('samplerate = 100 MHz', metadata)
+            self.assertIn('probe1 = SCL', metadata)
+            self.assertEqual(bytes([3, 3, 1]), session.read('logic-1-1')[:3])
+
+    def test_converts_scope_simulator_lines(self):
+        sda = FakeLine([(100, '↓')])
+        scl = FakeLine([(200, '↓'), (300, '↑')])
+
+        edges = to_edges(sda, scl)
+
+        self.assertEqual([Edge(0, 1, 1), Edge(110, 0, 1), Edge(210, 0, 0), Edge(310, 0, 1)], edges)
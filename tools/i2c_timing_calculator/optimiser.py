@@ -0,0 +1,245 @@
+# Searches the LPI2C master timing registers for the fastest configuration
+# that meets the I2C specification for the given rise and fall times.
+#
+# Usage (from the tools directory):
+#   python -m i2c_timing_calculator.optimiser --mode fast --scl-rise 330 --sda-rise 330
+#
+# It prints an I2CMasterConfiguration that can be pasted into
+# src/imx_rt1060/imx_rt1060_i2c_driver.cpp followed by the margin for
+# each timing requirement.
+#
+# The timing formulas are the same as TeensyConfig's worst case values but
+# they're evaluated for every CLKHI, CLKLO, DATAVD and filter setting at once
+# with numpy. SETHOLD and BUSIDLE don't affect the other timings so they're
+# set to the smallest values that work.
+import argparse
+from dataclasses import dataclass
+from typing import Optional
+
+import numpy as np
+
+from i2c_timing_calculator.profile_test.i2c_specification import I2CSpecification, standard_mode_spec, \
+    fast_mode_spec, fast_mode_plus_spec
+from i2c_timing_calculator.teensy_config import TeensyConfig, time_to_rise_to_0_3_vdd, time_to_rise_to_0_7_vdd, \
+    time_to_rise_to_teensy_trigger_voltage, time_to_fall_to_0_3_vdd, time_to_fall_to_0_7_vdd
+
+# Register field limits from the reference manual
+MAX_PRESCALE = 7
+MAX_CLKHI = 63
+MAX_CLKLO = 63
+MAX_DATAVD = 63
+MAX_SETHOLD = 63
+MAX_FILTER = 15
+MAX_BUSIDLE = 255     # The register holds 4095 but I2CMasterConfiguration.BUSIDLE is a uint8_t
+MIN_CLKHI = 1
+MIN_CLKLO = 3
+MIN_SETHOLD = 2
+MIN_BUSIDLE = 1     # 0 disables bus idle detection
+
+# Requirements that only depend on SETHOLD or BUSIDLE once the clock is chosen
+SETHOLD_REQUIREMENTS = ['start_hold_time', 'start_setup_time', 'stop_setup_time']
+BUSIDLE_REQUIREMENTS = ['bus_free_time']
+
+specifications = {
+    'standard': standard_mode_spec,
+    'fast': fast_mode_spec,
+    'fast_plus': fast_mode_plus_spec,
+}
+
+
+@dataclass
+class BusConditions:
+    frequency: int          # LPI2C functional clock in MHz
+    scl_risetime: int
+    sda_risetime: int
+    falltime: int = 8       # The Teensy controls the fall time
+    max_rise: Optional[int] = None
+    max_fall: Optional[int] = None
+
+    def worst_rise(self):
+        return self.max_rise if self.max_rise is not None else max(self.scl_risetime, self.sda_risetime)
+
+    def worst_fall(self):
+        return self.max_fall if self.max_fall is not None else self.falltime
+
+
+def scl_latency(prescale, filtscl, rise_time, period):
+    return np.floor((2.0 + filtscl + (rise_time * time_to_rise_to_teensy_trigger_voltage) / period) / (2 ** prescale))
+
+
+def worst_case_timings(bus: BusConditions, prescale, clkhi, clklo, datavd, sethold, busidle, filtscl):
+    # Returns the worst case value of each requirement. The arguments may be
+    # numpy arrays of any compatible shape. Matches TeensyConfig.
+    period = 1000.0 / bus.frequency
+    scale = period * (2 ** prescale)
+    fall = bus.falltime
+    max_rise = bus.worst_rise()
+    latency = scl_latency(prescale, filtscl, max_rise, period)
+
+    clock_low = scale * (clklo + 1) - fall * time_to_fall_to_0_3_vdd
+    clock_low_i2c = clock_low + bus.scl_risetime * time_to_rise_to_0_3_vdd
+    clock_high = scale * (clkhi + 1 + latency) - max_rise * time_to_rise_to_0_7_vdd + fall * time_to_fall_to_0_7_vdd
+    frequency = 1e9 / (scale * (clkhi + clklo + 2 + scl_latency(prescale, filtscl, 0, period)))
+
+    hold_nominal = scale * (datavd + 1)
+    hold_falling = hold_nominal - fall * time_to_fall_to_0_3_vdd + fall * time_to_fall_to_0_7_vdd
+    hold_rising = hold_nominal - fall * time_to_fall_to_0_3_vdd + max_rise * time_to_rise_to_0_3_vdd
+    hold_rising_i2c = hold_nominal - fall * time_to_fall_to_0_3_vdd + bus.sda_risetime * time_to_rise_to_0_3_vdd
+    valid_falling = hold_falling + fall
+    valid_rising = hold_rising + bus.sda_risetime
+    setup_falling = clock_low_i2c - (hold_falling + fall)
+    setup_rising = clock_low_i2c - (hold_rising_i2c + bus.sda_risetime) \
+        - (max_rise - bus.sda_risetime) * time_to_rise_to_0_7_vdd
+
+    start_hold = (sethold + 1) * scale - fall * time_to_rise_to_0_7_vdd + fall * time_to_rise_to_0_3_vdd
+    setup_start = scale * (sethold + 1 + latency) - max_rise * time_to_rise_to_0_7_vdd + fall * time_to_fall_to_0_7_vdd
+    setup_stop = scale * (sethold + 1 + latency) - max_rise * time_to_rise_to_0_7_vdd
+
+    if max_rise > 1000:
+        offset = ((max_rise - 1000) * time_to_rise_to_0_7_vdd) / scale + 1
+    else:
+        offset = np.where(busidle > 1, busidle + 1, 2)
+    bus_free = 1000 + (clklo + 1 + offset) * scale - max_rise * time_to_rise_to_0_7_vdd + fall * time_to_fall_to_0_7_vdd
+
+    return {
+        'frequency': frequency,
+        'scl_low_time': clock_low,
+        'scl_high_time': clock_high,
+        'data_hold_time': np.minimum(hold_falling, hold_rising),
+        'data_valid_time': np.maximum(valid_falling, valid_rising),
+        'data_setup_time': np.minimum(setup_falling, setup_rising),
+        'start_hold_time': start_hold,
+        'start_setup_time': setup_start,
+        'stop_setup_time': setup_stop,
+        'bus_free_time': bus_free,
+        'spike_width': filtscl * period,
+    }
+
+
+def margins(timings, spec: I2CSpecification):
+    # Distance from the nearest limit in nanoseconds. (Hz for frequency)
+    # Negative margins break the specification.
+    result = {}
+    for name, value in timings.items():
+        limits = getattr(spec, name)
+        result[name] = np.minimum(value - limits.min, limits.max - value)
+    return result
+
+
+def nominal_frequency(bus: BusConditions, prescale, clkhi, clklo, filtscl):
+    period = 1000.0 / bus.frequency
+    latency = scl_latency(prescale, filtscl, bus.scl_risetime, period)
+    return 1e9 / (period * (2 ** prescale) * (clkhi + clklo + 2 + latency))
+
+
+@dataclass
+class Solution:
+    config: TeensyConfig
+    nominal_frequency: float
+    margins: dict
+
+
+def optimise(bus: BusConditions, spec: I2CSpecification, guard_band: float = 0) -> Optional[Solution]:
+    # Finds the configuration with the highest SCL frequency whose margins
+    # are all at least 'guard_band' nanoseconds. Ties go to the configuration
+    # with the largest smallest margin.
+    # Each axis is a separate array so that numpy only evaluates
+    # each formula over the registers that it depends on.
+    axes = (np.arange(0, MAX_FILTER + 1), np.arange(MIN_CLKHI, MAX_CLKHI + 1),
+            np.arange(MIN_CLKLO, MAX_CLKLO + 1), np.arange(0, MAX_DATAVD + 1))
+    filt, clkhi, clklo, datavd = np.meshgrid(*axes, indexing='ij', sparse=True)
+    best = None
+    best_key = None
+    for prescale in range(MAX_PRESCALE + 1):
+        timings = worst_case_timings(bus, prescale, clkhi, clklo, datavd, MIN_SETHOLD, MIN_BUSIDLE, filt)
+        worst_margin = smallest_margin(timings, spec, exclude=SETHOLD_REQUIREMENTS + BUSIDLE_REQUIREMENTS)
+        ok = (worst_margin >= guard_band) & (timings['frequency'] <= spec.frequency.max)
+        if not ok.any():
+            continue
+        # Round the frequency so that tiny differences don't beat big margins
+        frequency = nominal_frequency(bus, prescale, clkhi, clklo, filt)
+        score = np.where(ok, np.round(frequency / 100), -1)
+        fastest = score == score.max()
+        index = np.unravel_index(np.argmax(np.where(fastest, worst_margin, -np.inf)), score.shape)
+        key = (score[index], worst_margin[index])
+        if best_key is None or key > best_key:
+            best_key = key
+            best = (prescale,) + tuple(int(axis[i]) for axis, i in zip(axes, index))
+    if best is None:
+        return None
+
+    prescale, filt, clkhi, clklo, datavd = best
+    sethold = smallest_passing(np.arange(MIN_SETHOLD, MAX_SETHOLD + 1), SETHOLD_REQUIREMENTS, guard_band, spec,
+                               lambda v: worst_case_timings(bus, prescale, clkhi, clklo, datavd, v, MIN_BUSIDLE, filt))
+    busidle = smallest_passing(np.arange(MIN_BUSIDLE, MAX_BUSIDLE + 1), BUSIDLE_REQUIREMENTS, guard_band, spec,
+                               lambda v: worst_case_timings(bus, prescale, clkhi, clklo, datavd, MIN_SETHOLD, v, filt))
+    if sethold is None or busidle is None:
+        return None
+    config = TeensyConfig(
+        name="Optimised",
+        scl_risetime=bus.scl_risetime, sda_risetime=bus.sda_risetime,
+        falltime=bus.falltime, max_fall=bus.worst_fall(), max_rise=bus.worst_rise(),
+        frequency=bus.frequency, prescale=prescale,
+        datavd=datavd, sethold=sethold, busidle=busidle,
+        filtscl=filt, filtsda=filt,
+        clkhi=clkhi, clklo=clklo)
+    timings = worst_case_timings(bus, prescale, clkhi, clklo, datavd, sethold, busidle, filt)
+    return Solution(config, float(nominal_frequency(bus, prescale, clkhi, clklo, filt)),
+                    {name: float(m) for name, m in margins(timings, spec).items()})
+
+
+def smallest_margin(timings, spec: I2CSpecification, exclude):
+    # The frequency margin is in Hz so it's checked separately
+    values = [m for name, m in margins(timings, spec).items() if name != 'frequency' and name not in exclude]
+    return np.minimum.reduce(np.broadcast_arrays(*values))
+
+
+def smallest_passing(values, requirements, guard_band, spec, timings_for):
+    # The smallest register value that meets 'requirements'
+    all_margins = margins(timings_for(values), spec)
+    ok = np.logical_and.reduce([np.broadcast_to(all_margins[name], values.shape) >= guard_band
+                                for name in requirements])
+    passing = values[ok]
+    return int(passing[0]) if len(passing) > 0 else None
+
+
+def to_cpp(config: TeensyConfig, name: str) -> str:
+    # The PINLOW expression matches the defaults in imx_rt1060_i2c_driver.cpp
+    prescale = 2 ** config.PRESCALE
+    pinlow = f"CLOCK_STRETCH_TIMEOUT * {config.frequency} / ({prescale} * 256) + 1" if prescale > 1 \
+        else f"CLOCK_STRETCH_TIMEOUT * {config.frequency} / 256 + 1"
+    return (f"const I2CMasterConfiguration {name} = {{\n"
+            f"    .PRESCALE = {config.PRESCALE},\n"
+            f"    .CLKHI = {config.CLKHI}, .CLKLO = {config.CLKLO},\n"
+            f"    .DATAVD = {config.DATAVD}, .SETHOLD = {config.SETHOLD},\n"
+            f"    .FILTSDA = {config.FILTSDA}, .FILTSCL = {config.FILTSCL},\n"
+            f"    .BUSIDLE = {config.BUSIDLE}, .PINLOW = {pinlow}\n"
+            f"}};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Finds the fastest LPI2C master timings that meet the I2C specification.')
+    parser.add_argument('--mode', choices=specifications.keys(), default='fast')
+    parser.add_argument('--clock', type=int, default=60, help='LPI2C functional clock in MHz')
+    parser.add_argument('--scl-rise', type=int, required=True, help='Measured SCL rise time in nanoseconds')
+    parser.add_argument('--sda-rise', type=int, required=True, help='Measured SDA rise time in nanoseconds')
+    parser.add_argument('--fall', type=int, default=8, help='Measured fall time in nanoseconds')
+    parser.add_argument('--max-rise', type=int, help='Worst case rise time. Defaults to the slower line.')
+    parser.add_argument('--guard-band', type=float, default=0, help='Minimum margin in nanoseconds')
+    parser.add_argument('--name', default='CustomMasterConfiguration')
+    args = parser.parse_args()
+
+    bus = BusConditions(frequency=args.clock, scl_risetime=args.scl_rise, sda_risetime=args.sda_rise,
+                        falltime=args.fall, max_rise=args.max_rise)
+    solution = optimise(bus, specifications[args.mode], args.guard_band)
+    if solution is None:
+        print("No configuration meets the specification.")
+        return
+    print(to_cpp(solution.config, args.name))
+    print(f"// SCL frequency {solution.nominal_frequency / 1000:.1f} kHz")
+    for name, margin in solution.margins.items():
+        print(f"// {name} margin {margin:.0f}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,125 @@
+import re
+from pathlib import Path
+from unittest import TestCase
+
+from i2c_timing_calculator import optimiser
+from i2c_timing_calculator.optimiser import BusConditions, optimise, to_cpp, worst_case_timings
+from i2c_timing_calculator.profile_test.i2c_specification import fast_mode_plus_spec, fast_mode_spec, Range, \
+    standard_mode_spec
+from i2c_timing_calculator.teensy_config import TeensyConfig
+
+
+DRIVER_SOURCE = Path(__file__).parents[3] / 'src' / 'imx_rt1060' / 'imx_rt1060_i2c_driver.cpp'
+
+
+def cpp_field_limits():
+    # The largest value each field of I2CMasterConfiguration can hold
+    struct = re.search(r"struct I2CMasterConfiguration \{(.*?)\};", DRIVER_SOURCE.read_text(), re.S).group(1)
+    return {name: 2 ** int(bits) - 1 for bits, name in re.findall(r"uint(\d+)_t (\w+);", struct)}
+
+
+class TestOptimiser(TestCase):
+    def assert_in_range(self, value, expected: Range):
+        self.assertGreaterEqual(value, expected.min)
+        self.assertLessEqual(value, expected.max)
+
+    def test_vectorised_timings_match_teensy_config(self):
+        bus = BusConditions(frequency=60, scl_risetime=300, sda_risetime=250, falltime=8, max_rise=330)
+        for prescale, clkhi, clklo, datavd, sethold, busidle, filt in [
+                (0, 14, 36, 12, 19, 1, 6), (1, 23, 42, 11, 21, 1, 15), (3, 34, 37, 7, 44, 9, 15)]:
+            config = TeensyConfig(
+                name="Test", scl_risetime=300, sda_risetime=250, falltime=8, max_fall=8, max_rise=330,
+                frequency=60, prescale=prescale, datavd=datavd, sethold=sethold, busidle=busidle,
+                filtscl=filt, filtsda=filt, clkhi=clkhi, clklo=clklo)
+
+            timings = worst_case_timings(bus, prescale, clkhi, clklo, datavd, sethold, busidle, filt)
+
+            self.assertAlmostEqual(config.clock_low().worst_case, timings['scl_low_time'], delta=1)
+            self.assertAlmostEqual(config.clock_high().worst_case, timings['scl_high_time'], delta=1)
+            self.assertAlmostEqual(config.clock_frequency().worst_case, timings['frequency'], delta=1)
+            self.assertAlmostEqual(config.data_hold(master=True, falling=True).worst_case,
+                                   timings['data_hold_time'], delta=1)
+            self.assertAlmostEqual(config.data_valid(master=True, falling=False).worst_case,
+                                   timings['data_valid_time'], delta=1)
+            self.assertAlmostEqual(min(config.data_setup(master=True, falling=True).worst_case,
+                                       config.data_setup(master=True, falling=False).worst_case),
+                                   timings['data_setup_time'], delta=1)
+            self.assertAlmostEqual(config.start_hold().worst_case, timings['start_hold_time'], delta=1)
+            self.assertAlmostEqual(config.setup_repeated_start().worst_case, timings['start_setup_time'], delta=1)
+            self.assertAlmostEqual(config.stop_setup().worst_case, timings['stop_setup_time'], delta=1)
+            self.assertAlmostEqual(config.bus_free().worst_case, timings['bus_free_time'], delta=1)
+
+    def test_optimised_config_meets_specification(self):
+        for spec, rise in [(fast_mode_spec, 330), (fast_mode_plus_spec, 132)]:
+            bus = BusConditions(frequency=60, scl_risetime=rise, sda_risetime=rise)
+
+            solution = optimise(bus, spec)
+
+            config = solution.config
+            self.assertTrue(all(margin >= 0 for margin in solution.margins.values()))
+            self.assert_in_range(config.clock_low().worst_case, spec.scl_low_time)
+            self.assert_in_range(config.clock_high().worst_case, spec.scl_high_time)
+            self.assert_in_range(config.clock_frequency().worst_case, spec.frequency)
+            self.assert_in_range(config.data_hold(master=True, falling=True).worst_case, spec.data_hold_time)
+            self.assert_in_range(config.data_setup(master=True, falling=True).worst_case, spec.data_setup_time)
+            self.assert_in_range(config.data_setup(master=True, falling=False).worst_case, spec.data_setup_time)
+            self.assert_in_range(config.start_hold().worst_case, spec.start_hold_time)
+            self.assert_in_range(config.setup_repeated_start().worst_case, spec.start_setup_time)
+            self.assert_in_range(config.stop_setup().worst_case, spec.stop_setup_time)
+            self.assert_in_range(config.bus_free().worst_case, spec.bus_free_time)
+            self.assert_in_range(config.scl_glitch_filter(), spec.spike_width)
+
+    def test_optimised_config_is_faster_than_default_fast_mode_plus(self):
+        # The default in imx_rt1060_i2c_driver.cpp runs at about 900 kHz
+        bus = BusConditions(frequency=60, scl_risetime=132, sda_risetime=132)
+
+        solution = optimise(bus, fast_mode_plus_spec)
+
+        self.assertGreater(solution.nominal_frequency, 900_000)
+
+    def test_guard_band_increases_margins(self):
+        bus = BusConditions(frequency=60, scl_risetime=132, sda_risetime=132)
+
+        solution = optimise(bus, fast_mode_plus_spec, guard_band=50)
+
+        for name, margin in solution.margins.items():
+            if name != 'frequency':
+                self.assertGreaterEqual(margin, 50, name)
+
+    def test_generates_cpp_initializer(self):
+        config = TeensyConfig(
+            name="Test", scl_risetime=132, sda_risetime=132, falltime=8, max_fall=8, max_rise=132,
+            frequency=60, prescale=1, datavd=12, sethold=19, busidle=1,
+            filtscl=6, filtsda=6, clkhi=14, clklo=36)
+
+        cpp = to_cpp(config, "BoardMasterConfiguration")
+
+        self.assertEqual("const I2CMasterConfiguration BoardMasterConfiguration = {\n"
+                         "    .PRESCALE = 1,\n"
+                         "    .CLKHI = 14, .CLKLO = 36,\n"
+                         "    .DATAVD = 12, .SETHOLD = 19,\n"
+                         "    .FILTSDA = 6, .FILTSCL = 6,\n"
+                         "    .BUSIDLE = 1, .PINLOW = CLOCK_STRETCH_TIMEOUT * 60 / (2 * 256) + 1\n"
+                         "};\n", cpp)
+
+    def test_search_limits_fit_cpp_fields(self):
+        limits = cpp_field_limits()
+
+        for field in ['PRESCALE', 'CLKHI', 'CLKLO', 'DATAVD', 'SETHOLD', 'BUSIDLE']:
+            self.assertLessEqual(getattr(optimiser, 'MAX_' + field), limits[field], field)
+        self.assertLessEqual(optimiser.MAX_FILTER, limits['FILTSCL'])
+        self.assertLessEqual(optimiser.MAX_FILTER, limits['FILTSDA'])
+
+    def test_emitted_values_fit_cpp_fields(self):
+        limits = cpp_field_limits()
+        timeout = int(re.search(r"#define CLOCK_STRETCH_TIMEOUT (\d+)", DRIVER_SOURCE.read_text()).group(1))
+        for spec, rise, clock in [(standard_mode_spec, 1000, 60), (standard_mode_spec, 100, 24),
+                                  (fast_mode_spec, 330, 60), (fast_mode_plus_spec, 132, 60)]:
+            bus = BusConditions(frequency=clock, scl_risetime=rise, sda_risetime=rise)
+
+            cpp = to_cpp(optimise(bus, spec).config, "Test")
+
+            for field, expression in re.findall(r"\.(\w+) = ([^,\n]+)", cpp):
+                # The PINLOW expression uses integer arithmetic in C++
+                value = eval(expression.replace("CLOCK_STRETCH_TIMEOUT", str(timeout)).replace("/", "//"))
+                self.assertLessEqual(value, limits[field], f"{field} for {spec} at {rise} ns")
@@ -0,0 +1,47 @@
+from unittest import TestCase
+
+from i2c_timing_calculator.throughput import ClockStretching, ThroughputModel, cross_check, default_configs
+
+
+class TestThroughputModel(TestCase):
+    def setUp(self):
+        self.fast_mode = ThroughputModel(default_configs()[400_000])
+
+    def test_probe_is_address_and_overheads(self):
+        # Measured by the host benchmark
+        self.assertAlmostEqual(26733, self.fast_mode.probe_time(), delta=1)
+        self.assertAlmostEqual(2500, self.fast_mode.bit_time(), delta=1)
+        overheads = self.fast_mode.start_time() + self.fast_mode.stop_time() + self.fast_mode.bus_free_time()
+        self.assertAlmostEqual(self.fast_mode.bit_time() * 9 + overheads, self.fast_mode.probe_time())
+
+    def test_each_byte_adds_9_bits(self):
+        bits = self.fast_mode.bit_time() * 9
+        self.assertAlmostEqual(self.fast_mode.write_time(4) + bits, self.fast_mode.write_time(5))
+        self.assertAlmostEqual(self.fast_mode.register_read_time(4) + bits, self.fast_mode.register_read_time(5))
+
+    def test_register_read_includes_repeated_start_and_stretching(self):
+        read = self.fast_mode.register_read_time(1, register_bytes=2)
+        self.assertAlmostEqual(118626, read, delta=1)
+        no_stretching = ThroughputModel(default_configs()[400_000], ClockStretching(first_read_byte=0))
+        self.assertAlmostEqual(read - 160, no_stretching.register_read_time(1, register_bytes=2))
+
+    def test_throughput_rises_with_message_length(self):
+        short = self.fast_mode.bytes_per_second(1, self.fast_mode.write_time(1))
+        long = self.fast_mode.bytes_per_second(256, self.fast_mode.write_time(256))
+        self.assertLess(short, long)
+        # Never faster than the raw bit rate allows
+        self.assertLess(long, 400_000 / 9)
+
+    def test_cross_check_reports_relative_error(self):
+        predicted = self.fast_mode.write_time(8)
+        rows = [
+            {'layer': 'master', 'direction': 'write', 'frequency_hz': 400_000, 'message_bytes': 8,
+             'errors': 0, 'max_latency_ns': predicted * 1.1},
+            {'layer': 'wire', 'direction': 'write', 'frequency_hz': 400_000, 'message_bytes': 8,
+             'errors': 0, 'max_latency_ns': predicted},
+        ]
+        results = cross_check(rows)
+        self.assertEqual(1, len(results))
+        row, prediction, error = results[0]
+        self.assertAlmostEqual(predicted, prediction)
+        self.assertAlmostEqual(0.1, error)
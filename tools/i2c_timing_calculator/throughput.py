@@ -0,0 +1,184 @@
+# Predicts how long typical I2C transactions take with a given TeensyConfig
+# and the throughput that results.
+#
+# Usage (from the tools directory):
+#   python -m i2c_timing_calculator.throughput --bytes 1 2 16
+#   python -m i2c_timing_calculator.throughput --benchmark path/to/i2c_benchmark
+#
+# Each transaction is the START, 9 SCL periods for the address and for each
+# byte, a STOP and the bus free time before the next START. A register read
+# adds a repeated START between the register number and the data. The slave
+# stretches the clock before the first byte it transmits while its ISR fills
+# the transmit data register.
+#
+# --benchmark runs host/benchmarks/i2c_benchmark against the LPI2C simulator
+# and compares its worst case latency for each transaction with the model.
+# The simulator doesn't model rise times so the configs are evaluated with
+# a rise time of 0 for the comparison.
+import argparse
+import json
+import subprocess
+import sys
+from dataclasses import dataclass
+
+from i2c_timing_calculator.teensy_config import TeensyConfig
+
+BITS_PER_BYTE = 9   # 8 data bits and the ACK
+
+
+@dataclass
+class ClockStretching:
+    # Time the slave holds SCL low before the first byte of a read
+    first_read_byte: float = 160
+    # Extra time the slave holds SCL low before each byte after that
+    per_read_byte: float = 0
+    # Time the slave holds SCL low after each byte it receives
+    per_write_byte: float = 0
+
+
+class ThroughputModel:
+    def __init__(self, config: TeensyConfig, stretching: ClockStretching = ClockStretching()):
+        self.config = config
+        self.stretching = stretching
+
+    def bit_time(self):
+        config = self.config
+        return config.scale * (config.CLKHI + config.CLKLO + 2 + config.SCL_LATENCY(config.scl_risetime))
+
+    def start_time(self):
+        return self.config.scale * (self.config.SETHOLD + 1)
+
+    def stop_time(self):
+        config = self.config
+        return config.scale * (config.SETHOLD + 1 + config.SCL_LATENCY(config.scl_risetime))
+
+    def repeated_start_time(self):
+        return self.stop_time() + self.start_time()
+
+    def bus_free_time(self):
+        return self.config.bus_free().nominal
+
+    def write_time(self, length: int):
+        """A write of 'length' bytes. A zero length write is an address probe."""
+        return (self.start_time() + self.bit_time() * BITS_PER_BYTE * (1 + length)
+                + self.stretching.per_write_byte * length
+                + self.stop_time() + self.bus_free_time())
+
+    def read_time(self, length: int):
+        return (self.start_time() + self.bit_time() * BITS_PER_BYTE * (1 + length)
+                + self.read_stretching(length)
+                + self.stop_time() + self.bus_free_time())
+
+    def register_read_time(self, length: int, register_bytes: int = 1):
+        """Writes the register number then reads 'length' bytes after a repeated START."""
+        bytes_on_bus = 1 + register_bytes + 1 + length
+        return (self.start_time() + self.bit_time() * BITS_PER_BYTE * bytes_on_bus
+                + self.stretching.per_write_byte * register_bytes
+                + self.repeated_start_time() + self.read_stretching(length)
+                + self.stop_time() + self.bus_free_time())
+
+    def probe_time(self):
+        return self.write_time(0)
+
+    def read_stretching(self, length: int):
+        if length == 0:
+            return 0
+        return self.stretching.first_read_byte + self.stretching.per_read_byte * (length - 1)
+
+    @staticmethod
+    def bytes_per_second(length: int, transaction_time: float):
+        return length * 1e9 / transaction_time
+
+    @staticmethod
+    def transactions_per_second(transaction_time: float):
+        return 1e9 / transaction_time
+
+
+# The default master configurations in src/imx_rt1060/imx_rt1060_i2c_driver.cpp
+def default_configs(scl_risetime=0, sda_risetime=0):
+    def config(name, prescale, clkhi, clklo, datavd, sethold, filt, busidle):
+        return TeensyConfig(name=name,
+                            scl_risetime=scl_risetime, sda_risetime=sda_risetime,
+                            falltime=8, max_fall=8, max_rise=max(scl_risetime, sda_risetime),
+                            frequency=60, prescale=prescale,
+                            datavd=datavd, sethold=sethold, busidle=busidle,
+                            filtsda=filt, filtscl=filt,
+                            clkhi=clkhi, clklo=clklo)
+    return {
+        100_000: config("Standard Mode", 3, 34, 37, 7, 44, 15, 9),
+        400_000: config("Fast Mode", 1, 23, 42, 11, 21, 15, 1),
+        1_000_000: config("Fast Mode Plus", 0, 14, 36, 12, 19, 6, 1),
+    }
+
+
+def predict(model: ThroughputModel, layer: str, direction: str, length: int):
+    """The model's prediction for one row of the benchmark output."""
+    if layer == 'register_slave':
+        # The benchmark's register slave uses 2 byte register numbers
+        if direction == 'read':
+            return model.register_read_time(length, register_bytes=2)
+        return model.write_time(2 + length)
+    if direction == 'read':
+        return model.read_time(length)
+    return model.write_time(length)
+
+
+def cross_check(rows, stretching: ClockStretching = ClockStretching()):
+    """Compares benchmark rows with the model. Returns a list of (row, predicted, error) for each row checked."""
+    models = {frequency: ThroughputModel(config, stretching) for frequency, config in default_configs().items()}
+    results = []
+    for row in rows:
+        if row['layer'] not in ('master', 'register_slave') or row['errors'] != 0:
+            continue
+        predicted = predict(models[row['frequency_hz']], row['layer'], row['direction'], row['message_bytes'])
+        error = (row['max_latency_ns'] - predicted) / predicted
+        results.append((row, predicted, error))
+    return results
+
+
+def run_benchmark(path: str, transactions: int):
+    output = subprocess.run([path, '--json', '--transactions', str(transactions)],
+                            check=True, capture_output=True, text=True).stdout
+    return json.loads(output)
+
+
+def print_predictions(lengths):
+    print("config,shape,bytes,transaction_ns,transactions_per_second,bytes_per_second")
+    for config in default_configs().values():
+        model = ThroughputModel(config)
+        print(f"{config.name},probe,0,{model.probe_time():.0f},"
+              f"{model.transactions_per_second(model.probe_time()):.1f},0")
+        for length in lengths:
+            for shape, time in [('write', model.write_time(length)),
+                                ('register_read', model.register_read_time(length))]:
+                print(f"{config.name},{shape},{length},{time:.0f},"
+                      f"{model.transactions_per_second(time):.1f},{model.bytes_per_second(length, time):.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Predicts I2C throughput for the default master configurations.')
+    parser.add_argument('--bytes', type=int, nargs='+', default=[1, 2, 4, 8, 16, 32],
+                        help='Message lengths to predict')
+    parser.add_argument('--benchmark', help='Path to i2c_benchmark. Compares its results with the model.')
+    parser.add_argument('--transactions', type=int, default=2,
+                        help='Transactions per benchmark point. The first one never waits for the bus so use 2 or more.')
+    parser.add_argument('--tolerance', type=float, default=0.01, help='Largest acceptable relative error')
+    args = parser.parse_args()
+
+    if not args.benchmark:
+        print_predictions(args.bytes)
+        return 0
+
+    results = cross_check(run_benchmark(args.benchmark, args.transactions))
+    failures = 0
+    for row, predicted, error in results:
+        if abs(error) > args.tolerance:
+            failures += 1
+            print(f"{row['layer']} {row['direction']} {row['frequency_hz']} Hz {row['message_bytes']} bytes: "
+                  f"measured {row['max_latency_ns']:.0f} ns, predicted {predicted:.0f} ns ({error:+.2%})")
+    print(f"{len(results) - failures} of {len(results)} benchmark points within {args.tolerance:.1%} of the model")
+    return 1 if failures or not results else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,5 +1,7 @@
 import math
 
+import numpy as np
+
 RISING = '↑'
 FALLING = '↓'
 
@@ -29,11 +31,11 @@ class I2CLine:
         return self
 
     def high(self, at: int = 0) -> 'I2CLine':
-        self.events.append([at, lambda t: self.HIGH])
+        self.events.append((at, self.HIGH, self.HIGH, 0.0))
         return self
 
     def low(self, at: int = 0) -> 'I2CLine':
-        self.events.append([at, lambda t: self.LOW])
+        self.events.append((at, self.LOW, self.LOW, 0.0))
         return self
 
     def get_edge_triggers(self):
@@ -42,10 +44,12 @@ class I2CLine:
     def get_edge_directions(self):
         return self.edge_directions
 
+    # Each event is (at, start, end, tau). The voltage decays exponentially
+    # from 'start' to 'end' after time 'at'. Steps have a tau of 0.
     def fall_at(self, at: int) -> 'I2CLine':
         self.edge_directions.append(FALLING)
         tau = self.fall_time / self.tau_ratio
-        edge = [at, lambda t: self.rc(tau, t - at)]
+        edge = (at, self.HIGH, self.LOW, tau)
         self.edges.append(edge)
         self.events.append(edge)
         return self
@@ -53,23 +57,33 @@ class I2CLine:
     def rise_at(self, at: int) -> 'I2CLine':
         self.edge_directions.append(RISING)
         tau = self.rise_time / self.tau_ratio
-        edge = [at, lambda t: self.HIGH - self.rc(tau, t - at)]
+        edge = (at, self.LOW, self.HIGH, tau)
         self.edges.append(edge)
         self.events.append(edge)
         return self
 
     def get_voltage_at(self, at: int) -> float:
-        num_events = len(self.events)
-        for i in range(num_events):
-            event = self.events[num_events - i - 1]
-            if at > event[0]:
-                return event[1](at)
-        if len(self.events) > 0:
-            return self.events[0][1](at)
-        return -1
-
-    def rc(self, tau: float, at: int):
-        return self.HIGH * math.exp(-at/tau)
+        return float(self.get_voltages(np.array([at]))[0])
+
+    def get_voltages(self, timestamps: np.ndarray) -> np.ndarray:
+        # Evaluates the whole array in one go. Each sample takes its value
+        # from the last event that happened before it. Samples before the
+        # first event use the first event.
+        timestamps = np.asarray(timestamps, dtype=float)
+        if len(self.events) == 0:
+            return np.full_like(timestamps, -1.0)
+        at, start, end, tau = (np.array(column, dtype=float) for column in zip(*self.events))
+
+        # Find the last event (in the order they were added) before each sample
+        order = np.argsort(at, kind='stable')
+        latest = np.maximum.accumulate(order)
+        count_before = np.searchsorted(at[order], timestamps, side='left')
+        index = np.where(count_before > 0, latest[np.maximum(count_before - 1, 0)], 0)
+
+        at, start, end, tau = at[index], start[index], end[index], tau[index]
+        steps = tau == 0
+        decay = np.exp(-(timestamps - at) / np.where(steps, 1.0, tau))
+        return np.where(steps, end, end + (start - end) * decay)
 
     def get_time_from_edge(self, index: int, v: float) -> int:
         edge = self.edges[index]
@@ -52,9 +52,7 @@ class I2CTrace:
     def plot_line(self, timestamps, line: I2CLine, label: str, color: str):
         if not line.show:
             return
-        voltages = np.zeros_like(timestamps, dtype=float)
-        for i in range(len(timestamps)):
-            voltages[i] = line.get_voltage_at(timestamps[i])
+        voltages = line.get_voltages(timestamps)
         self.ax.plot(timestamps, voltages, label=label, color=color)
 
     def set_events_from_edges(self):
@@ -0,0 +1,100 @@
+# Decodes the binary log written by I2CTransactionLog. (See src/i2c_transaction_log.h)
+#
+# Usage:
+#   python decode_transaction_log.py capture.bin > capture.csv
+#   python decode_transaction_log.py --json capture.bin > capture.json
+#
+# Capture the log with any serial terminal that can save raw bytes.
+# The decoder skips bytes until it finds a marker so it copes with
+# a capture that starts in the middle of an entry.
+import argparse
+import csv
+import json
+import struct
+import sys
+from dataclasses import dataclass, asdict
+
+MARKER = 0xA5
+HEADER = struct.Struct('<BBBBIHH')
+FLAG_PORT_MASK = 0x07
+FLAG_SLAVE = 0x08
+FLAG_READ = 0x10
+FLAG_TRUNCATED = 0x20
+
+# Matches I2CError in src/i2c_driver.h
+ERRORS = ['ok', 'arbitration_lost', 'buffer_overflow', 'buffer_underflow', 'invalid_request',
+          'master_pin_low_timeout', 'master_not_ready', 'master_fifo_error',
+          'master_fifos_not_empty', 'address_nak', 'data_nak', 'bit_error']
+
+FIELDS = ['timestamp_us', 'port', 'role', 'direction', 'address', 'length', 'error', 'truncated', 'payload']
+
+
+@dataclass
+class Transaction:
+    timestamp_us: int
+    port: int           # 0 for LPI2C1
+    role: str           # 'master' or 'slave'
+    direction: str      # 'read' or 'write' from the master's point of view
+    address: int
+    length: int         # Number of bytes transferred
+    error: str
+    truncated: bool     # True if the payload holds fewer than 'length' bytes
+    payload: str        # Hex
+
+
+def decode(data: bytes):
+    transactions = []
+    skipped = 0
+    i = 0
+    while i + HEADER.size <= len(data):
+        marker, flags, error, payload_length, timestamp, address, length = HEADER.unpack_from(data, i)
+        end = i + HEADER.size + payload_length
+        if marker != MARKER or error >= len(ERRORS) or payload_length > length or end > len(data):
+            # Not the start of an entry
+            i += 1
+            skipped += 1
+            continue
+        transactions.append(Transaction(
+            timestamp_us=timestamp,
+            port=flags & FLAG_PORT_MASK,
+            role='slave' if flags & FLAG_SLAVE else 'master',
+            direction='read' if flags & FLAG_READ else 'write',
+            address=address,
+            length=length,
+            error=ERRORS[error],
+            truncated=bool(flags & FLAG_TRUNCATED),
+            payload=data[i + HEADER.size:end].hex()))
+        i = end
+    return transactions, skipped + len(data) - i
+
+
+def write_csv(transactions, out):
+    writer = csv.DictWriter(out, fieldnames=FIELDS, lineterminator='\n')
+    writer.writeheader()
+    for t in transactions:
+        writer.writerow(asdict(t))
+
+
+def write_json(transactions, out):
+    json.dump([asdict(t) for t in transactions], out, indent=2)
+    out.write('\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decodes a binary I2C transaction log.')
+    parser.add_argument('log', help='File containing the raw log')
+    parser.add_argument('--json', action='store_true', help='Write JSON instead of CSV')
+    args = parser.parse_args()
+
+    with open(args.log, 'rb') as f:
+        transactions, skipped = decode(f.read())
+    if args.json:
+        write_json(transactions, sys.stdout)
+    else:
+        write_csv(transactions, sys.stdout)
+    if skipped:
+        print(f'Skipped {skipped} bytes that were not part of an entry.', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,61 @@
+import io
+import json
+import struct
+from unittest import TestCase
+
+from transaction_log.decode_transaction_log import decode, write_csv, write_json
+
+
+def entry(flags, error, address, length, payload=b'', timestamp=1000):
+    return struct.pack('<BBBBIHH', 0xA5, flags, error, len(payload), timestamp, address, length) + payload
+
+
+class TestDecodeTransactionLog(TestCase):
+    def test_decodes_master_write(self):
+        transactions, skipped = decode(entry(0x00, 0, 0x2D, 3, b'\x01\x02\x03', timestamp=123456))
+
+        self.assertEqual(0, skipped)
+        self.assertEqual(1, len(transactions))
+        t = transactions[0]
+        self.assertEqual(123456, t.timestamp_us)
+        self.assertEqual(0, t.port)
+        self.assertEqual('master', t.role)
+        self.assertEqual('write', t.direction)
+        self.assertEqual(0x2D, t.address)
+        self.assertEqual(3, t.length)
+        self.assertEqual('ok', t.error)
+        self.assertFalse(t.truncated)
+        self.assertEqual('010203', t.payload)
+
+    def test_decodes_flags_and_errors(self):
+        transactions, _ = decode(entry(0x08 | 0x10 | 0x20 | 2, 3, 0x40, 20, b'\xAA'))
+
+        t = transactions[0]
+        self.assertEqual(2, t.port)
+        self.assertEqual('slave', t.role)
+        self.assertEqual('read', t.direction)
+        self.assertEqual('buffer_underflow', t.error)
+        self.assertTrue(t.truncated)
+        self.assertEqual(20, t.length)
+
+    def test_resyncs_on_marker(self):
+        data = b'\x00\xA5\x12' + entry(0, 9, 0x10, 0) + entry(0, 0, 0x11, 1, b'\xFF') + b'\xA5\x00'
+
+        transactions, skipped = decode(data)
+
+        self.assertEqual([0x10, 0x11], [t.address for t in transactions])
+        self.assertEqual('address_nak', transactions[0].error)
+        self.assertEqual(5, skipped)
+
+    def test_writes_csv_and_json(self):
+        transactions, _ = decode(entry(0, 0, 0x2D, 1, b'\x7F'))
+        csv_out = io.StringIO()
+        json_out = io.StringIO()
+
+        write_csv(transactions, csv_out)
+        write_json(transactions, json_out)
+
+        lines = csv_out.getvalue().splitlines()
+        self.assertEqual('timestamp_us,port,role,direction,address,length,error,truncated,payload', lines[0])
+        self.assertEqual('1000,0,master,write,45,1,ok,False,7f', lines[1])
+        self.assertEqual('7f', json.loads(json_out.getvalue())[0]['payload'])